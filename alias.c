@@ -0,0 +1,512 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Alias globals
+struct vector aliasList = VECTOR_OF(struct alias);
+static struct stringmap aliasIndex;   // Name to its index in aliasList
+
+/**
+ * findAlias, the alias with this name. Returns NULL if there is none.
+ *
+ * Args: A string
+ * Return: A struct
+ */
+static struct alias *findAlias(const char *name)
+{
+    size_t *index = aliasList.count > 0 ? mapFind(&aliasIndex, name) : NULL;
+    return index != NULL ? &VECTOR_AT(aliasList, struct alias, *index) : NULL;
+}
+
+/**
+ * freeWords, frees count words and the array holding them.
+ *
+ * Args: An array of strings, A size_t
+ * Return: Nothing
+ */
+static void freeWords(char **words, size_t count)
+{
+    for (size_t i = 0; words != NULL && i < count; i++)
+        free(words[i]);
+    free(words);
+}
+
+/**
+ * forgetResolved, drops every alias's resolved words. Any alias changing can change what the
+ *                 others expand to.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+static void forgetResolved()
+{
+    for (size_t i = 0; i < aliasList.count; i++)
+    {
+        struct alias *alias = &VECTOR_AT(aliasList, struct alias, i);
+        freeWords(alias->resolved, alias->resolvedCount);
+        alias->resolved = NULL;
+        alias->resolvedCount = 0;
+        alias->isResolved = 0;
+    }
+}
+
+/**
+ * isSeparator, whether a word ends a command, so the next word is in command position.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+static int isSeparator(const char *word)
+{
+    const char *separators[] = {";", "&", "&&", "||", "(", ")", "{", "}", "|", "|&"};
+    for (size_t i = 0; i < sizeof(separators) / sizeof(separators[0]); i++)
+        if (strcmp(word, separators[i]) == 0)
+            return 1;
+    return 0;
+}
+
+/**
+ * pushWord, appends a word the list takes ownership of. Returns -1 if out of memory, the word
+ *           is freed then.
+ *
+ * Args: A pointer to an array of strings, Two pointers to a size_t, A string
+ * Return: An integer
+ */
+static int pushWord(char ***words, size_t *count, size_t *capacity, char *word)
+{
+    char **grown = word != NULL ? growCommandList(*words, capacity, *count + 2) : NULL;
+    if (grown == NULL)
+    {
+        free(word);
+        return -1;
+    }
+    *words = grown;
+    grown[(*count)++] = word;
+    grown[*count] = NULL;
+    return 0;
+}
+
+/**
+ * substituteWord, replaces the \!* (every argument), \!^ (the first), \!$ (the last) and \!:n (the nth)
+ *                 in one word of an alias's value with the arguments it was run with, the way tcsh does.
+ *                 Returns NULL with a message if it asks for an argument that isn't there.
+ *
+ * Args: A string, An array of strings, A size_t
+ * Return: A string
+ */
+static char *substituteWord(const char *word, char **args, size_t argc)
+{
+    size_t joined = 0, refs = 0, length = 0, n, part;
+    const char *p, *from, *to;
+    char *result, *end;
+    // Every reference gets room for the longest it can expand to, \!:0 picks args[0] too
+    for (size_t i = 0; i < argc; i++)
+        joined += strlen(args[i]) + 1;
+    for (p = word; (p = strstr(p, "\\!")) != NULL; p += 2)
+        refs++;
+    if ((result = malloc(strlen(word) + refs * (joined + 1) + 1)) == NULL)
+    {
+        perror("alias");
+        return NULL;
+    }
+    for (p = word; *p != '\0';)
+    {
+        if (strncmp(p, "\\!", 2) != 0)
+        {
+            result[length++] = *p++;
+            continue;
+        }
+        from = to = NULL;
+        if (p[2] == '*')
+        {
+            for (size_t i = 1; i < argc; i++)
+            {
+                if (i > 1)
+                    result[length++] = ' ';
+                part = strlen(args[i]);
+                memcpy(result + length, args[i], part);
+                length += part;
+            }
+            p += 3;
+            continue;
+        }
+        if (p[2] == '^' && argc > 1)
+            from = args[1], to = p + 3;
+        else if (p[2] == '$' && argc > 1)
+            from = args[argc - 1], to = p + 3;
+        else if (p[2] == ':' && p[3] >= '0' && p[3] <= '9' && (n = strtoul(p + 3, &end, 10)) < argc)
+            from = args[n], to = end;
+        if (from == NULL)
+        {
+            fprintf(stderr, "Bad ! arg selector.\n");
+            free(result);
+            return NULL;
+        }
+        part = strlen(from);
+        memcpy(result + length, from, part);
+        length += part;
+        p = to;
+    }
+    result[length] = '\0';
+    return result;
+}
+
+/**
+ * substituteAlias, one step of expansion: the alias's value with the arguments substituted in, or
+ *                  appended if the value doesn't refer to them. args[0] is the alias's name. A lone
+ *                  \!* word becomes one word per argument. Returns -1 on a bad selector or no memory.
+ *
+ * Args: A struct, An array of strings, A size_t, A pointer to an array of strings, A pointer to a size_t
+ * Return: An integer
+ */
+static int substituteAlias(struct alias *alias, char **args, size_t argc, char ***result, size_t *count)
+{
+    size_t capacity = 0;
+    int failed = 0;
+    char *word;
+    *result = NULL;
+    *count = 0;
+    for (size_t i = 0; i < alias->count && !failed; i++)
+    {
+        if (strcmp(alias->words[i], "\\!*") == 0)
+        {
+            for (size_t j = 1; j < argc && !failed; j++)
+                failed = pushWord(result, count, &capacity, strdup(args[j])) != 0;
+            continue;
+        }
+        word = alias->argRefs ? substituteWord(alias->words[i], args, argc) : strdup(alias->words[i]);
+        failed = word == NULL || pushWord(result, count, &capacity, word) != 0;
+    }
+    for (size_t j = 1; j < argc && !alias->argRefs && !failed; j++)
+        failed = pushWord(result, count, &capacity, strdup(args[j])) != 0;
+    if (!failed && *result == NULL && (*result = growCommandList(NULL, &capacity, 1)) == NULL)
+        failed = 1;
+    if (failed)
+    {
+        freeWords(*result, *count);
+        *result = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * expandChain, expands a command whose first word is an alias, then the alias that starts the
+ *              result and so on. It stops at a word that isn't an alias or at an alias that starts
+ *              with its own name (alias ls ls -F). Any other alias coming round again, or more than
+ *              ALIAS_DEPTH_MAX in a row, is a loop. Returns -1 with a message on a loop or bad
+ *              selector, else 0 with the words in result.
+ *
+ * Args: A struct, An array of strings, A size_t, A pointer to an array of strings, A pointer to a size_t
+ * Return: An integer
+ */
+static int expandChain(struct alias *alias, char **args, size_t argc, char ***result, size_t *count)
+{
+    const char *seen[ALIAS_DEPTH_MAX];
+    char **current = args, **next;
+    size_t currentCount = argc, nextCount;
+    for (int depth = 0;; depth++)
+    {
+        int looped = depth == ALIAS_DEPTH_MAX;
+        for (int i = 0; i < depth && !looped; i++)
+            looped = strcmp(seen[i], alias->name) == 0;
+        if (looped)
+        {
+            fprintf(stderr, "Alias loop.\n");
+            break;
+        }
+        seen[depth] = alias->name;
+        if (substituteAlias(alias, current, currentCount, &next, &nextCount) != 0)
+            break;
+        if (current != args)
+            freeWords(current, currentCount);
+        current = next;
+        currentCount = nextCount;
+        if (currentCount == 0 || strcmp(current[0], alias->name) == 0 || (alias = findAlias(current[0])) == NULL)
+        {
+            *result = current;
+            *count = currentCount;
+            return 0;
+        }
+    }
+    if (current != args)
+        freeWords(current, currentCount);
+    return -1;
+}
+
+/**
+ * resolveAlias, works out the words an alias's name expands to, kept in resolved for as long as no alias
+ *               changes. It is only kept when no alias on the way takes arguments, expanding the name with
+ *               arguments is then just resolved with the arguments after it.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void resolveAlias(struct alias *alias)
+{
+    struct alias *step = alias;
+    char *name = alias->name;
+    alias->isResolved = 1;
+    for (int depth = 0; step != NULL; depth++)
+    {
+        if (step->argRefs || depth == ALIAS_DEPTH_MAX)
+            return;
+        if (strcmp(step->words[0], step->name) == 0)
+            break;
+        step = findAlias(step->words[0]);
+    }
+    if (expandChain(alias, &name, 1, &alias->resolved, &alias->resolvedCount) != 0)
+        alias->resolved = NULL;
+}
+
+/**
+ * expandCommand, the words a command starting with an alias runs as. Returns 1 with them in result,
+ *                0 if the first word isn't an alias, -1 if the expansion failed.
+ *
+ * Args: An array of strings, A size_t, A pointer to an array of strings, A pointer to a size_t
+ * Return: An integer
+ */
+static int expandCommand(char **words, size_t argc, char ***result, size_t *count)
+{
+    struct alias *alias = findAlias(words[0]);
+    size_t capacity = 0;
+    if (alias == NULL)
+        return 0;
+    if (!alias->isResolved)
+        resolveAlias(alias);
+    if (alias->resolved == NULL)
+        return expandChain(alias, words, argc, result, count) == 0 ? 1 : -1;
+    *result = NULL;
+    *count = 0;
+    for (size_t i = 0; i < alias->resolvedCount + argc - 1; i++)
+    {
+        if (pushWord(result, count, &capacity, strdup(i < alias->resolvedCount ? alias->resolved[i]
+                                                                               : words[i - alias->resolvedCount + 1])) != 0)
+        {
+            freeWords(*result, *count);
+            return -1;
+        }
+    }
+    return 1;
+}
+
+/**
+ * expandAliases, replaces every command in a parsed line that starts with an alias by what the alias
+ *                expands to, before anything looks the command up as a built-in or in PATH. A command
+ *                starts the line or follows ;, &, &&, ||, |, |&, or a ( ) { } group word, and its
+ *                arguments run to the next of those. Lines are only hashed into the alias table at those
+ *                words, and nothing at all is done while there are no aliases. If an expansion fails the
+ *                whole line is dropped and an empty list is returned, like tokenizeLine does. Returns the
+ *                list, which may have moved.
+ *
+ * Args: An array of strings, A pointer to a size_t
+ * Return: An array of strings
+ */
+char **expandAliases(char **commandList, size_t *capacity)
+{
+    int count = 0, end, status;
+    char **words, **grown;
+    size_t expanded;
+    uint64_t aliasStart;
+    if (aliasList.count == 0 || commandList == NULL)
+        return commandList;
+    aliasStart = traceStart();
+    while (commandList[count] != NULL)
+        count++;
+    for (int i = 0; i < count; i++)
+    {
+        if ((i > 0 && !isSeparator(commandList[i - 1])) || isSeparator(commandList[i]))
+            continue;
+        for (end = i + 1; end < count && !isSeparator(commandList[end]); end++);
+        if ((status = expandCommand(commandList + i, end - i, &words, &expanded)) == 0)
+            continue;
+        grown = status > 0 ? growCommandList(commandList, capacity, count - (end - i) + expanded + 1) : NULL;
+        if (grown == NULL)
+        {
+            if (status > 0)
+                freeWords(words, expanded);
+            while (count > 0)
+                free(commandList[--count]);
+            commandList[0] = NULL;
+            break;
+        }
+        commandList = grown;
+        for (int j = i; j < end; j++)
+            free(commandList[j]);
+        memmove(commandList + i + expanded, commandList + end, (count - end + 1) * sizeof(char *));
+        memcpy(commandList + i, words, expanded * sizeof(char *));
+        free(words);
+        count = count - (end - i) + (int)expanded;
+        i += (int)expanded - 1; // Go on after it, what an alias expands to isn't looked up again
+    }
+    traceEnd("alias", aliasStart, count > 0 ? commandList[0] : NULL);
+    return commandList;
+}
+
+/**
+ * compareAliases, qsort comparison of two aliases by name.
+ *
+ * Args: Two pointers
+ * Return: An integer
+ */
+static int compareAliases(const void *a, const void *b)
+{
+    return strcmp((*(struct alias **)a)->name, (*(struct alias **)b)->name);
+}
+
+/**
+ * printAlias, prints an alias's value, in parentheses after its name if withName is set and
+ *             it is more than one word, like tcsh.
+ *
+ * Args: A struct, An integer
+ * Return: Nothing
+ */
+static void printAlias(struct alias *alias, int withName)
+{
+    size_t length = 0;
+    char *value;
+    for (size_t i = 0; i < alias->count; i++)
+        length += strlen(alias->words[i]) + 1;
+    if ((value = malloc(length + 1)) == NULL)
+    {
+        perror("alias");
+        return;
+    }
+    length = 0;
+    for (size_t i = 0; i < alias->count; i++)
+        length += sprintf(value + length, i > 0 ? " %s" : "%s", alias->words[i]);
+    if (outputJson)
+        outRecord("alias", "name:s value:s", alias->name, value);
+    else if (!withName)
+        outPrintf("%s\n", value);
+    else
+        outPrintf(alias->count > 1 ? "%s\t(%s)\n" : "%s\t%s\n", alias->name, value);
+    free(value);
+}
+
+/**
+ * setAlias, the alias builtin. "alias" lists every alias by name, "alias name" prints one and
+ *           "alias name words..." makes name run the words, with \!* and the like in them standing
+ *           for the arguments it is run with.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void setAlias(char **commandList)
+{
+    struct alias *alias, **sorted;
+    char **words;
+    size_t count = 0, capacity = 0;
+    if (commandList[1] == NULL)
+    {
+        if ((sorted = malloc((aliasList.count + 1) * sizeof(struct alias *))) == NULL)
+        {
+            perror("alias");
+            return;
+        }
+        for (size_t i = 0; i < aliasList.count; i++)
+            sorted[i] = &VECTOR_AT(aliasList, struct alias, i);
+        qsort(sorted, aliasList.count, sizeof(struct alias *), compareAliases);
+        for (size_t i = 0; i < aliasList.count; i++)
+            printAlias(sorted[i], 1);
+        free(sorted);
+        return;
+    }
+    if (commandList[2] == NULL)
+    {
+        if ((alias = findAlias(commandList[1])) != NULL)
+            printAlias(alias, 0);
+        return;
+    }
+    if (strcmp(commandList[1], "alias") == 0 || strcmp(commandList[1], "unalias") == 0)
+    {
+        fprintf(stderr, "%s: Too dangerous to alias that.\n", commandList[1]);
+        lastExitStatus = 1;
+        return;
+    }
+    words = NULL;
+    for (int i = 2; commandList[i] != NULL; i++)
+    {
+        if (pushWord(&words, &count, &capacity, strdup(commandList[i])) != 0)
+        {
+            perror("alias");
+            freeWords(words, count);
+            return;
+        }
+    }
+    forgetResolved();
+    if ((alias = findAlias(commandList[1])) != NULL)
+        freeWords(alias->words, alias->count);
+    else if ((alias = vectorPush(&aliasList)) == NULL || (alias->name = strdup(commandList[1])) == NULL ||
+             mapInsert(&aliasIndex, alias->name, aliasList.count - 1) != 0)
+    {
+        perror("alias");
+        if (alias != NULL)
+        {
+            free(alias->name);
+            aliasList.count--;
+        }
+        freeWords(words, count);
+        return;
+    }
+    alias->words = words;
+    alias->count = count;
+    alias->argRefs = 0;
+    for (size_t i = 0; i < count; i++)
+        alias->argRefs |= strstr(words[i], "\\!") != NULL;
+}
+
+/**
+ * removeAlias, the unalias builtin, removes each alias named. The last alias takes its place
+ *              in the list.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void removeAlias(char **commandList)
+{
+    size_t *found, index;
+    if (commandList[1] == NULL)
+    {
+        fprintf(stderr, " unalias: Too few arguments.\n");
+        lastExitStatus = 1;
+        return;
+    }
+    forgetResolved();
+    for (int i = 1; commandList[i] != NULL; i++)
+    {
+        if ((found = aliasList.count > 0 ? mapFind(&aliasIndex, commandList[i]) : NULL) == NULL)
+            continue;
+        index = *found;
+        struct alias *alias = &VECTOR_AT(aliasList, struct alias, index);
+        mapRemove(&aliasIndex, alias->name);
+        free(alias->name);
+        freeWords(alias->words, alias->count);
+        if (vectorRemove(&aliasList, index) != index)
+            *mapFind(&aliasIndex, VECTOR_AT(aliasList, struct alias, index).name) = index;
+    }
+}
+
+/**
+ * freeAliases, frees every alias.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeAliases()
+{
+    forgetResolved();
+    for (size_t i = 0; i < aliasList.count; i++)
+    {
+        free(VECTOR_AT(aliasList, struct alias, i).name);
+        freeWords(VECTOR_AT(aliasList, struct alias, i).words, VECTOR_AT(aliasList, struct alias, i).count);
+    }
+    vectorFree(&aliasList);
+    mapFree(&aliasIndex);
+}
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef ALIAS_H
+#define ALIAS_H
+
+// alias definitions
+#define ALIAS_DEPTH_MAX 20        // Aliases expanded one into the next before it is called a loop
+
+/* One alias. The value is split into words when it is defined, and what the name finally
+   expands to through other aliases is worked out once and kept until any alias changes. */
+struct alias {
+    char *name;
+    char **words;             // The value
+    size_t count;
+    int argRefs;              // The value has \!* or the like, so arguments aren't just appended
+    int isResolved;           // resolved has been worked out, it stays NULL if it can't be kept
+    char **resolved;          // The words before the arguments, when no alias on the way has argRefs
+    size_t resolvedCount;
+};
+
+extern struct vector aliasList;      /* of struct alias, in the order they were made */
+
+char **expandAliases(char **commandList, size_t *capacity);
+void setAlias(char **commandList);
+void removeAlias(char **commandList);
+void freeAliases();
+
+#endif
@@ -0,0 +1,310 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Batch globals
+static volatile sig_atomic_t batchInterrupted = 0;
+static struct sigaction shellInterrupt;   // The shell's SIGINT handling, put back in each worker
+
+/**
+ * batchInterruptHandler, callback for SIGINT and SIGTERM while a batch runs. runBatch passes it on to the
+ *                        running lines and starts no more.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+static void batchInterruptHandler(int signal)
+{
+    batchInterrupted = 1;
+}
+
+/**
+ * now, the monotonic clock in nanoseconds.
+ *
+ * Args: Nothing
+ * Return: An unsigned 64 bit integer
+ */
+static uint64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * isBatchRun, whether sssh was started as a batch runner with --jobs.
+ *
+ * Args: An integer, An array of strings
+ * Return: An integer
+ */
+int isBatchRun(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--jobs") == 0)
+            return 1;
+    return 0;
+}
+
+/**
+ * loadBatchFile, reads a job file into a list, one job per line. Blank lines and lines starting with # are
+ *                skipped. Returns NULL if the file can't be read or has no jobs.
+ *
+ * Args: A string
+ * Return: A struct
+ */
+static struct batchjob *loadBatchFile(const char *path)
+{
+    struct batchjob *head = NULL, **tail = &head, *job;
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "re");
+    char *line = NULL, *start;
+    size_t size = 0;
+    ssize_t length;
+    int number = 0;
+    if (file == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+    while ((length = getline(&line, &size, file)) >= 0)
+    {
+        number++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        for (start = line; *start == ' ' || *start == '\t'; start++);
+        if (*start == '\0' || *start == '#')
+            continue;
+        if ((job = calloc(1, sizeof(struct batchjob))) == NULL || (job->command = strdup(start)) == NULL)
+        {
+            free(job);
+            perror("batch");
+            break;
+        }
+        job->line = number;
+        job->output = -1;
+        *tail = job;
+        tail = &job->next;
+    }
+    free(line);
+    if (file != stdin)
+        fclose(file);
+    return head;
+}
+
+/**
+ * runBatchWorker, the forked worker for one line. It is a background subshell with stdin from /dev/null and
+ *                 stdout and stderr in the line's memfd, and runs the line through parseBuffer and runCommandLine
+ *                 exactly as if it were typed. The foreground job timeout is off, batch jobs run until done.
+ *
+ * Args: A struct, An array of strings
+ * Return: Nothing
+ */
+static void runBatchWorker(struct batchjob *job, char **argv)
+{
+    char **commandList;
+    int input = open("/dev/null", O_RDONLY);
+    sigaction(SIGINT, &shellInterrupt, NULL);
+    signal(SIGTERM, SIG_IGN);
+    if (input >= 0)
+    {
+        dup2(input, STDIN_FILENO);
+        close(input);
+    }
+    dup2(job->output, STDOUT_FILENO);
+    dup2(job->output, STDERR_FILENO);
+    enterSubshell(0);
+    inSubshell = 1;
+    threadExists = 0;
+    announceCommands = 0;
+    jobTimeout = 0;
+    commandList = growCommandList(NULL, &commandCapacity, ARGV_INITIAL);
+    if (commandList != NULL && (commandList = parseBuffer(job->command, commandList)) != NULL && commandList[0] != NULL)
+        runCommandLine(commandList, argv);
+    outFlush();
+    fflush(stdout);
+    fflush(stderr);
+    _exit(lastExitStatus);
+}
+
+/**
+ * startBatchJob, forks a worker for the next line. Returns -1 if it couldn't, the line then counts as failed.
+ *
+ * Args: A struct, An array of strings
+ * Return: An integer
+ */
+static int startBatchJob(struct batchjob *job, char **argv)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "sssh-batch-%d", job->line);
+    job->start = now();
+    job->state = BATCH_RUNNING;
+    if ((job->output = memfd_create(name, MFD_CLOEXEC)) < 0 || (job->pid = fork()) < 0)
+    {
+        perror("batch");
+        job->state = BATCH_DONE;
+        job->end = job->start;
+        job->exitStatus = 127;
+        return -1;
+    }
+    if (job->pid == 0)
+        runBatchWorker(job, argv);
+    setpgid(job->pid, job->pid);
+    return 0;
+}
+
+/**
+ * reportBatchJob, prints one finished line's header and the output it captured.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void reportBatchJob(struct batchjob *job)
+{
+    off_t offset = 0, length = job->output >= 0 ? lseek(job->output, 0, SEEK_END) : 0;
+    char buffer[OUTPUT_BLOCK_SIZE];
+    ssize_t got;
+    outPrintf("==> line %d: %s %d, %.3fs: %s\n", job->line, job->exitStatus > 128 ? "signal" : "exit",
+              job->exitStatus > 128 ? job->exitStatus - 128 : job->exitStatus, (job->end - job->start) / 1e9, job->command);
+    outFlush();
+    while (offset < length && sendfile(STDOUT_FILENO, job->output, &offset, length - offset) > 0);
+    // sendfile won't write to a file opened for appending, copy the rest by hand
+    while (offset < length && (got = pread(job->output, buffer, sizeof(buffer), offset)) > 0 && write(STDOUT_FILENO, buffer, got) == got)
+        offset += got;
+    if (job->output >= 0)
+        close(job->output);
+    job->output = -1;
+}
+
+/**
+ * findBatchJob, finds the running line whose worker has this pid. Returns NULL if not found.
+ *
+ * Args: A struct, A pid_t
+ * Return: A struct
+ */
+static struct batchjob *findBatchJob(struct batchjob *head, pid_t pid)
+{
+    for (struct batchjob *job = head; job != NULL; job = job->next)
+        if (job->state == BATCH_RUNNING && job->pid == pid)
+            return job;
+    return NULL;
+}
+
+/**
+ * runBatch, sssh --jobs FILE [-P N]. Runs each line of the job file as its own command line with up to N at once
+ *           (the number of CPUs by default). Every worker that finishes takes the next line off the file right away,
+ *           so a long line never holds up the others. Each line's exit status, run time and output go into a report
+ *           on stdout, in file order, printed as soon as a line and all those before it are done. Ctrl+C interrupts
+ *           the running lines and starts no more. Returns 0 if every line exited 0, 1 if any didn't, 2 on bad usage.
+ *
+ * Args: An integer, An array of strings
+ * Return: An integer
+ */
+int runBatch(int argc, char **argv)
+{
+    struct batchjob *head, *next, *report, *job;
+    struct sigaction action;
+    const char *path = NULL;
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    int running = 0, total = 0, failed = 0, skipped = 0, signalled = 0, status;
+    char *end;
+    pid_t pid;
+    uint64_t batchStart = now();
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+            path = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0)
+            continue; // Taken by main
+        else if (strncmp(argv[i], "-P", 2) == 0 && (argv[i][2] != '\0' || i + 1 < argc))
+        {
+            workers = strtol(argv[i][2] != '\0' ? argv[i] + 2 : argv[++i], &end, 10);
+            if (*end != '\0' || workers < 1)
+                path = NULL, i = argc;
+        }
+        else
+            path = NULL, i = argc;
+    }
+    if (path == NULL)
+    {
+        fprintf(stderr, "usage: %s --jobs FILE [-P WORKERS]\n", argv[0]);
+        return 2;
+    }
+    if ((head = loadBatchFile(path)) == NULL)
+        return 1;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = batchInterruptHandler; // No SA_RESTART, waitpid has to return to see it
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &shellInterrupt);
+    sigaction(SIGTERM, &action, NULL);
+    outFlush();
+    fflush(stdout);
+    next = report = head;
+    while (report != NULL)
+    {
+        while (!batchInterrupted && next != NULL && running < workers)
+        {
+            total++;
+            running += startBatchJob(next, argv) == 0;
+            next = next->next;
+        }
+        while (report != NULL && report->state == BATCH_DONE)
+        {
+            failed += report->exitStatus != 0;
+            reportBatchJob(report);
+            report = report->next;
+        }
+        if (running == 0)
+        {
+            skipped = 0;
+            for (job = report; job != NULL; job = job->next)
+                skipped++;
+            break;
+        }
+        // Checked every time round, the signal may have come while starting or reporting a line. The
+        // workers are in their own groups, out of reach of the terminal's ^C, so they are told once here
+        if (batchInterrupted && !signalled)
+        {
+            for (job = head; job != NULL; job = job->next)
+                if (job->state == BATCH_RUNNING)
+                    kill(-job->pid, SIGINT);
+            signalled = 1;
+        }
+        if ((pid = waitpid(-1, &status, 0)) < 0)
+        {
+            if (errno != EINTR)
+            {
+                perror("waitpid error");
+                break;
+            }
+            continue;
+        }
+        if ((job = findBatchJob(head, pid)) == NULL)
+            continue;
+        job->end = now();
+        job->state = BATCH_DONE;
+        job->exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        running--;
+    }
+    outPrintf("==> %d of %d lines failed%s, %.3fs with %ld workers", failed, total, batchInterrupted ? " (interrupted)" : "",
+              (now() - batchStart) / 1e9, workers);
+    if (skipped > 0)
+        outPrintf(", %d not run", skipped);
+    outPrintf("\n");
+    outFlush();
+    while (head != NULL)
+    {
+        job = head->next;
+        if (head->output >= 0)
+            close(head->output);
+        free(head->command);
+        free(head);
+        head = job;
+    }
+    sigaction(SIGINT, &shellInterrupt, NULL);
+    return failed > 0 || skipped > 0 ? 1 : 0;
+}
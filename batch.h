@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+// batch runner definitions
+#define BATCH_PENDING 0
+#define BATCH_RUNNING 1
+#define BATCH_DONE 2
+
+/* One line of a job file. Its stdout and stderr go to a memfd, printed in the
+   report once it and every line before it have finished. */
+struct batchjob {
+    int line;                 // Line number in the job file
+    char *command;
+    int state;                // BATCH_PENDING, BATCH_RUNNING or BATCH_DONE
+    pid_t pid;
+    int output;               // memfd holding what it wrote, -1 once reported
+    uint64_t start;           // Monotonic nanoseconds
+    uint64_t end;
+    int exitStatus;
+    struct batchjob *next;
+};
+
+int isBatchRun(int argc, char **argv);
+int runBatch(int argc, char **argv);
+
+#endif
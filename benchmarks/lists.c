@@ -0,0 +1,171 @@
+#undef main // The shell's own main is renamed with -Dmain=ssshMain, this is the benchmark's
+#include "../sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Benchmark definitions
+#define BENCH_FIND_ROUNDS 16      // Times every name is looked up, half of them misses
+
+/* A watched user as lists.c kept them before the vector, for comparison. */
+struct listuser {
+    int isLoggedOn;
+    char *username;
+    struct listuser *next;
+};
+
+static struct listuser *listHead = NULL;
+
+/**
+ * listAdd, the old addUser: walks to the tail and appends a copy of the name.
+ *
+ * Args: A string
+ * Return: A struct
+ */
+static struct listuser *listAdd(const char *username)
+{
+    struct listuser **tracker = &listHead, *newNode;
+    while (*tracker)
+        tracker = &(*tracker)->next;
+    if ((newNode = calloc(1, sizeof(struct listuser))) == NULL)
+        return NULL;
+    newNode->username = strdup(username);
+    *tracker = newNode;
+    return newNode;
+}
+
+/**
+ * listFind, the old findUser: a strcmp on every node until the name turns up.
+ *
+ * Args: A string
+ * Return: A struct
+ */
+static struct listuser *listFind(const char *username)
+{
+    for (struct listuser *node = listHead; node != NULL; node = node->next)
+        if (strcmp(username, node->username) == 0)
+            return node;
+    return NULL;
+}
+
+/**
+ * listRemove, the old removeUser: unlinks and frees the node with that name.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+static int listRemove(const char *username)
+{
+    for (struct listuser **tracker = &listHead; *tracker; tracker = &(*tracker)->next)
+        if (strcmp(username, (*tracker)->username) == 0)
+        {
+            struct listuser *removed = *tracker;
+            *tracker = removed->next;
+            free(removed->username);
+            free(removed);
+            return 0;
+        }
+    return -1;
+}
+
+/**
+ * now, the monotonic clock in seconds.
+ *
+ * Args: Nothing
+ * Return: A double
+ */
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * runSize, times adding count users, looking every one up BENCH_FIND_ROUNDS times along with as
+ *          many names that aren't watched, and removing them all newest first, first with the linked
+ *          list and then with userList. Prints nanoseconds per operation for each.
+ *
+ * Args: A size_t
+ * Return: An integer
+ */
+static int runSize(size_t count)
+{
+    char **names = calloc(count * 2, sizeof(char *));
+    double start, list[3], vector[3];
+    size_t found = 0;
+    if (names == NULL)
+        return -1;
+    for (size_t i = 0; i < count * 2; i++)
+        if (asprintf(&names[i], "%s%06zu", i < count ? "user" : "nobody", i) < 0)
+            names[i] = NULL;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        listAdd(names[i]);
+    list[0] = now() - start;
+    start = now();
+    for (int round = 0; round < BENCH_FIND_ROUNDS; round++)
+        for (size_t i = 0; i < count * 2; i++)
+            found += listFind(names[i]) != NULL;
+    list[1] = now() - start;
+    start = now();
+    for (size_t i = count; i-- > 0;)
+        listRemove(names[i]);
+    list[2] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        addUser(strdup(names[i]));
+    vector[0] = now() - start;
+    start = now();
+    for (int round = 0; round < BENCH_FIND_ROUNDS; round++)
+        for (size_t i = 0; i < count * 2; i++)
+            found += findUser(names[i]) != NULL;
+    vector[1] = now() - start;
+    start = now();
+    for (size_t i = count; i-- > 0;)
+        removeUser(names[i]);
+    vector[2] = now() - start;
+
+    printf("%6zu users  list: add %8.1f find %8.1f remove %8.1f ns  vector/map: add %6.1f find %6.1f remove %6.1f ns%s\n",
+           count, list[0] * 1e9 / count, list[1] * 1e9 / (count * 2 * BENCH_FIND_ROUNDS), list[2] * 1e9 / count,
+           vector[0] * 1e9 / count, vector[1] * 1e9 / (count * 2 * BENCH_FIND_ROUNDS), vector[2] * 1e9 / count,
+           found == count * 2 * BENCH_FIND_ROUNDS ? "" : "  (lookups disagree)");
+    for (size_t i = 0; i < count * 2; i++)
+        free(names[i]);
+    free(names);
+    freeUsers();
+    return 0;
+}
+
+/**
+ * main, compares the old linked list of watched users with userList and its stringmap at a few
+ *       sizes, from a handful of users to thousands. "lists-bench N..." runs only the sizes given.
+ *
+ * Args: An integer, An array of strings
+ * Return: An integer
+ */
+int main(int argc, char **argv)
+{
+    size_t sizes[] = {8, 64, 512, 4096};
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+            if (atol(argv[i]) <= 0 || runSize(atol(argv[i])) != 0)
+                return 1;
+    }
+    else
+    {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+            if (runSize(sizes[i]) != 0)
+                return 1;
+    }
+    freeStrings();
+    return 0;
+}
@@ -0,0 +1,418 @@
+#include "complete.h"
+#include "lists.h"
+#include "jobs.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Completion globals
+static struct dirlisting listingCache[LISTING_CACHE_SIZE];
+static unsigned long useCounter = 0;
+static pthread_mutex_t listingLock = PTHREAD_MUTEX_INITIALIZER;
+static char **builtInNames = NULL;     // Sorted copy of the built-in commands
+static size_t builtInCount = 0;
+
+/**
+ * compareNames, qsort/bsearch comparison for arrays of strings.
+ *
+ * Args: Two pointers to strings
+ * Return: An integer
+ */
+static int compareNames(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * prefixRange, finds the run of names starting with prefix in a sorted array using two binary
+ *              searches. Sets first to the start of the run and returns its length.
+ *
+ * Args: An array of strings, An integer, A string, A pointer to an integer
+ * Return: An integer
+ */
+static size_t prefixRange(char **names, size_t count, const char *prefix, size_t *first)
+{
+    size_t length = strlen(prefix), low = 0, high = count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (strncmp(names[middle], prefix, length) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    *first = low;
+    high = count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (strncmp(names[middle], prefix, length) <= 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low - *first;
+}
+
+/**
+ * commonLength, length of the common prefix of two strings.
+ *
+ * Args: Two strings
+ * Return: An integer
+ */
+static size_t commonLength(const char *a, const char *b)
+{
+    size_t i = 0;
+    while (a[i] != '\0' && a[i] == b[i])
+        i++;
+    return i;
+}
+
+/**
+ * freeListing, releases the names held by a cache slot and marks it empty.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void freeListing(struct dirlisting *listing)
+{
+    free(listing->names);
+    free(listing->pool);
+    memset(listing, 0, sizeof(struct dirlisting));
+}
+
+/**
+ * buildListing, reads the directory open on fd into the slot given. When executablesOnly is set
+ *               only regular files we may execute are kept. Consumes fd.
+ *
+ * Args: A struct, An integer, An integer
+ * Return: An integer, 0 on success, -1 on failure
+ */
+static int buildListing(struct dirlisting *listing, int fd, int executablesOnly)
+{
+    DIR *dp;
+    struct dirent *dirp;
+    struct stat st;
+    size_t poolUsed = 0, poolSize = 4096, count = 0;
+    size_t *offsets = NULL, offsetsSize = 0;
+    char *pool = malloc(poolSize);
+    if (pool == NULL || (dp = fdopendir(fd)) == NULL)
+    {
+        free(pool);
+        close(fd);
+        return -1;
+    }
+    while ((dirp = readdir(dp)) != NULL)
+    {
+        if (strcmp(dirp->d_name, ".") == 0 || strcmp(dirp->d_name, "..") == 0)
+            continue;
+        if (executablesOnly)
+        {
+            if (dirp->d_type == DT_DIR || faccessat(fd, dirp->d_name, X_OK, AT_EACCESS) != 0)
+                continue;
+            if (dirp->d_type != DT_REG && (fstatat(fd, dirp->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode)))
+                continue;
+        }
+        size_t length = strlen(dirp->d_name) + 1;
+        if (poolUsed + length > poolSize)
+        {
+            while (poolUsed + length > poolSize)
+                poolSize *= 2;
+            char *grown = realloc(pool, poolSize);
+            if (grown == NULL)
+                break;
+            pool = grown;
+        }
+        if (count == offsetsSize)
+        {
+            size_t *grown = realloc(offsets, (offsetsSize ? offsetsSize * 2 : 256) * sizeof(size_t));
+            if (grown == NULL)
+                break;
+            offsets = grown;
+            offsetsSize = offsetsSize ? offsetsSize * 2 : 256;
+        }
+        memcpy(pool + poolUsed, dirp->d_name, length);
+        offsets[count++] = poolUsed;
+        poolUsed += length;
+    }
+    closedir(dp);
+    // Offsets are only turned into pointers once the pool has stopped moving
+    listing->names = malloc((count ? count : 1) * sizeof(char *));
+    if (listing->names == NULL)
+    {
+        free(offsets);
+        free(pool);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++)
+        listing->names[i] = pool + offsets[i];
+    free(offsets);
+    qsort(listing->names, count, sizeof(char *), compareNames);
+    listing->pool = pool;
+    listing->count = count;
+    listing->executablesOnly = executablesOnly;
+    return 0;
+}
+
+/**
+ * getListing, returns the cached listing of the directory open on fd, rebuilding it if the
+ *             directory changed since it was read. The least recently used slot is recycled
+ *             when the cache is full. Must be called with listingLock held. Consumes fd.
+ *
+ * Args: An integer, An integer
+ * Return: A struct, NULL if the directory can't be read
+ */
+static struct dirlisting *getListing(int fd, int executablesOnly)
+{
+    struct stat st;
+    struct dirlisting *slot = &listingCache[0];
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    for (int i = 0; i < LISTING_CACHE_SIZE; i++)
+    {
+        struct dirlisting *listing = &listingCache[i];
+        if (listing->names != NULL && listing->device == st.st_dev && listing->inode == st.st_ino &&
+            listing->executablesOnly == executablesOnly)
+        {
+            if (listing->mtime.tv_sec == st.st_mtim.tv_sec && listing->mtime.tv_nsec == st.st_mtim.tv_nsec)
+            {
+                close(fd);
+                listing->lastUsed = ++useCounter;
+                return listing;
+            }
+            slot = listing;
+            break;
+        }
+        if (listing->lastUsed < slot->lastUsed)
+            slot = listing;
+    }
+    freeListing(slot);
+    if (buildListing(slot, fd, executablesOnly) != 0)
+        return NULL;
+    slot->device = st.st_dev;
+    slot->inode = st.st_ino;
+    slot->mtime = st.st_mtim;
+    slot->lastUsed = ++useCounter;
+    return slot;
+}
+
+/**
+ * addSource, folds the names in a sorted array that start with prefix into the result. The
+ *            common prefix of a sorted run is the common prefix of its first and last names,
+ *            so this stays cheap no matter how many names match.
+ *
+ * Args: A struct, An array of strings, An integer, A string, A string
+ * Return: Nothing
+ */
+static void addSource(struct completion *result, char **names, size_t count, const char *prefix, const char *dirPart)
+{
+    size_t first, matches = prefixRange(names, count, prefix, &first);
+    if (matches == 0)
+        return;
+    size_t dirLength = strlen(dirPart), runLength = commonLength(names[first], names[first + matches - 1]);
+    if (result->common == NULL)
+    {
+        result->common = malloc(dirLength + runLength + 1);
+        memcpy(result->common, dirPart, dirLength);
+        memcpy(result->common + dirLength, names[first], runLength);
+        result->common[dirLength + runLength] = '\0';
+    }
+    else
+    {
+        size_t keep = commonLength(result->common + dirLength, names[first]);
+        if (keep < runLength)
+            runLength = keep;
+        if (dirLength + runLength < strlen(result->common))
+            result->common[dirLength + runLength] = '\0';
+    }
+    result->total += matches;
+    if (result->total > COMPLETION_LIST_MAX)
+        return;
+    char **grown = realloc(result->shown, result->total * sizeof(char *));
+    if (grown == NULL)
+        return;
+    result->shown = grown;
+    for (size_t i = 0; i < matches; i++)
+        result->shown[result->shownCount++] = strdup(names[first + i]);
+}
+
+/**
+ * uniqueShown, sorts the listed matches and drops names that came from more than one source,
+ *              like a builtin that also exists in PATH.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void uniqueShown(struct completion *result)
+{
+    size_t kept = 0;
+    if (result->total > COMPLETION_LIST_MAX || result->shownCount == 0)
+        return;
+    qsort(result->shown, result->shownCount, sizeof(char *), compareNames);
+    for (size_t i = 0; i < result->shownCount; i++)
+    {
+        if (kept > 0 && strcmp(result->shown[kept - 1], result->shown[i]) == 0)
+            free(result->shown[i]);
+        else
+            result->shown[kept++] = result->shown[i];
+    }
+    result->shownCount = result->total = kept;
+}
+
+/**
+ * initCompletion, keeps a sorted copy of the built-in command names so they can be
+ *                 completed alongside the PATH executables.
+ *
+ * Args: An array of strings, An integer
+ * Return: Nothing
+ */
+void initCompletion(const char **builtIns, int count)
+{
+    builtInNames = malloc(count * sizeof(char *));
+    for (int i = 0; i < count; i++)
+        builtInNames[i] = (char *)builtIns[i];
+    builtInCount = count;
+    qsort(builtInNames, builtInCount, sizeof(char *), compareNames);
+}
+
+/**
+ * warmCommandCallback, pthread callback that reads every PATH directory into the listing cache
+ *                      so the first tab press doesn't pay for it. Gets its own copy of the dir
+ *                      names since the PATH list can change under it.
+ *
+ * Args: A NULL terminated array of strings
+ * Return: Nothing
+ */
+static void *warmCommandCallback(void *callbackArgs)
+{
+    char **dirs = (char **)callbackArgs;
+    blockSignalsInThread();
+    for (int i = 0; dirs[i] != NULL; i++)
+    {
+        int fd = open(dirs[i], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            pthread_mutex_lock(&listingLock);
+            getListing(fd, 1);
+            pthread_mutex_unlock(&listingLock);
+        }
+        free(dirs[i]);
+    }
+    free(dirs);
+    return NULL;
+}
+
+/**
+ * warmCommandIndex, builds the command index for the current PATH in a background thread.
+ *                   Directories whose listing is already cached and unchanged are skipped.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void warmCommandIndex()
+{
+    pthread_t warmID;
+    char **dirs = calloc(pathList.count + 1, sizeof(char *));
+    for (size_t i = 0; i < pathList.count; i++)
+        dirs[i] = strdup(VECTOR_AT(pathList, struct pathelement, i).element);
+    if (pthread_create(&warmID, NULL, warmCommandCallback, dirs) != 0)
+    {
+        warmCommandCallback(dirs);
+        return;
+    }
+    pthread_detach(warmID);
+}
+
+/**
+ * findCompletions, fills in result with the ways word can be completed. In command position
+ *                  the builtins and PATH executables are searched, otherwise (or if the word has
+ *                  a '/') the files in the directory the word points into. Hidden files only
+ *                  show up when the word itself starts with a '.'.
+ *
+ * Args: A string, An integer, A struct
+ * Return: Nothing
+ */
+void findCompletions(const char *word, int commandPosition, struct completion *result)
+{
+    struct dirlisting *listing;
+    memset(result, 0, sizeof(struct completion));
+    pthread_mutex_lock(&listingLock);
+    if (commandPosition && strchr(word, '/') == NULL)
+    {
+        addSource(result, builtInNames, builtInCount, word, "");
+        for (size_t i = 0; i < pathList.count; i++)
+            if ((listing = getListing(openPathDir(&VECTOR_AT(pathList, struct pathelement, i)), 1)) != NULL)
+                addSource(result, listing->names, listing->count, word, "");
+    }
+    else
+    {
+        const char *slash = strrchr(word, '/');
+        char *dirPart = slash ? strndup(word, slash - word + 1) : strdup("");
+        const char *prefix = slash ? slash + 1 : word;
+        int fd = open(dirPart[0] ? dirPart : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0 && (listing = getListing(fd, 0)) != NULL)
+        {
+            size_t hiddenStart, hidden = 0;
+            // Only an empty prefix can match hidden files without asking for them, skip their run
+            if (prefix[0] == '\0')
+                hidden = prefixRange(listing->names, listing->count, ".", &hiddenStart);
+            if (hidden > 0)
+            {
+                addSource(result, listing->names, hiddenStart, prefix, dirPart);
+                addSource(result, listing->names + hiddenStart + hidden, listing->count - hiddenStart - hidden, prefix, dirPart);
+            }
+            else
+            {
+                addSource(result, listing->names, listing->count, prefix, dirPart);
+            }
+        }
+        if (result->total == 1)
+        {
+            struct stat st;
+            result->isDirectory = stat(result->common, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        free(dirPart);
+    }
+    pthread_mutex_unlock(&listingLock);
+    uniqueShown(result);
+}
+
+/**
+ * freeCompletionResult, frees what findCompletions allocated.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+void freeCompletionResult(struct completion *result)
+{
+    for (size_t i = 0; i < result->shownCount; i++)
+        free(result->shown[i]);
+    free(result->shown);
+    free(result->common);
+    memset(result, 0, sizeof(struct completion));
+}
+
+/**
+ * freeCompletionCache, frees every cached listing and the builtin names.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeCompletionCache()
+{
+    pthread_mutex_lock(&listingLock);
+    for (int i = 0; i < LISTING_CACHE_SIZE; i++)
+        freeListing(&listingCache[i]);
+    pthread_mutex_unlock(&listingLock);
+    free(builtInNames);
+    builtInNames = NULL;
+    builtInCount = 0;
+}
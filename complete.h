@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef COMPLETE_H
+#define COMPLETE_H
+
+// completion definitions
+#define LISTING_CACHE_SIZE 64     // Directory listings kept in memory at once
+#define COMPLETION_LIST_MAX 200   // More matches than this are counted, not listed
+
+/* A sorted snapshot of one directory. Names live in one pool so a directory
+   with a million files is two allocations, not a million. The listing is
+   reused until the directory's mtime changes. */
+struct dirlisting {
+    dev_t device;
+    ino_t inode;
+    struct timespec mtime;
+    int executablesOnly;      // 1 for PATH dirs, only executables are kept
+    char **names;             // Sorted, points into pool
+    size_t count;
+    char *pool;
+    unsigned long lastUsed;   // For evicting the least recently used listing
+};
+
+/* The answer to one tab press. common is what the word can be replaced
+   with, shown holds the matches to list when there is more than one. */
+struct completion {
+    char *common;
+    char **shown;
+    size_t shownCount;
+    size_t total;
+    int isDirectory;          // The only match is a directory
+};
+
+void initCompletion(const char **builtIns, int count);
+void warmCommandIndex();
+void findCompletions(const char *word, int commandPosition, struct completion *result);
+void freeCompletionResult(struct completion *result);
+void freeCompletionCache();
+
+#endif
@@ -0,0 +1,582 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Directory globals
+static char *currentDir = NULL;           // Kept up to date by changeTo so nothing else calls getcwd
+static struct dirnode *dirStack = NULL;   // pushd/popd, the current directory is not on it
+static struct dirrank *ranks = NULL;      // The z database, loaded on first use
+static size_t rankCount = 0, rankCapacity = 0;
+static int ranksLoaded = 0, ranksChanged = 0;
+static time_t sortTime;                   // "now" for compareRanks
+
+/**
+ * currentDirectory, the shell's working directory, without a getcwd call every time.
+ *
+ * Args: Nothing
+ * Return: A string
+ */
+const char *currentDirectory()
+{
+    if (currentDir == NULL)
+        currentDir = getcwd(NULL, 0);
+    return currentDir != NULL ? currentDir : "";
+}
+
+/**
+ * databasePath, where the z database lives: $SSSH_DIRS, or DIRS_FILE in $HOME. Free it.
+ *
+ * Args: Nothing
+ * Return: A string
+ */
+static char *databasePath()
+{
+    char *file = getEnvVar("SSSH_DIRS"), *home = getEnvVar("HOME"), *path;
+    if (file != NULL && file[0] != '\0')
+        return strdup(file);
+    if (home == NULL || (path = malloc(strlen(home) + strlen(DIRS_FILE) + 2)) == NULL)
+        return NULL;
+    sprintf(path, "%s/%s", home, DIRS_FILE);
+    return path;
+}
+
+/**
+ * addRank, appends a directory to the database, growing it as needed. Takes over path.
+ *
+ * Args: A string, A double, A 64 bit integer
+ * Return: A struct
+ */
+static struct dirrank *addRank(char *path, double rank, int64_t lastVisit)
+{
+    size_t capacity = rankCapacity > 0 ? rankCapacity * 2 : DIRS_INITIAL;
+    struct dirrank *grown;
+    if (path == NULL)
+        return NULL;
+    if (rankCount == rankCapacity)
+    {
+        if ((grown = realloc(ranks, capacity * sizeof(struct dirrank))) == NULL)
+        {
+            free(path);
+            return NULL;
+        }
+        ranks = grown;
+        rankCapacity = capacity;
+    }
+    ranks[rankCount].path = path;
+    ranks[rankCount].rank = rank;
+    ranks[rankCount].lastVisit = lastVisit;
+    return &ranks[rankCount++];
+}
+
+/**
+ * dropRank, removes a directory from the database.
+ *
+ * Args: A size_t
+ * Return: Nothing
+ */
+static void dropRank(size_t index)
+{
+    free(ranks[index].path);
+    memmove(ranks + index, ranks + index + 1, (rankCount - index - 1) * sizeof(struct dirrank));
+    rankCount--;
+    ranksChanged = 1;
+}
+
+/**
+ * loadRanks, reads the z database the first time it is needed. The file is mapped and walked record by record,
+ *            a truncated or foreign file just loads what makes sense of it.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+static void loadRanks()
+{
+    char *path, *data;
+    struct stat info;
+    struct dirheader header;
+    struct dirrecord record;
+    size_t offset = sizeof(header);
+    int fd;
+    if (ranksLoaded)
+        return;
+    ranksLoaded = 1;
+    if ((path = databasePath()) == NULL)
+        return;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    free(path);
+    if (fd < 0)
+        return;
+    if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(header) &&
+        (data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+    {
+        memcpy(&header, data, sizeof(header));
+        for (uint32_t i = 0; header.magic == DIRS_MAGIC && i < header.count && offset + sizeof(record) <= (size_t)info.st_size; i++)
+        {
+            memcpy(&record, data + offset, sizeof(record));
+            offset += sizeof(record);
+            if (record.length > info.st_size - offset)
+                break;
+            addRank(strndup(data + offset, record.length), record.rank, record.lastVisit);
+            offset += (record.length + 7) & ~7;
+        }
+        munmap(data, info.st_size);
+    }
+    close(fd);
+}
+
+/**
+ * saveRanks, writes the z database if it changed, to a temporary file that is then renamed over the old one so
+ *            another shell never maps half of it.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+static void saveRanks()
+{
+    struct dirheader header = {DIRS_MAGIC, rankCount};
+    struct dirrecord record = {0};
+    char *path = ranksChanged ? databasePath() : NULL, *temporary, padding[8] = {0};
+    FILE *file;
+    int failed;
+    if (path == NULL || (temporary = malloc(strlen(path) + 32)) == NULL)
+    {
+        free(path);
+        return;
+    }
+    sprintf(temporary, "%s.%d", path, getpid());
+    if ((file = fopen(temporary, "we")) != NULL)
+    {
+        failed = fwrite(&header, sizeof(header), 1, file) != 1;
+        for (size_t i = 0; i < rankCount && !failed; i++)
+        {
+            record.rank = ranks[i].rank;
+            record.lastVisit = ranks[i].lastVisit;
+            record.length = strlen(ranks[i].path);
+            failed = fwrite(&record, sizeof(record), 1, file) != 1 || fwrite(ranks[i].path, 1, record.length, file) != record.length ||
+                     fwrite(padding, 1, ((record.length + 7) & ~7) - record.length, file) != ((record.length + 7) & ~7) - record.length;
+        }
+        if (fclose(file) != 0 || failed || rename(temporary, path) != 0)
+        {
+            perror(path);
+            unlink(temporary);
+        }
+    }
+    free(temporary);
+    free(path);
+}
+
+/**
+ * rememberDirectory, counts a visit to a directory in the z database. Once the ranks add up to DIRS_RANK_MAX
+ *                    they are all aged, and directories that fall under 1 are forgotten.
+ *
+ * Args: A string
+ * Return: Nothing
+ */
+static void rememberDirectory(const char *path)
+{
+    struct dirrank *found = NULL;
+    double total = 1;
+    loadRanks();
+    for (size_t i = 0; i < rankCount; i++)
+    {
+        if (found == NULL && strcmp(ranks[i].path, path) == 0)
+            found = &ranks[i];
+        total += ranks[i].rank;
+    }
+    if (found != NULL)
+    {
+        found->rank += 1;
+        found->lastVisit = time(NULL);
+    }
+    else
+        addRank(strdup(path), 1, time(NULL));
+    ranksChanged = 1;
+    if (total <= DIRS_RANK_MAX)
+        return;
+    for (size_t i = rankCount; i > 0; i--)
+        if ((ranks[i - 1].rank *= DIRS_AGING) < 1)
+            dropRank(i - 1);
+}
+
+/**
+ * frecency, how highly a directory ranks right now: its visit count, weighted up if it was visited in the last
+ *           hour or day and down if not in the last week.
+ *
+ * Args: A struct, A time_t
+ * Return: A double
+ */
+static double frecency(const struct dirrank *entry, time_t now)
+{
+    int64_t age = now - entry->lastVisit;
+    if (age < 3600)
+        return entry->rank * 4;
+    if (age < 86400)
+        return entry->rank * 2;
+    if (age < 604800)
+        return entry->rank / 2;
+    return entry->rank / 4;
+}
+
+/**
+ * compareRanks, qsort callback putting the lowest frecency first, so the best match is printed last.
+ *
+ * Args: Two pointers
+ * Return: An integer
+ */
+static int compareRanks(const void *first, const void *second)
+{
+    double difference = frecency(*(struct dirrank **)first, sortTime) - frecency(*(struct dirrank **)second, sortTime);
+    return difference < 0 ? -1 : difference > 0;
+}
+
+/**
+ * matchesFragments, whether every fragment appears in path, in order.
+ *
+ * Args: A string, An array of strings, An integer
+ * Return: An integer
+ */
+static int matchesFragments(const char *path, char **fragments, int ignoreCase)
+{
+    const char *found;
+    for (int i = 0; fragments[i] != NULL; i++)
+    {
+        if ((found = ignoreCase ? strcasestr(path, fragments[i]) : strstr(path, fragments[i])) == NULL)
+            return 0;
+        path = found + strlen(fragments[i]);
+    }
+    return 1;
+}
+
+/**
+ * changeTo, changes the working directory. On success the old one becomes last_dir for "cd -", the new one is
+ *           cached for currentDirectory and counted in the z database. Returns -1 with errno set on failure.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int changeTo(const char *path)
+{
+    char *previous = strdup(currentDirectory());
+    if (chdir(path) != 0)
+    {
+        free(previous);
+        return -1;
+    }
+    free(last_dir);
+    last_dir = previous;
+    free(currentDir);
+    currentDir = getcwd(NULL, 0);
+    clearStatCache(); // Relative paths mean something else now
+    if (currentDir != NULL)
+        rememberDirectory(currentDir);
+    return 0;
+}
+
+/**
+ * changeToCdpath, changes to path, and if there is no such directory here and path doesn't start with / . or ..,
+ *                 tries it under each directory in the cdpath shell variable (or $CDPATH), separated by spaces or
+ *                 colons. A directory found that way is printed like tcsh does. Returns -1 if none worked.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int changeToCdpath(const char *path)
+{
+    char *list = getShellVar("cdpath") ? getShellVar("cdpath") : getEnvVar("CDPATH"), *copy, *entry, *rest, candidate[PATH_MAX];
+    int savedErrno;
+    if (changeTo(path) == 0)
+        return 0;
+    savedErrno = errno;
+    if (path[0] == '/' || path[0] == '.' || list == NULL || (copy = strdup(list)) == NULL)
+        return -1;
+    for (entry = strtok_r(copy, ": ", &rest); entry != NULL; entry = strtok_r(NULL, ": ", &rest))
+    {
+        if (snprintf(candidate, sizeof(candidate), "%s/%s", entry, path) < (int)sizeof(candidate) && changeTo(candidate) == 0)
+        {
+            if (outputJson)
+                outRecord("pwd", "path:s", currentDirectory());
+            else
+                outPrintf(" %s\n", currentDirectory());
+            free(copy);
+            return 0;
+        }
+    }
+    free(copy);
+    errno = savedErrno;
+    return -1;
+}
+
+/**
+ * printStackEntry, prints one entry of the directory stack, with $HOME shortened to ~.
+ *
+ * Args: An integer, A string, An integer
+ * Return: Nothing
+ */
+static void printStackEntry(int index, const char *path, int verbose)
+{
+    char *home = getEnvVar("HOME");
+    size_t length = home ? strlen(home) : 0;
+    int inHome = length > 1 && strncmp(path, home, length) == 0 && (path[length] == '/' || path[length] == '\0');
+    if (outputJson)
+        outRecord("dirs", "index:d path:s", index, path);
+    else if (verbose)
+        outPrintf("%d\t%s%s\n", index, inHome ? "~" : "", inHome ? path + length : path);
+    else
+        outPrintf("%s%s%s", index > 0 ? " " : "", inHome ? "~" : "", inHome ? path + length : path);
+}
+
+/**
+ * printStack, prints the current directory and then the stack, on one line or numbered one per line.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+static void printStack(int verbose)
+{
+    int index = 0;
+    printStackEntry(index++, currentDirectory(), verbose);
+    for (struct dirnode *node = dirStack; node != NULL; node = node->next)
+        printStackEntry(index++, node->path, verbose);
+    if (!verbose && !outputJson)
+        outPrintf("\n");
+}
+
+/**
+ * pushDirectory, the pushd builtin. "pushd dir" pushes the current directory and changes to dir (cdpath applies),
+ *                "pushd" swaps the current directory with the top of the stack and "pushd +n" rotates the stack so
+ *                its nth entry, counting the current directory as 0, becomes the current directory. Prints the stack.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void pushDirectory(char **commandList)
+{
+    struct dirnode *here = malloc(sizeof(struct dirnode)), *before, *target, *last;
+    int index;
+    if (here == NULL || (here->path = strdup(currentDirectory())) == NULL)
+    {
+        free(here);
+        lastExitStatus = 1;
+        return;
+    }
+    here->next = dirStack;
+    if (commandList[1] != NULL && commandList[1][0] == '+')
+    {
+        // Rotate the whole ring, current directory included, so entry n comes first
+        index = atoi(commandList[1] + 1);
+        for (before = here; index > 1 && before->next != NULL; index--)
+            before = before->next;
+        if (index != 1 || (target = before->next) == NULL)
+        {
+            fprintf(stderr, " pushd: Directory stack not that deep.\n");
+            free(here->path);
+            free(here);
+            lastExitStatus = 1;
+            return;
+        }
+        if (changeTo(target->path) != 0)
+        {
+            perror(target->path);
+            free(here->path);
+            free(here);
+            lastExitStatus = 1;
+            return;
+        }
+        for (last = target; last->next != NULL; last = last->next);
+        last->next = here;
+        before->next = NULL;
+        dirStack = target->next != NULL ? target->next : here;
+        if (target->next == NULL)
+            last->next = NULL;
+        free(target->path);
+        free(target);
+    }
+    else if (commandList[1] == NULL)
+    {
+        if (dirStack == NULL || changeTo(dirStack->path) != 0)
+        {
+            if (dirStack == NULL)
+                fprintf(stderr, " pushd: No other directory.\n");
+            else
+                perror(dirStack->path);
+            free(here->path);
+            free(here);
+            lastExitStatus = 1;
+            return;
+        }
+        free(dirStack->path);
+        dirStack->path = here->path;
+        free(here);
+    }
+    else if (changeToCdpath(commandList[1]) != 0)
+    {
+        perror(commandList[1]);
+        free(here->path);
+        free(here);
+        lastExitStatus = 1;
+        return;
+    }
+    else
+        dirStack = here;
+    printStack(0);
+}
+
+/**
+ * popDirectory, the popd builtin. "popd" changes to the directory on top of the stack and drops it, "popd +n"
+ *               just drops the nth entry. Prints the stack.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void popDirectory(char **commandList)
+{
+    struct dirnode **tracker = &dirStack, *removed;
+    int index = commandList[1] != NULL && commandList[1][0] == '+' ? atoi(commandList[1] + 1) : 0;
+    if (dirStack == NULL)
+    {
+        fprintf(stderr, " popd: Directory stack empty.\n");
+        lastExitStatus = 1;
+        return;
+    }
+    if (commandList[1] != NULL && index < 1)
+    {
+        fprintf(stderr, " popd: Bad directory.\n");
+        lastExitStatus = 1;
+        return;
+    }
+    for (int i = 1; i < index && *tracker != NULL; i++)
+        tracker = &(*tracker)->next;
+    if (*tracker == NULL)
+    {
+        fprintf(stderr, " popd: Directory stack not that deep.\n");
+        lastExitStatus = 1;
+        return;
+    }
+    if (index == 0 && changeTo(dirStack->path) != 0)
+    {
+        perror(dirStack->path);
+        lastExitStatus = 1;
+        return;
+    }
+    removed = *tracker;
+    *tracker = removed->next;
+    free(removed->path);
+    free(removed);
+    printStack(0);
+}
+
+/**
+ * printDirectories, the dirs builtin. Prints the directory stack, "dirs -v" numbers it one per line and
+ *                   "dirs -c" empties it.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void printDirectories(char **commandList)
+{
+    struct dirnode *next;
+    if (commandList[1] != NULL && strcmp(commandList[1], "-c") == 0)
+    {
+        for (; dirStack != NULL; dirStack = next)
+        {
+            next = dirStack->next;
+            free(dirStack->path);
+            free(dirStack);
+        }
+        return;
+    }
+    printStack(commandList[1] != NULL && strcmp(commandList[1], "-v") == 0);
+}
+
+/**
+ * jumpDirectory, the z builtin. "z fragment..." changes to the highest ranked directory that has every fragment in
+ *                its path, in order, trying case-insensitively if nothing matches exactly. Only the database is
+ *                searched, nothing on disk, and a directory that no longer exists is dropped and the next best tried.
+ *                "z" alone or "z -l fragment..." lists the directories with their frecency, best last.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void jumpDirectory(char **commandList)
+{
+    int listOnly = commandList[1] != NULL && strcmp(commandList[1], "-l") == 0;
+    char **fragments = commandList + 1 + listOnly;
+    struct dirrank **sorted;
+    size_t count = 0, best;
+    double score, bestScore;
+    sortTime = time(NULL);
+    loadRanks();
+    if (fragments[0] == NULL || listOnly)
+    {
+        if ((sorted = malloc((rankCount + 1) * sizeof(struct dirrank *))) == NULL)
+            return;
+        for (size_t i = 0; i < rankCount; i++)
+            if (matchesFragments(ranks[i].path, fragments, 0))
+                sorted[count++] = &ranks[i];
+        qsort(sorted, count, sizeof(struct dirrank *), compareRanks);
+        for (size_t i = 0; i < count; i++)
+            if (outputJson)
+                outRecord("z", "rank:f path:s", frecency(sorted[i], sortTime), sorted[i]->path);
+            else
+                outPrintf("%-10.1f %s\n", frecency(sorted[i], sortTime), sorted[i]->path);
+        free(sorted);
+        return;
+    }
+    for (int ignoreCase = 0; ignoreCase < 2; ignoreCase++)
+    {
+        while (1)
+        {
+            best = rankCount;
+            for (size_t i = 0; i < rankCount; i++)
+            {
+                if (!matchesFragments(ranks[i].path, fragments, ignoreCase) || strcmp(ranks[i].path, currentDirectory()) == 0)
+                    continue;
+                score = frecency(&ranks[i], sortTime);
+                if (best == rankCount || score > bestScore || (score == bestScore && strlen(ranks[i].path) < strlen(ranks[best].path)))
+                {
+                    best = i;
+                    bestScore = score;
+                }
+            }
+            if (best == rankCount)
+                break;
+            if (changeTo(ranks[best].path) == 0)
+            {
+                if (outputJson)
+                    outRecord("pwd", "path:s", currentDirectory());
+                else
+                    outPrintf(" %s\n", currentDirectory());
+                return;
+            }
+            dropRank(best);
+        }
+    }
+    fprintf(stderr, " z: no match for %s\n", fragments[0]);
+    lastExitStatus = 1;
+}
+
+/**
+ * freeDirectories, saves the z database and frees the directory stack and everything else here.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeDirectories()
+{
+    char *clear[] = {"dirs", "-c", NULL};
+    saveRanks();
+    printDirectories(clear);
+    for (size_t i = 0; i < rankCount; i++)
+        free(ranks[i].path);
+    free(ranks);
+    ranks = NULL;
+    rankCount = rankCapacity = 0;
+    free(currentDir);
+    currentDir = NULL;
+}
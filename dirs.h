@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef DIRS_H
+#define DIRS_H
+
+// directory definitions
+#define DIRS_FILE ".sssh_dirs"    // In $HOME unless $SSSH_DIRS names another file
+#define DIRS_MAGIC 0x72696473     // "sdir"
+#define DIRS_RANK_MAX 9000        // Past this total every rank is aged by DIRS_AGING
+#define DIRS_AGING 0.99
+#define DIRS_INITIAL 64
+
+// Struct definitions
+struct dirnode {
+    char *path;
+    struct dirnode *next;     // Toward the bottom of the stack
+};
+
+/* A directory the z builtin can jump to, ranked by how often and how lately it was visited. */
+struct dirrank {
+    char *path;
+    double rank;
+    int64_t lastVisit;
+};
+
+/* The directory database is a dirheader followed by count dirrecords, each followed
+   by its path, unterminated, padded to 8 bytes. */
+struct dirheader {
+    uint32_t magic;
+    uint32_t count;
+};
+
+struct dirrecord {
+    double rank;
+    int64_t lastVisit;
+    uint32_t length;
+    uint32_t unused;
+};
+
+const char *currentDirectory();
+int changeTo(const char *path);
+int changeToCdpath(const char *path);
+void pushDirectory(char **commandList);
+void popDirectory(char **commandList);
+void printDirectories(char **commandList);
+void jumpDirectory(char **commandList);
+void freeDirectories();
+
+#endif
@@ -0,0 +1,326 @@
+#include "env.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Environment globals
+static struct envvar **buckets = NULL;
+static size_t bucketCount = 0;
+static size_t varCount = 0;
+static struct envvar *orderHead = NULL, *orderTail = NULL;
+static unsigned long version = 0;        // Bumped every time a variable changes
+static char **exported = NULL;           // Cached envp array handed to execve
+static unsigned long exportedVersion = 0; // The version the cached array was built from
+static struct shellvar *shellVarHead = NULL;
+
+/**
+ * hashName, FNV-1a hash of an environment variable name.
+ *
+ * Args: A string
+ * Return: An unsigned long
+ */
+static unsigned long hashName(const char *name)
+{
+    unsigned long hash = 14695981039346656037UL;
+    for (; *name != '\0'; name++)
+    {
+        hash ^= (unsigned char)*name;
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+/**
+ * growBuckets, doubles the bucket array once the table is three quarters full and relinks
+ *              every variable using its cached hash.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+static void growBuckets()
+{
+    size_t newCount = bucketCount ? bucketCount * 2 : ENV_INITIAL_BUCKETS;
+    struct envvar **newBuckets = calloc(newCount, sizeof(struct envvar *));
+    if (newBuckets == NULL)
+    {
+        perror("environment");
+        return;
+    }
+    for (struct envvar *var = orderHead; var != NULL; var = var->nextInOrder)
+    {
+        size_t index = var->hash & (newCount - 1);
+        var->next = newBuckets[index];
+        newBuckets[index] = var;
+    }
+    free(buckets);
+    buckets = newBuckets;
+    bucketCount = newCount;
+}
+
+/**
+ * findVar, looks up a variable by name in its bucket. Returns NULL if it isn't set.
+ *
+ * Args: A string, An unsigned long
+ * Return: A struct
+ */
+static struct envvar *findVar(const char *name, unsigned long hash)
+{
+    if (bucketCount == 0)
+        return NULL;
+    size_t length = strlen(name);
+    for (struct envvar *var = buckets[hash & (bucketCount - 1)]; var != NULL; var = var->next)
+        if (var->hash == hash && (size_t)(var->value - var->entry - 1) == length &&
+            strncmp(var->entry, name, length) == 0)
+            return var;
+    return NULL;
+}
+
+/**
+ * makeEntry, builds the "NAME=value" string for a variable and points value into it. The name
+ *            is the first (value - entry - 1) characters of the entry.
+ *
+ * Args: A struct, Two strings
+ * Return: An integer, 0 on success, -1 if out of memory
+ */
+static int makeEntry(struct envvar *var, const char *name, const char *value)
+{
+    size_t nameLength = strlen(name), valueLength = strlen(value);
+    char *entry = malloc(nameLength + valueLength + 2);
+    if (entry == NULL)
+    {
+        perror("environment");
+        return -1;
+    }
+    memcpy(entry, name, nameLength);
+    entry[nameLength] = '=';
+    memcpy(entry + nameLength + 1, value, valueLength + 1);
+    free(var->entry);
+    var->entry = entry;
+    var->value = entry + nameLength + 1;
+    return 0;
+}
+
+/**
+ * loadEnvironment, copies the envp given to main into the hashed store. Entries without an
+ *                  '=' are skipped, later duplicates overwrite earlier ones like getenv would.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void loadEnvironment(char **envp)
+{
+    char name[BUFSIZ];
+    for (int i = 0; envp != NULL && envp[i] != NULL; i++)
+    {
+        char *equals = strchr(envp[i], '=');
+        if (equals == NULL || (size_t)(equals - envp[i]) >= sizeof(name))
+            continue;
+        memcpy(name, envp[i], equals - envp[i]);
+        name[equals - envp[i]] = '\0';
+        setEnvVar(name, equals + 1);
+    }
+}
+
+/**
+ * getEnvVar, the getenv(3) of the shell. Returns the value of the variable, or NULL if
+ *            it isn't set. The returned string belongs to the store, don't free it.
+ *
+ * Args: A string
+ * Return: A string
+ */
+char *getEnvVar(const char *name)
+{
+    struct envvar *var = findVar(name, hashName(name));
+    return var ? var->value : NULL;
+}
+
+/**
+ * setEnvVar, the setenv(3) of the shell, always overwrites. Setting a variable to the value
+ *            it already holds does not count as a change, so the exported array survives.
+ *
+ * Args: Two strings
+ * Return: Nothing
+ */
+void setEnvVar(const char *name, const char *value)
+{
+    unsigned long hash = hashName(name);
+    struct envvar *var = findVar(name, hash);
+    if (var != NULL)
+    {
+        if (strcmp(var->value, value) == 0)
+            return;
+        if (makeEntry(var, name, value) == 0)
+            version++;
+        return;
+    }
+    if (varCount + 1 > bucketCount / 4 * 3)
+        growBuckets();
+    if ((var = calloc(1, sizeof(struct envvar))) == NULL)
+    {
+        perror("environment");
+        return;
+    }
+    if (makeEntry(var, name, value) != 0)
+    {
+        free(var);
+        return;
+    }
+    var->hash = hash;
+    var->next = buckets[hash & (bucketCount - 1)];
+    buckets[hash & (bucketCount - 1)] = var;
+    if (orderTail)
+        orderTail->nextInOrder = var;
+    else
+        orderHead = var;
+    orderTail = var;
+    varCount++;
+    version++;
+}
+
+/**
+ * exportEnvironment, returns a NULL terminated envp array suitable for execve. The array is only
+ *                    rebuilt when a variable changed since the last call, otherwise the cached one is
+ *                    handed out again. The strings point straight at the stored entries so a rebuild
+ *                    is a single allocation. Don't free or hold onto the result across a setEnvVar.
+ *
+ * Args: Nothing
+ * Return: An array of strings
+ */
+char **exportEnvironment()
+{
+    if (exported != NULL && exportedVersion == version)
+        return exported;
+    char **rebuilt = malloc((varCount + 1) * sizeof(char *));
+    if (rebuilt == NULL)
+    {
+        perror("environment");
+        return exported;
+    }
+    size_t i = 0;
+    for (struct envvar *var = orderHead; var != NULL; var = var->nextInOrder)
+        rebuilt[i++] = var->entry;
+    rebuilt[i] = NULL;
+    free(exported);
+    exported = rebuilt;
+    exportedVersion = version;
+    return exported;
+}
+
+/**
+ * environmentVersion, returns a counter that changes every time any variable changes. Anything
+ *                     derived from the environment can compare against it to know when to refresh.
+ *
+ * Args: Nothing
+ * Return: An unsigned long
+ */
+unsigned long environmentVersion()
+{
+    return version;
+}
+
+/**
+ * freeEnvironment, frees every variable, the buckets and the exported array.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeEnvironment()
+{
+    struct envvar *temp;
+    while (orderHead)
+    {
+        temp = orderHead;
+        orderHead = orderHead->nextInOrder;
+        free(temp->entry);
+        free(temp);
+    }
+    orderTail = NULL;
+    free(buckets);
+    buckets = NULL;
+    bucketCount = varCount = 0;
+    free(exported);
+    exported = NULL;
+    while (shellVarHead)
+        unsetShellVar(shellVarHead->name);
+}
+
+/**
+ * getShellVar, looks up a shell variable. Returns NULL if it isn't set, a set variable
+ *              with no value is the empty string.
+ *
+ * Args: A string
+ * Return: A string
+ */
+char *getShellVar(const char *name)
+{
+    for (struct shellvar *var = shellVarHead; var != NULL; var = var->next)
+        if (strcmp(var->name, name) == 0)
+            return var->value;
+    return NULL;
+}
+
+/**
+ * setShellVar, sets a shell variable, adding it in name order if it is new.
+ *
+ * Args: Two strings
+ * Return: Nothing
+ */
+void setShellVar(const char *name, const char *value)
+{
+    struct shellvar **tracker = &shellVarHead, *var;
+    int order = 1;
+    while (*tracker && (order = strcmp((*tracker)->name, name)) < 0)
+        tracker = &(*tracker)->next;
+    if (*tracker && order == 0)
+    {
+        free((*tracker)->value);
+        (*tracker)->value = strdup(value);
+        return;
+    }
+    if ((var = malloc(sizeof(struct shellvar))) == NULL)
+    {
+        perror("set");
+        return;
+    }
+    var->name = strdup(name);
+    var->value = strdup(value);
+    var->next = *tracker;
+    *tracker = var;
+}
+
+/**
+ * unsetShellVar, removes a shell variable. Returns 1 if it was set.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int unsetShellVar(const char *name)
+{
+    for (struct shellvar **tracker = &shellVarHead; *tracker; tracker = &(*tracker)->next)
+        if (strcmp((*tracker)->name, name) == 0)
+        {
+            struct shellvar *var = *tracker;
+            *tracker = var->next;
+            free(var->name);
+            free(var->value);
+            free(var);
+            return 1;
+        }
+    return 0;
+}
+
+/**
+ * shellVariables, the first shell variable, for listing them in order.
+ *
+ * Args: Nothing
+ * Return: A struct
+ */
+struct shellvar *shellVariables()
+{
+    return shellVarHead;
+}
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef ENV_H
+#define ENV_H
+
+// environment definitions
+#define ENV_INITIAL_BUCKETS 64
+
+// Struct definition
+struct envvar {
+    char *value;             // Points into entry, just after the '='
+    char *entry;             // The "NAME=value" string handed to execve
+    unsigned long hash;      // Cached hash of name so resizing never rehashes strings
+    struct envvar *next;     // Next variable in the same bucket
+    struct envvar *nextInOrder; // Next variable in insertion order, for printenv and export
+};
+
+/* A shell variable from set, never exported to children. Kept sorted by name. */
+struct shellvar {
+    char *name;
+    char *value;
+    struct shellvar *next;
+};
+
+// Hashed environment store functions
+void loadEnvironment(char **envp);
+char *getEnvVar(const char *name);
+void setEnvVar(const char *name, const char *value);
+char **exportEnvironment();
+unsigned long environmentVersion();
+void freeEnvironment();
+
+// Shell variable functions
+char *getShellVar(const char *name);
+void setShellVar(const char *name, const char *value);
+int unsetShellVar(const char *name);
+struct shellvar *shellVariables();
+
+#endif
@@ -0,0 +1,152 @@
+#undef main // The shell's own main is renamed with -Dmain=ssshMain, this is the harness's
+#include "../sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Driver definitions
+#define DRIVER_INPUT_MAX (1024 * 1024)   // Bytes of one input read, the rest is ignored like libFuzzer's -max_len
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/**
+ * readInput, reads up to DRIVER_INPUT_MAX bytes of a file into a buffer. Returns NULL if it can't be read.
+ *
+ * Args: A file, A pointer to a size_t
+ * Return: A string
+ */
+static char *readInput(FILE *file, size_t *size)
+{
+    char *data = malloc(DRIVER_INPUT_MAX + 1);
+    if (data == NULL)
+        return NULL;
+    *size = fread(data, 1, DRIVER_INPUT_MAX, file);
+    data[*size] = '\0';
+    return data;
+}
+
+/**
+ * runFile, runs one file through the harness as a single input. Returns -1 if it can't be read.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+static int runFile(const char *path)
+{
+    FILE *file = fopen(path, "re");
+    char *data;
+    size_t size;
+    if (file == NULL || (data = readInput(file, &size)) == NULL)
+    {
+        perror(path);
+        if (file != NULL)
+            fclose(file);
+        return -1;
+    }
+    fclose(file);
+    LLVMFuzzerTestOneInput((const uint8_t *)data, size);
+    free(data);
+    return 0;
+}
+
+/**
+ * now, the monotonic clock in seconds.
+ *
+ * Args: Nothing
+ * Return: A double
+ */
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * runBench, replays every line of the seed files through the harness rounds times and prints the lines
+ *           per second, so a faster tokenizer can be checked against the numbers it had before.
+ *
+ * Args: An integer, An integer, An array of strings
+ * Return: An integer
+ */
+static int runBench(int rounds, int count, char **paths)
+{
+    char **lines = NULL, **grown, *data, *line, *rest;
+    size_t lineCount = 0, size, bytes = 0;
+    FILE *file;
+    double start;
+    for (int i = 0; i < count; i++)
+    {
+        if ((file = fopen(paths[i], "re")) == NULL || (data = readInput(file, &size)) == NULL)
+        {
+            perror(paths[i]);
+            if (file != NULL)
+                fclose(file);
+            continue;
+        }
+        fclose(file);
+        for (line = strtok_r(data, "\n", &rest); line != NULL; line = strtok_r(NULL, "\n", &rest))
+        {
+            if ((grown = realloc(lines, (lineCount + 1) * sizeof(char *))) == NULL || (line = strdup(line)) == NULL)
+                break;
+            lines = grown;
+            lines[lineCount++] = line;
+            bytes += strlen(line);
+        }
+        free(data);
+    }
+    if (lineCount == 0)
+    {
+        fprintf(stderr, "bench: no lines to run\n");
+        return 1;
+    }
+    start = now();
+    for (int round = 0; round < rounds; round++)
+        for (size_t i = 0; i < lineCount; i++)
+            LLVMFuzzerTestOneInput((const uint8_t *)lines[i], strlen(lines[i]));
+    double elapsed = now() - start;
+    printf("%s: %zu lines x %d rounds in %.3fs, %.0f lines/sec, %.1f MB/sec\n", program_invocation_short_name,
+           lineCount, rounds, elapsed, lineCount * rounds / elapsed, bytes * rounds / elapsed / 1e6);
+    for (size_t i = 0; i < lineCount; i++)
+        free(lines[i]);
+    free(lines);
+    return 0;
+}
+
+/**
+ * main, runs a harness without libFuzzer. With no arguments one input is read from stdin, which is how AFL
+ *       feeds a target (persistent mode is used under afl-clang-fast). With files each is run as one input,
+ *       to replay a crash or a corpus. "-bench ROUNDS FILES..." times the files' lines, see runBench.
+ *
+ * Args: An integer, An array of strings
+ * Return: An integer
+ */
+int main(int argc, char **argv)
+{
+    char *data;
+    size_t size;
+    int failed = 0;
+    if (argc > 2 && strcmp(argv[1], "-bench") == 0)
+        return runBench(atoi(argv[2]) > 0 ? atoi(argv[2]) : 1, argc - 3, argv + 3);
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+            failed |= runFile(argv[i]) != 0;
+        return failed;
+    }
+#ifdef __AFL_LOOP
+    while (__AFL_LOOP(1000))
+#endif
+    {
+        if ((data = readInput(stdin, &size)) == NULL)
+            return 1;
+        LLVMFuzzerTestOneInput((const uint8_t *)data, size);
+        free(data);
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "../sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+/**
+ * LLVMFuzzerTestOneInput, the lexer and glob harness. The input is one command line. It is split with
+ *                         tokenizeLine, every word going through appendWord's glob expansion, then checked
+ *                         with runList without running anything.
+ *
+ * Args: An array of bytes, A size_t
+ * Return: An integer
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *line = malloc(size + 1), **words;
+    size_t capacity = 0;
+    int count = 0;
+    if (line == NULL)
+        return 0;
+    memcpy(line, data, size);
+    line[size] = '\0';
+    words = tokenizeLine(line, NULL, &capacity);
+    free(line);
+    if (words == NULL)
+        return 0;
+    while (words[count] != NULL)
+        count++;
+    if (count > 0)
+        runList(words, 0, count, NULL, 0);
+    for (int i = 0; i < count; i++)
+        free(words[i]);
+    free(words);
+    return 0;
+}
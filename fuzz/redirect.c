@@ -0,0 +1,42 @@
+#include "../sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+/**
+ * LLVMFuzzerTestOneInput, the redirection and pipe harness. The input is one command line, tokenized,
+ *                         then taken apart the way runCommand and handlePipes do: the redirection type and
+ *                         destination, both sides of a pipe with splitPipe, and the words left once
+ *                         removeAfterRedirect cuts the redirection off. No file is opened.
+ *
+ * Args: An array of bytes, A size_t
+ * Return: An integer
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *line = malloc(size + 1), **words, *dest;
+    size_t capacity = 0;
+    if (line == NULL)
+        return 0;
+    memcpy(line, data, size);
+    line[size] = '\0';
+    words = tokenizeLine(line, NULL, &capacity);
+    free(line);
+    if (words == NULL)
+        return 0;
+    getRedirectionType(words);
+    dest = getRedirectionDest(words);
+    free(dest);
+    if (getPipeType(words))
+        freePipeArrays(splitPipe(words, 1), splitPipe(words, 0));
+    removeAfterRedirect(words);
+    for (int i = 0; words[i] != NULL; i++)
+        free(words[i]);
+    free(words);
+    return 0;
+}
@@ -0,0 +1,327 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Job log globals
+static struct jobspool *keptSpools = NULL;   // Newest first
+static struct vector liveSpools = VECTOR_OF(struct livespool); // Spools of running jobs, trimmed by the trimmer
+static pthread_mutex_t spoolLock = PTHREAD_MUTEX_INITIALIZER;   // Guards liveSpools and every punch
+static pthread_t trimmerThread;
+static int trimmerRunning = 0;
+
+/**
+ * spoolLimit, the most output a spool keeps, from the joblog shell variable. It takes a size in bytes
+ *             with an optional k, m or g, an empty value means SPOOL_MAX.
+ *
+ * Args: Nothing
+ * Return: An off_t
+ */
+static off_t spoolLimit()
+{
+    char *value = getShellVar("joblog"), *end;
+    unsigned long long limit;
+    if (value == NULL || value[0] == '\0')
+        return SPOOL_MAX;
+    limit = strtoull(value, &end, 10);
+    if (*end == 'k' || *end == 'K')
+        limit <<= 10;
+    else if (*end == 'm' || *end == 'M')
+        limit <<= 20;
+    else if (*end == 'g' || *end == 'G')
+        limit <<= 30;
+    return limit > 0 ? (off_t)limit : SPOOL_MAX;
+}
+
+/**
+ * punchSpool, keeps a spool under limit like a ring: once a job has written more than limit, the oldest
+ *             whole pages are punched out of the memfd, giving their memory back, and start moves up to the
+ *             oldest byte kept. The job keeps appending at the end, its file offset never changes. Called
+ *             with spoolLock held.
+ *
+ * Args: An integer, A pointer to an off_t, An off_t
+ * Return: Nothing
+ */
+static void punchSpool(int fd, off_t *start, off_t limit)
+{
+    struct stat st;
+    off_t page = sysconf(_SC_PAGESIZE), from, to;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size - *start <= limit)
+        return;
+    // Pages before the one start is in went on an earlier trim
+    from = *start / page * page;
+    *start = st.st_size - limit;
+    to = *start / page * page;
+    if (to > from)
+        fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, from, to - from);
+}
+
+/**
+ * trimmerCallback, the spool trimmer thread. Every SPOOL_TRIM_MS it punches each running job's spool back
+ *                  under its cap, so a chatty job can't fill memory while the shell sits in readLine or
+ *                  waits on a foreground job. Only cancelled while asleep.
+ *
+ * Args: Anything
+ * Return: Nothing
+ */
+static void *trimmerCallback(void *callbackArgs)
+{
+    blockSignalsInThread();
+    while (1)
+    {
+        poll(NULL, 0, SPOOL_TRIM_MS);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        pthread_mutex_lock(&spoolLock);
+        for (size_t i = 0; i < liveSpools.count; i++)
+        {
+            struct livespool *live = &VECTOR_AT(liveSpools, struct livespool, i);
+            punchSpool(live->trimFd, &live->start, live->limit);
+        }
+        pthread_mutex_unlock(&spoolLock);
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    }
+    return NULL;
+}
+
+/**
+ * createJobSpool, makes the memfd a background job's stdout and stderr go to, if the joblog shell variable
+ *                 is set, and hands a dup of it to the trimmer thread, starting that the first time. Returns
+ *                 -1 if it isn't, or if the memfd couldn't be made and the job should just write to the terminal.
+ *                 Give it back with keepJobSpool, or releaseJobSpool if the job never started.
+ *
+ * Args: Nothing
+ * Return: An integer
+ */
+int createJobSpool()
+{
+    struct livespool *live;
+    int fd;
+    if (getShellVar("joblog") == NULL)
+        return -1;
+    if ((fd = memfd_create("sssh-joblog", MFD_CLOEXEC)) < 0)
+    {
+        perror("joblog");
+        return -1;
+    }
+    pthread_mutex_lock(&spoolLock);
+    // Without the trimmer the spool is still trimmed at every prompt
+    if ((live = vectorPush(&liveSpools)) != NULL)
+    {
+        live->fd = fd;
+        live->start = 0;
+        live->limit = spoolLimit();
+        if ((live->trimFd = fcntl(fd, F_DUPFD_CLOEXEC, 0)) < 0)
+            liveSpools.count--;
+    }
+    pthread_mutex_unlock(&spoolLock);
+    if (!trimmerRunning && pthread_create(&trimmerThread, NULL, trimmerCallback, NULL) == 0)
+        trimmerRunning = 1;
+    return fd;
+}
+
+/**
+ * releaseJobSpool, takes a spool away from the trimmer thread once its job is gone, closing fd as well if
+ *                  closeIt is set.
+ *
+ * Args: An integer, An integer
+ * Return: Nothing
+ */
+void releaseJobSpool(int fd, int closeIt)
+{
+    pthread_mutex_lock(&spoolLock);
+    for (size_t i = 0; i < liveSpools.count; i++)
+        if (VECTOR_AT(liveSpools, struct livespool, i).fd == fd)
+        {
+            close(VECTOR_AT(liveSpools, struct livespool, i).trimFd);
+            vectorRemove(&liveSpools, i);
+            break;
+        }
+    pthread_mutex_unlock(&spoolLock);
+    if (closeIt)
+        close(fd);
+}
+
+/**
+ * trimJobSpool, punchSpool under the current joblog cap, for the prompt and joblog.
+ *
+ * Args: An integer, A pointer to an off_t
+ * Return: Nothing
+ */
+void trimJobSpool(int fd, off_t *start)
+{
+    pthread_mutex_lock(&spoolLock);
+    punchSpool(fd, start, spoolLimit());
+    pthread_mutex_unlock(&spoolLock);
+}
+
+/**
+ * dropJobSpool, frees the kept spool of a finished job.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+void dropJobSpool(int id)
+{
+    for (struct jobspool **tracker = &keptSpools; *tracker; tracker = &(*tracker)->next)
+        if ((*tracker)->id == id)
+        {
+            struct jobspool *spool = *tracker;
+            *tracker = spool->next;
+            close(spool->fd);
+            free(spool->command);
+            free(spool);
+            return;
+        }
+}
+
+/**
+ * keepJobSpool, holds on to a finished job's spool so joblog can still show it. Only SPOOLS_KEPT are
+ *               kept, the oldest is dropped to make room.
+ *
+ * Args: An integer, A string, An integer, An off_t
+ * Return: Nothing
+ */
+void keepJobSpool(int id, const char *command, int fd, off_t start)
+{
+    struct jobspool *spool, **tracker;
+    int count = 0;
+    releaseJobSpool(fd, 0); // The job is done writing
+    dropJobSpool(id);
+    if ((spool = malloc(sizeof(struct jobspool))) == NULL || (spool->command = strdup(command)) == NULL)
+    {
+        free(spool);
+        close(fd);
+        return;
+    }
+    trimJobSpool(fd, &start);
+    spool->id = id;
+    spool->fd = fd;
+    spool->start = start;
+    spool->next = keptSpools;
+    keptSpools = spool;
+    for (tracker = &keptSpools; *tracker && ++count <= SPOOLS_KEPT; tracker = &(*tracker)->next);
+    if (*tracker)
+        dropJobSpool((*tracker)->id);
+}
+
+/**
+ * tailOffset, where the last lines of a spool begin, found by reading back from the end a block at a time.
+ *             A final newline doesn't start an empty last line.
+ *
+ * Args: An integer, An off_t, An off_t, A long
+ * Return: An off_t
+ */
+static off_t tailOffset(int fd, off_t start, off_t end, long lines)
+{
+    char block[SPOOL_TAIL_BLOCK];
+    off_t position = end;
+    ssize_t got;
+    if (lines <= 0)
+        return end;
+    while (position > start)
+    {
+        off_t from = position - SPOOL_TAIL_BLOCK > start ? position - SPOOL_TAIL_BLOCK : start;
+        if ((got = pread(fd, block, position - from, from)) <= 0)
+            break;
+        for (ssize_t i = got - 1; i >= 0; i--)
+            if (block[i] == '\n' && from + i != end - 1 && --lines == 0)
+                return from + i + 1;
+        position = from;
+    }
+    return start;
+}
+
+/**
+ * showJobLog, the joblog builtin. "joblog [-n LINES] [%job]" prints what a spooled background job wrote,
+ *             running or finished, or just its last LINES lines. The spool goes to fd 1 with sendfile, so
+ *             none of it is copied through the shell. Without a job it shows the most recent one.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void showJobLog(char **commandList)
+{
+    struct job *job = NULL;
+    struct jobspool *kept = NULL;
+    const char *spec = NULL;
+    char buffer[OUTPUT_BLOCK_SIZE], *end;
+    long lines = -1;
+    off_t start, offset, length;
+    ssize_t got;
+    struct stat st;
+    int fd;
+    for (int i = 1; commandList[i] != NULL; i++)
+    {
+        if (strcmp(commandList[i], "-n") == 0 && commandList[i + 1] != NULL &&
+            (lines = strtol(commandList[++i], &end, 10)) >= 0 && *end == '\0')
+            continue;
+        if (commandList[i][0] == '%' && spec == NULL)
+        {
+            spec = commandList[i];
+            continue;
+        }
+        fprintf(stderr, " usage: joblog [-n lines] [%%job]\n");
+        lastExitStatus = 1;
+        return;
+    }
+    if ((job = parseJobSpec(spec ? spec : "%%")) != NULL && job->spool < 0)
+        job = NULL;
+    for (kept = keptSpools; job == NULL && kept != NULL; kept = kept->next)
+        if (spec == NULL || (spec[1] != '\0' && strtol(spec + 1, &end, 10) == kept->id && *end == '\0'))
+            break;
+    if (job == NULL && kept == NULL)
+    {
+        fprintf(stderr, " joblog: %s: No spooled output, set joblog before starting the job.\n", spec ? spec : "%%");
+        lastExitStatus = 1;
+        return;
+    }
+    // Held while copying, so the trimmer can't punch out what is being shown
+    pthread_mutex_lock(&spoolLock);
+    if (job != NULL)
+        punchSpool(job->spool, &job->spoolStart, spoolLimit());
+    fd = job ? job->spool : kept->fd;
+    start = job ? job->spoolStart : kept->start;
+    if (fstat(fd, &st) != 0)
+    {
+        pthread_mutex_unlock(&spoolLock);
+        perror("joblog");
+        lastExitStatus = 1;
+        return;
+    }
+    length = st.st_size;
+    offset = lines >= 0 ? tailOffset(fd, start, length, lines) : start;
+    if (offset == start && start > 0)
+        outPrintf("[joblog: %lld earlier bytes dropped]\n", (long long)start);
+    outFlush();
+    while (offset < length && sendfile(STDOUT_FILENO, fd, &offset, length - offset) > 0);
+    // sendfile won't write to a file opened for appending, copy the rest by hand
+    while (offset < length && (got = pread(fd, buffer, sizeof(buffer), offset)) > 0 && write(STDOUT_FILENO, buffer, got) == got)
+        offset += got;
+    pthread_mutex_unlock(&spoolLock);
+}
+
+/**
+ * freeJobSpools, stops the trimmer thread, and closes and frees the spools kept of finished jobs.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeJobSpools()
+{
+    if (trimmerRunning)
+    {
+        pthread_cancel(trimmerThread);
+        pthread_join(trimmerThread, NULL);
+        trimmerRunning = 0;
+    }
+    for (size_t i = 0; i < liveSpools.count; i++)
+        close(VECTOR_AT(liveSpools, struct livespool, i).trimFd);
+    vectorFree(&liveSpools);
+    while (keptSpools)
+        dropJobSpool(keptSpools->id);
+}
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef JOBLOG_H
+#define JOBLOG_H
+
+// job log definitions
+#define SPOOL_MAX (1024 * 1024)   // Bytes of output a spooled job keeps, "set joblog=SIZE" changes it
+#define SPOOLS_KEPT 16            // Spools of finished jobs kept for joblog, the oldest go first
+#define SPOOL_TAIL_BLOCK 4096     // Bytes read at a time looking back for the start of joblog -n
+#define SPOOL_TRIM_MS 100         // How often the trimmer thread brings running jobs' spools under the cap
+
+/* The output of a background job that finished. A later spooled job with the same number replaces it. */
+struct jobspool {
+    int id;
+    char *command;
+    int fd;                   // The memfd the job wrote to
+    off_t start;              // Everything before was dropped to keep it under the cap
+    struct jobspool *next;
+};
+
+/* A running job's spool, as the trimmer thread sees it. It trims through its own dup of the memfd,
+   so the number can't be reused under it, and keeps its own start. */
+struct livespool {
+    int fd;                   // The job's fd, what releaseJobSpool finds it by
+    int trimFd;               // The trimmer's dup of it
+    off_t start;
+    off_t limit;              // The cap when the job started, the trimmer doesn't read shell variables
+};
+
+int createJobSpool();
+void releaseJobSpool(int fd, int closeIt);
+void trimJobSpool(int fd, off_t *start);
+void keepJobSpool(int id, const char *command, int fd, off_t start);
+void dropJobSpool(int id);
+void showJobLog(char **commandList);
+void freeJobSpools();
+
+#endif
@@ -0,0 +1,426 @@
+#include "jobs.h"
+#include "output.h"
+#include "resources.h"
+#include "trace.h"
+#include "joblog.h"
+#include <fcntl.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Job control globals
+struct job *jobHead = NULL;
+int jobTimeout = JOB_TIMEOUT;                     // 0 lets foreground jobs run as long as they like
+static pid_t shellPgid = 0;
+static int terminalFd = -1;                       // Our own copy of the terminal, pipes can't take it away
+static volatile sig_atomic_t terminalControl = 0; // 1 when the shell hands the terminal to its jobs
+static volatile sig_atomic_t foregroundPgid = 0;  // The job being waited on, 0 at the prompt
+static volatile sig_atomic_t childChanged = 0;
+static volatile sig_atomic_t timedOut = 0;
+static volatile sig_atomic_t interrupted = 0;
+
+/**
+ * sigHandler, callback for SIGINT. Only does async-signal-safe things: with terminal control the
+ *             terminal already sent ctrl+c to the foreground job alone, so the shell just notes it.
+ *             Without a terminal the interrupt is forwarded to the foreground job's group, and
+ *             background jobs never see it either way.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+static void sigHandler(int signal)
+{
+    if (!terminalControl && foregroundPgid > 0)
+        kill(-foregroundPgid, SIGINT);
+    else
+        interrupted = 1;
+}
+
+/**
+ * childHandler, callback for SIGCHLD. The reaping is left to reapJobs in the main loop.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+static void childHandler(int signal)
+{
+    childChanged = 1;
+}
+
+/**
+ * alarmHandler, callback for SIGALRM, interrupts waitForJob when a foreground job runs too long.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+static void alarmHandler(int signal)
+{
+    timedOut = 1;
+}
+
+/**
+ * initJobControl, puts the shell in its own process group and takes the terminal if there is
+ *                 one, then installs the signal handlers. SIGTSTP, SIGTTIN, SIGTTOU and SIGTERM are
+ *                 ignored by the shell only, its jobs get them back in prepareJobChild.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void initJobControl()
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGTSTP, &action, NULL); // Ignore control z
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGTTIN, &action, NULL);
+    sigaction(SIGTTOU, &action, NULL);
+
+    action.sa_flags = SA_RESTART;
+    action.sa_handler = sigHandler;
+    sigaction(SIGINT, &action, NULL);
+    action.sa_handler = childHandler;
+    sigaction(SIGCHLD, &action, NULL);
+
+    action.sa_flags = 0; // waitpid has to see EINTR when the alarm goes off
+    action.sa_handler = alarmHandler;
+    sigaction(SIGALRM, &action, NULL);
+
+    shellPgid = getpid();
+    if (setpgid(0, 0) != 0)
+        shellPgid = getpgrp(); // Already a group (or session) leader
+    if (isatty(STDIN_FILENO) && (terminalFd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 3)) >= 0)
+        terminalControl = tcsetpgrp(terminalFd, shellPgid) == 0;
+}
+
+/**
+ * prepareJobChild, called in the child right after fork. Moves it into its own process group,
+ *                  gives it the terminal if it runs in the foreground, and restores the default
+ *                  handling of every signal the shell catches or ignores.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+void prepareJobChild(int foreground)
+{
+    int defaults[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGTERM, SIGCHLD, SIGALRM};
+    sigset_t none;
+    setpgid(0, 0);
+    if (foreground && terminalControl)
+        tcsetpgrp(terminalFd, getpid());
+    for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++)
+        signal(defaults[i], SIG_DFL);
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+}
+
+/**
+ * enterSubshell, called in a forked subshell instead of prepareJobChild. The subshell gets its own process group and
+ *                the terminal if it runs in the foreground, then acts as the shell for the jobs it starts: they are
+ *                handed the terminal and it comes back to the subshell. A background subshell never touches the
+ *                terminal. The parent's jobs aren't the subshell's to report.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+void enterSubshell(int foreground)
+{
+    setpgid(0, 0);
+    shellPgid = getpid();
+    if (foreground && terminalControl)
+        tcsetpgrp(terminalFd, shellPgid);
+    else
+        terminalControl = 0;
+    freeJobs();
+}
+
+/**
+ * blockSignalsInThread, keeps helper threads from taking the shell's signals so SIGALRM and
+ *                       SIGCHLD always land on the main thread. Call first thing in a pthread callback.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void blockSignalsInThread()
+{
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, NULL);
+}
+
+/**
+ * addJob, appends a job for the child just forked. The job gets the lowest id above every
+ *         job still in the list.
+ *
+ * Args: A pid_t, An array of strings
+ * Return: A struct
+ */
+struct job *addJob(pid_t pid, char **commandList)
+{
+    struct job **tracker = &jobHead, *newJob;
+    size_t length = 0;
+    int id = 1;
+    while (*tracker)
+    {
+        if ((*tracker)->id >= id)
+            id = (*tracker)->id + 1;
+        tracker = &(*tracker)->next;
+    }
+    if ((newJob = calloc(1, sizeof(struct job))) == NULL)
+        return NULL;
+    for (int i = 0; commandList[i] != NULL; i++)
+        length += strlen(commandList[i]) + 1;
+    if ((newJob->command = calloc(length + 1, 1)) == NULL)
+    {
+        free(newJob);
+        return NULL;
+    }
+    for (int i = 0; commandList[i] != NULL; i++)
+    {
+        if (i > 0)
+            strcat(newJob->command, " ");
+        strcat(newJob->command, commandList[i]);
+    }
+    newJob->id = id;
+    newJob->pid = pid;
+    newJob->pgid = pid;
+    newJob->state = JOB_RUNNING;
+    newJob->spool = -1;
+    *tracker = newJob;
+    return newJob;
+}
+
+/**
+ * findJob, finds a job by its job number. Returns NULL if not found.
+ *
+ * Args: An integer
+ * Return: A struct
+ */
+struct job *findJob(int id)
+{
+    for (struct job *job = jobHead; job != NULL; job = job->next)
+        if (job->id == id)
+            return job;
+    return NULL;
+}
+
+/**
+ * findJobByPid, finds the job a process belongs to. Returns NULL if not found.
+ *
+ * Args: A pid_t
+ * Return: A struct
+ */
+struct job *findJobByPid(pid_t pid)
+{
+    for (struct job *job = jobHead; job != NULL; job = job->next)
+        if (job->pid == pid)
+            return job;
+    return NULL;
+}
+
+/**
+ * parseJobSpec, turns %n into job n and %% or %+ into the most recent job. Returns NULL if the
+ *               spec isn't one of those or no such job exists.
+ *
+ * Args: A string
+ * Return: A struct
+ */
+struct job *parseJobSpec(const char *spec)
+{
+    struct job *last = NULL;
+    char *end;
+    if (spec == NULL || spec[0] != '%')
+        return NULL;
+    if (strcmp(spec, "%%") == 0 || strcmp(spec, "%+") == 0 || spec[1] == '\0')
+    {
+        for (last = jobHead; last != NULL && last->next != NULL; last = last->next);
+        return last;
+    }
+    long id = strtol(spec + 1, &end, 10);
+    return *end == '\0' ? findJob((int)id) : NULL;
+}
+
+/**
+ * removeJob, unlinks a job from the list and frees it.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+void removeJob(struct job *toRemove)
+{
+    for (struct job **tracker = &jobHead; *tracker; tracker = &(*tracker)->next)
+        if (*tracker == toRemove)
+        {
+            *tracker = toRemove->next;
+            removeJobCgroup(toRemove->cgroup);
+            if (toRemove->spool >= 0)
+                keepJobSpool(toRemove->id, toRemove->command, toRemove->spool, toRemove->spoolStart);
+            free(toRemove->cgroup);
+            free(toRemove->command);
+            free(toRemove);
+            return;
+        }
+}
+
+/**
+ * waitForJob, runs a job in the foreground: hands it the terminal, optionally continues it, and
+ *             waits until it exits or stops. If it takes longer than jobTimeout seconds it gets
+ *             a SIGINT. The terminal goes back to the shell afterwards. A finished job is removed,
+ *             a stopped one stays in the list for fg/bg. Returns the exit status.
+ *
+ * Args: A struct, An integer
+ * Return: An integer
+ */
+int waitForJob(struct job *job, int sendContinue)
+{
+    int status = 0, exitStatus = 0;
+    pid_t result;
+    uint64_t waitStart = traceStart();
+    foregroundPgid = job->pgid;
+    if (terminalControl)
+        tcsetpgrp(terminalFd, job->pgid);
+    if (sendContinue)
+        kill(-job->pgid, SIGCONT);
+    job->state = JOB_RUNNING;
+    timedOut = 0;
+    alarm(jobTimeout);
+    while ((result = waitpid(job->pid, &status, WUNTRACED)) < 0)
+    {
+        if (errno != EINTR)
+        {
+            perror("waitpid error");
+            break;
+        }
+        if (timedOut)
+        {
+            timedOut = 0;
+            printf("!!! taking too long to execute this command !!!\n");
+            kill(-job->pgid, SIGINT);
+        }
+    }
+    alarm(0);
+    traceEnd("wait", waitStart, job->command);
+    foregroundPgid = 0;
+    if (terminalControl)
+        tcsetpgrp(terminalFd, shellPgid);
+    if (result > 0 && WIFSTOPPED(status))
+    {
+        job->state = JOB_STOPPED;
+        if (outputJson)
+            outRecord("job", "id:d pid:d state:s command:s", job->id, job->pid, "stopped", job->command);
+        else
+            outPrintf("\n[%d]  Stopped    %s\n", job->id, job->command);
+        return 128 + WSTOPSIG(status);
+    }
+    if (result > 0)
+        exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (exitStatus != 0)
+        fprintf(stderr, "exit code of child: %d\n", exitStatus);
+    removeJob(job);
+    return exitStatus;
+}
+
+/**
+ * reapJobs, the main loop's half of the signal handlers. Collects every background job that
+ *           exited, stopped or continued since the last call and reports it, and reports an
+ *           interrupt that arrived while the shell itself was in the foreground.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void reapJobs()
+{
+    int status;
+    pid_t result;
+    struct job *job;
+    if (interrupted)
+    {
+        interrupted = 0;
+        printf(" Interrupt\n");
+    }
+    for (job = jobHead; job != NULL; job = job->next)
+        trimJobSpool(job->spool, &job->spoolStart);
+    if (!childChanged)
+        return;
+    childChanged = 0;
+    while ((result = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0)
+    {
+        if ((job = findJobByPid(result)) == NULL)
+            continue;
+        if (WIFSTOPPED(status))
+        {
+            job->state = JOB_STOPPED;
+            if (outputJson)
+                outRecord("job", "id:d pid:d state:s command:s", job->id, job->pid, "stopped", job->command);
+            else
+                outPrintf("[%d]  Stopped    %s\n", job->id, job->command);
+        }
+        else if (WIFCONTINUED(status))
+        {
+            job->state = JOB_RUNNING;
+        }
+        else
+        {
+            job->exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            if (outputJson)
+                outRecord("job", "id:d pid:d state:s status:d command:s", job->id, job->pid, "done", job->exitStatus,
+                          job->command);
+            else if (job->exitStatus == 0)
+                outPrintf("[%d]  Done       %s\n", job->id, job->command);
+            else
+                outPrintf("[%d]  Exit %-5d %s\n", job->id, job->exitStatus, job->command);
+            removeJob(job);
+        }
+    }
+    outFlush();
+}
+
+/**
+ * printJobs, lists the jobs with their state, for the jobs builtin. jobs -l adds the CPU time and
+ *            memory each job is using, for the whole job when it has a cgroup.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+void printJobs(int verbose)
+{
+    double cpuSeconds;
+    long long memoryBytes;
+    for (struct job *job = jobHead; job != NULL; job = job->next)
+    {
+        if (outputJson)
+        {
+            if (verbose && readJobUsage(job->pid, job->cgroup, &cpuSeconds, &memoryBytes) == 0)
+                outRecord("job", "id:d pid:d state:s command:s cpu:f memory:l cgroup:s", job->id, job->pid,
+                          job->state == JOB_STOPPED ? "stopped" : "running", job->command, cpuSeconds < 0 ? 0 : cpuSeconds,
+                          memoryBytes < 0 ? 0 : memoryBytes, job->cgroup);
+            else
+                outRecord("job", "id:d pid:d state:s command:s", job->id, job->pid,
+                          job->state == JOB_STOPPED ? "stopped" : "running", job->command);
+            continue;
+        }
+        outPrintf("[%d]  %-10s %d %s\n", job->id, job->state == JOB_STOPPED ? "Stopped" : "Running", job->pid, job->command);
+        if (verbose && readJobUsage(job->pid, job->cgroup, &cpuSeconds, &memoryBytes) == 0)
+            outPrintf("      cpu %.2fs  memory %lldK%s\n", cpuSeconds < 0 ? 0 : cpuSeconds,
+                      memoryBytes < 0 ? 0 : memoryBytes / 1024, job->cgroup ? "  (cgroup)" : "");
+    }
+}
+
+/**
+ * freeJobs, frees the job list. The jobs themselves are left running.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeJobs()
+{
+    while (jobHead)
+        removeJob(jobHead);
+}
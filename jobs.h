@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef JOBS_H
+#define JOBS_H
+
+// job control definitions
+#define JOB_TIMEOUT 30        // Seconds a foreground job gets before it is interrupted
+
+#define JOB_RUNNING 0
+#define JOB_STOPPED 1
+
+// Struct definition
+struct job {
+    int id;                   // The n in %n
+    pid_t pid;
+    pid_t pgid;               // Every job gets its own process group
+    char *command;            // The command line, for jobs and notifications
+    int state;                // JOB_RUNNING, JOB_STOPPED or JOB_DONE
+    int exitStatus;
+    char *cgroup;             // The job's own cgroup when limit or jobcgroups asked for one, else NULL
+    int spool;                // memfd its output goes to when joblog is set, else -1
+    off_t spoolStart;         // Start of what the spool still holds
+    struct job *next;
+};
+extern struct job *jobHead;
+extern int jobTimeout;
+
+// Job control functions
+void initJobControl();
+void prepareJobChild(int foreground);
+void enterSubshell(int foreground);
+void blockSignalsInThread();
+struct job *addJob(pid_t pid, char **commandList);
+struct job *findJob(int id);
+struct job *findJobByPid(pid_t pid);
+struct job *parseJobSpec(const char *spec);
+void removeJob(struct job *toRemove);
+int waitForJob(struct job *job, int sendContinue);
+void reapJobs();
+void printJobs(int verbose);
+void freeJobs();
+
+#endif
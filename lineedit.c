@@ -0,0 +1,496 @@
+#include "lineedit.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Line editor globals
+static char *history[HISTORY_MAX];
+static int historyCount = 0;
+static struct termios originalTermios;
+static size_t lineLimit = LINE_LIMIT_DEFAULT;
+
+/**
+ * enableRawMode, turns off echo, line buffering and the signal keys so every key press
+ *                reaches the editor as it is typed. Returns -1 if stdin isn't a terminal.
+ *
+ * Args: Nothing
+ * Return: An integer
+ */
+static int enableRawMode()
+{
+    struct termios raw;
+    if (tcgetattr(STDIN_FILENO, &originalTermios) != 0)
+        return -1;
+    raw = originalTermios;
+    raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cflag |= CS8;
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    return tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+}
+
+/**
+ * disableRawMode, puts the terminal back the way enableRawMode found it.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+static void disableRawMode()
+{
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &originalTermios);
+}
+
+/**
+ * refreshLine, redraws the prompt and line and puts the cursor back where it belongs,
+ *              all in a single write so the line doesn't flicker.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void refreshLine(struct editline *line)
+{
+    size_t promptLength = strlen(line->prompt);
+    size_t size = promptLength + line->len + 32;
+    char *out = malloc(size);
+    int used;
+    if (out == NULL)
+        return;
+    used = snprintf(out, size, "\r%s%.*s\x1b[K\r", line->prompt, (int)line->len, line->buf);
+    if (promptLength + line->pos > 0)
+        used += snprintf(out + used, size - used, "\x1b[%zuC", promptLength + line->pos);
+    if (write(STDOUT_FILENO, out, used) < 0)
+        perror("write");
+    free(out);
+}
+
+/**
+ * insertText, inserts text at the cursor, growing the buffer geometrically. Text that would take
+ *             the line past the limit is refused with a beep.
+ *
+ * Args: A struct, A string, An integer
+ * Return: Nothing
+ */
+static void insertText(struct editline *line, const char *text, size_t length)
+{
+    if (line->len + length > lineLimit)
+    {
+        if (write(STDOUT_FILENO, "\a", 1) < 0)
+            perror("write");
+        return;
+    }
+    if (line->len + length + 1 > line->cap)
+    {
+        size_t cap = line->cap;
+        while (line->len + length + 1 > cap)
+            cap *= 2;
+        char *grown = realloc(line->buf, cap);
+        if (grown == NULL)
+            return;
+        line->buf = grown;
+        line->cap = cap;
+    }
+    memmove(line->buf + line->pos + length, line->buf + line->pos, line->len - line->pos);
+    memcpy(line->buf + line->pos, text, length);
+    line->len += length;
+    line->pos += length;
+    line->buf[line->len] = '\0';
+}
+
+/**
+ * deleteRange, removes the characters between from and to and leaves the cursor at from.
+ *
+ * Args: A struct, Two integers
+ * Return: Nothing
+ */
+static void deleteRange(struct editline *line, size_t from, size_t to)
+{
+    memmove(line->buf + from, line->buf + to, line->len - to);
+    line->len -= to - from;
+    line->pos = from;
+    line->buf[line->len] = '\0';
+}
+
+/**
+ * replaceLine, swaps the whole line for text, used when moving through history.
+ *
+ * Args: A struct, A string
+ * Return: Nothing
+ */
+static void replaceLine(struct editline *line, const char *text)
+{
+    line->len = line->pos = 0;
+    line->buf[0] = '\0';
+    insertText(line, text, strlen(text));
+}
+
+/**
+ * browseHistory, moves up (-1) or down (1) through the history. The line being typed is
+ *                kept aside so coming back down past the newest entry restores it.
+ *
+ * Args: A struct, An integer
+ * Return: Nothing
+ */
+static void browseHistory(struct editline *line, int direction)
+{
+    int target = line->historyIndex + direction;
+    if (target < 0 || target > historyCount)
+        return;
+    if (line->historyIndex == historyCount)
+    {
+        free(line->saved);
+        line->saved = strdup(line->buf);
+    }
+    line->historyIndex = target;
+    replaceLine(line, target == historyCount ? (line->saved ? line->saved : "") : history[target]);
+}
+
+/**
+ * isCommandPosition, decides whether the word starting at start is a command name, meaning
+ *                    it is the first word on the line or follows a pipe.
+ *
+ * Args: A struct, An integer
+ * Return: An integer
+ */
+static int isCommandPosition(struct editline *line, size_t start)
+{
+    size_t i = start;
+    while (i > 0 && line->buf[i - 1] == ' ')
+        i--;
+    if (i == 0)
+        return 1;
+    return line->buf[i - 1] == '|' || (line->buf[i - 1] == '&' && i > 1 && line->buf[i - 2] == '|');
+}
+
+/**
+ * completeLine, completes the word under the cursor. One match is inserted whole (with a '/'
+ *               for directories, a space otherwise), several matches are extended to their
+ *               common prefix, and if that adds nothing the matches are listed.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void completeLine(struct editline *line)
+{
+    struct completion result;
+    size_t start = line->pos;
+    while (start > 0 && line->buf[start - 1] != ' ')
+        start--;
+    char *word = strndup(line->buf + start, line->pos - start);
+    findCompletions(word, isCommandPosition(line, start), &result);
+    if (result.total == 0)
+    {
+        if (write(STDOUT_FILENO, "\a", 1) < 0)
+            perror("write");
+    }
+    else if (strlen(result.common) > strlen(word) || result.total == 1)
+    {
+        deleteRange(line, start, line->pos);
+        insertText(line, result.common, strlen(result.common));
+        if (result.total == 1)
+            insertText(line, result.isDirectory ? "/" : " ", 1);
+    }
+    else if (result.shownCount == 0)
+    {
+        printf("\n%zu possibilities\n", result.total);
+        fflush(stdout);
+    }
+    else
+    {
+        printf("\n");
+        for (size_t i = 0; i < result.shownCount; i++)
+            printf("%s%s", result.shown[i], (i + 1) % 6 == 0 || i + 1 == result.shownCount ? "\n" : "  ");
+        fflush(stdout);
+    }
+    freeCompletionResult(&result);
+    free(word);
+}
+
+/**
+ * readEscape, reads the rest of an arrow/home/end/delete escape sequence and applies it.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void readEscape(struct editline *line)
+{
+    char seq[3];
+    if (read(STDIN_FILENO, &seq[0], 1) != 1 || read(STDIN_FILENO, &seq[1], 1) != 1)
+        return;
+    if (seq[0] == '[' && seq[1] >= '0' && seq[1] <= '9')
+    {
+        if (read(STDIN_FILENO, &seq[2], 1) != 1 || seq[2] != '~')
+            return;
+        if (seq[1] == '3' && line->pos < line->len)
+            deleteRange(line, line->pos, line->pos + 1);
+        else if (seq[1] == '1' || seq[1] == '7')
+            line->pos = 0;
+        else if (seq[1] == '4' || seq[1] == '8')
+            line->pos = line->len;
+        return;
+    }
+    if (seq[0] != '[' && seq[0] != 'O')
+        return;
+    switch (seq[1])
+    {
+    case 'A':
+        browseHistory(line, -1);
+        break;
+    case 'B':
+        browseHistory(line, 1);
+        break;
+    case 'C':
+        if (line->pos < line->len)
+            line->pos++;
+        break;
+    case 'D':
+        if (line->pos > 0)
+            line->pos--;
+        break;
+    case 'H':
+        line->pos = 0;
+        break;
+    case 'F':
+        line->pos = line->len;
+        break;
+    }
+}
+
+/**
+ * editLine, the raw mode loop that reads keys until enter is pressed. Returns the line, or
+ *           NULL for ctrl+d on an empty line. Ctrl+c throws the line away.
+ *
+ * Args: A string
+ * Return: A string
+ */
+static char *editLine(const char *prompt)
+{
+    struct editline line = {malloc(LINE_INITIAL_SIZE), 0, LINE_INITIAL_SIZE, 0, prompt, historyCount, NULL};
+    char c;
+    int done = 0;
+    line.buf[0] = '\0';
+    refreshLine(&line);
+    while (!done)
+    {
+        if (read(STDIN_FILENO, &c, 1) != 1)
+        {
+            free(line.buf);
+            line.buf = NULL;
+            break;
+        }
+        switch (c)
+        {
+        case '\r':
+        case '\n':
+            done = 1;
+            break;
+        case 3: // ctrl+c
+            line.len = line.pos = 0;
+            line.buf[0] = '\0';
+            printf("^C");
+            done = 1;
+            break;
+        case 4: // ctrl+d
+            if (line.len == 0)
+            {
+                free(line.buf);
+                line.buf = NULL;
+                done = 1;
+            }
+            else if (line.pos < line.len)
+            {
+                deleteRange(&line, line.pos, line.pos + 1);
+            }
+            break;
+        case 127: // backspace
+        case 8:
+            if (line.pos > 0)
+                deleteRange(&line, line.pos - 1, line.pos);
+            break;
+        case 9: // tab
+            completeLine(&line);
+            break;
+        case 1: // ctrl+a
+            line.pos = 0;
+            break;
+        case 5: // ctrl+e
+            line.pos = line.len;
+            break;
+        case 2: // ctrl+b
+            if (line.pos > 0)
+                line.pos--;
+            break;
+        case 6: // ctrl+f
+            if (line.pos < line.len)
+                line.pos++;
+            break;
+        case 11: // ctrl+k
+            deleteRange(&line, line.pos, line.len);
+            break;
+        case 21: // ctrl+u
+            deleteRange(&line, 0, line.pos);
+            break;
+        case 23: // ctrl+w
+        {
+            size_t start = line.pos;
+            while (start > 0 && line.buf[start - 1] == ' ')
+                start--;
+            while (start > 0 && line.buf[start - 1] != ' ')
+                start--;
+            deleteRange(&line, start, line.pos);
+            break;
+        }
+        case 12: // ctrl+l
+            printf("\x1b[H\x1b[2J");
+            fflush(stdout);
+            break;
+        case 16: // ctrl+p
+            browseHistory(&line, -1);
+            break;
+        case 14: // ctrl+n
+            browseHistory(&line, 1);
+            break;
+        case 27:
+            readEscape(&line);
+            break;
+        default:
+            if ((unsigned char)c >= 32)
+                insertText(&line, &c, 1);
+            break;
+        }
+        if (!done)
+            refreshLine(&line);
+    }
+    free(line.saved);
+    return line.buf;
+}
+
+/**
+ * readPlainLine, reads one line from a non-terminal stdin into a buffer that doubles as needed,
+ *                like getline but bounded: a line longer than the limit is read through to its
+ *                newline and thrown away, and the empty string is returned after an error
+ *                message. Returns NULL at end of file.
+ *
+ * Args: Nothing
+ * Return: A string
+ */
+static char *readPlainLine()
+{
+    size_t cap = LINE_INITIAL_SIZE, len = 0;
+    int tooLong = 0, readAny = 0;
+    char *buf = malloc(cap), *grown;
+    if (buf == NULL)
+        return NULL;
+    while (fgets(buf + len, cap - len, stdin) != NULL)
+    {
+        readAny = 1;
+        len += strlen(buf + len);
+        if (len > 0 && buf[len - 1] == '\n')
+        {
+            buf[--len] = '\0';
+            break;
+        }
+        if (len + 1 < cap)
+            continue; // The last line had no newline, the next fgets sees end of file
+        if (len > lineLimit || (grown = realloc(buf, cap * 2)) == NULL)
+        {
+            // Keep reading into the same buffer until the newline
+            tooLong = 1;
+            len = 0;
+            continue;
+        }
+        buf = grown;
+        cap *= 2;
+    }
+    if (!readAny)
+    {
+        free(buf);
+        return NULL;
+    }
+    if (tooLong)
+    {
+        fprintf(stderr, "Line too long, the limit is %zu bytes.\n", lineLimit);
+        buf[0] = '\0';
+    }
+    return buf;
+}
+
+/**
+ * setLineLimit, sets the longest line readLine accepts, 0 puts back the default.
+ *
+ * Args: A size_t
+ * Return: Nothing
+ */
+void setLineLimit(size_t limit)
+{
+    lineLimit = limit > 0 ? limit : LINE_LIMIT_DEFAULT;
+}
+
+/**
+ * readLine, prints the prompt and reads one line of input without its newline. On a terminal
+ *           the line can be edited, browsed through history and tab completed. Otherwise the
+ *           line is read as is. Returns NULL at end of file, the caller frees the line.
+ *
+ * Args: A string
+ * Return: A string
+ */
+char *readLine(const char *prompt)
+{
+    char *result = NULL;
+    if (!isatty(STDIN_FILENO) || enableRawMode() != 0)
+    {
+        printf("%s", prompt);
+        fflush(stdout);
+        return readPlainLine();
+    }
+    fflush(stdout);
+    result = editLine(prompt);
+    disableRawMode();
+    if (result != NULL)
+    {
+        printf("\n");
+        addHistory(result);
+    }
+    return result;
+}
+
+/**
+ * addHistory, remembers a line for up arrow. Blank lines and repeats of the last line are
+ *             skipped, the oldest line is dropped once HISTORY_MAX is reached.
+ *
+ * Args: A string
+ * Return: Nothing
+ */
+void addHistory(const char *line)
+{
+    if (line[strspn(line, " ")] == '\0')
+        return;
+    if (historyCount > 0 && strcmp(history[historyCount - 1], line) == 0)
+        return;
+    if (historyCount == HISTORY_MAX)
+    {
+        free(history[0]);
+        memmove(history, history + 1, (HISTORY_MAX - 1) * sizeof(char *));
+        historyCount--;
+    }
+    history[historyCount++] = strdup(line);
+}
+
+/**
+ * freeLineEditor, frees the history and the completion cache.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeLineEditor()
+{
+    for (int i = 0; i < historyCount; i++)
+        free(history[i]);
+    historyCount = 0;
+    freeCompletionCache();
+}
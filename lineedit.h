@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <termios.h>
+#include "complete.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef LINEEDIT_H
+#define LINEEDIT_H
+
+// line editor definitions
+#define HISTORY_MAX 1000
+#define LINE_INITIAL_SIZE 256
+#define LINE_LIMIT_DEFAULT (16 * 1024 * 1024) // Longest line accepted, "set linemax=N" changes it
+
+/* The line being edited. Grows as needed, pos is the cursor. */
+struct editline {
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t pos;
+    const char *prompt;
+    int historyIndex;         // Entry being shown, historyCount means the line being typed
+    char *saved;              // The line being typed while browsing history
+};
+
+char *readLine(const char *prompt);
+void setLineLimit(size_t limit);
+void addHistory(const char *line);
+void freeLineEditor();
+
+#endif
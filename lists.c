@@ -1,4 +1,5 @@
 #include "lists.h"
+#include "output.h"
 
 /********************************************************
  * PROGRAM: Shell			                            *
@@ -8,149 +9,491 @@
  *    Ben Segal | bensegal@udel.edu | 702425559         *
  ********************************************************/
 
-// getPath List functions
-struct pathelement *getPath()
+// List globals
+struct vector pathList = VECTOR_OF(struct pathelement);
+struct vector userList = VECTOR_OF(struct user);
+struct vector mailList = VECTOR_OF(struct mail *);
+static struct stringmap userIndex;    // Username to its index in userList
+static struct stringmap mailIndex;    // Path to its index in mailList
+static struct stringmap strings;      // Every interned string, the value is unused
+
+// Container functions
+/**
+ * hashString, FNV-1a hash of a string.
+ *
+ * Args: A string
+ * Return: An unsigned long
+ */
+static unsigned long hashString(const char *string)
 {
-  /* path is a copy of the PATH and p is a temp pointer */
-  char *p;
+    unsigned long hash = 14695981039346656037UL;
+    for (; *string; string++)
+    {
+        hash ^= (unsigned char)*string;
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
 
-  /* tmp is a temp point used to create a linked list and pathlist is a
-     pointer to the head of the list */
-  struct pathelement *tmp, *pathlist = NULL;
+/**
+ * vectorPush, makes room for one more item at the end of a vector, growing it by doubling.
+ *             Returns the new item zeroed, or NULL if out of memory. Pointers into the vector
+ *             are only good until the next push.
+ *
+ * Args: A struct
+ * Return: A pointer
+ */
+void *vectorPush(struct vector *vector)
+{
+    if (vector->count == vector->capacity)
+    {
+        size_t capacity = vector->capacity ? vector->capacity * 2 : VECTOR_INITIAL;
+        void *items = realloc(vector->items, capacity * vector->itemSize);
+        if (items == NULL)
+            return NULL;
+        vector->items = items;
+        vector->capacity = capacity;
+    }
+    void *item = (char *)vector->items + vector->count++ * vector->itemSize;
+    memset(item, 0, vector->itemSize);
+    return item;
+}
 
-  p = getenv("PATH");	/* get a pointer to the PATH env var.
-			   make a copy of it, since strtok modifies the
-			   string that it is working with... */
-  path = malloc((strlen(p)+1)*sizeof(char));	/* use malloc(3) */
-  strncpy(path, p, strlen(p));
-  path[strlen(p)] = '\0';
+/**
+ * vectorRemove, removes an item by moving the last one into its place. Returns the old index
+ *               of the item that moved, which equals the new count if none did.
+ *
+ * Args: A struct, An integer
+ * Return: An integer
+ */
+size_t vectorRemove(struct vector *vector, size_t index)
+{
+    size_t last = --vector->count;
+    if (index != last)
+        memcpy((char *)vector->items + index * vector->itemSize, (char *)vector->items + last * vector->itemSize,
+               vector->itemSize);
+    return last;
+}
 
-  p = strtok(path, ":"); 	/* PATH is : delimited */
-  do				/* loop through the PATH */
-  {				/* to build a linked list of dirs */
-    if ( !pathlist )		/* create head of list */
+/**
+ * vectorFree, frees a vector's items, it can be used again afterwards.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+void vectorFree(struct vector *vector)
+{
+    free(vector->items);
+    vector->items = NULL;
+    vector->count = vector->capacity = 0;
+}
+
+/**
+ * findSlot, probes for a key from its home slot. Returns the slot holding it, or if it isn't
+ *           there the first free slot it could go in (a tombstone if one was passed).
+ *
+ * Args: A struct, A string, An unsigned long
+ * Return: A struct
+ */
+static struct mapslot *findSlot(struct stringmap *map, const char *key, unsigned long hash)
+{
+    struct mapslot *reusable = NULL;
+    for (size_t i = hash & (map->capacity - 1);; i = (i + 1) & (map->capacity - 1))
     {
-      tmp = calloc(1, sizeof(struct pathelement));
-      pathlist = tmp;
+        struct mapslot *slot = &map->slots[i];
+        if (slot->key == NULL)
+            return reusable ? reusable : slot;
+        if (slot->key == MAP_TOMBSTONE)
+        {
+            if (reusable == NULL)
+                reusable = slot;
+        }
+        else if (slot->hash == hash && (slot->key == key || strcmp(slot->key, key) == 0))
+            return slot;
     }
-    else			/* add on next element */
+}
+
+/**
+ * growMap, moves every live key into a slot array twice the size, or the same size when it is
+ *          mostly tombstones. Returns -1 if out of memory.
+ *
+ * Args: A struct
+ * Return: An integer
+ */
+static int growMap(struct stringmap *map)
+{
+    struct stringmap grown = {NULL, map->capacity == 0 ? MAP_INITIAL : map->count * 2 >= map->capacity / 2 ? map->capacity * 2 : map->capacity, 0, 0};
+    if ((grown.slots = calloc(grown.capacity, sizeof(struct mapslot))) == NULL)
+        return -1;
+    for (size_t i = 0; i < map->capacity; i++)
+        if (map->slots[i].key != NULL && map->slots[i].key != MAP_TOMBSTONE)
+            *findSlot(&grown, map->slots[i].key, map->slots[i].hash) = map->slots[i];
+    grown.count = grown.used = map->count;
+    free(map->slots);
+    *map = grown;
+    return 0;
+}
+
+/**
+ * mapFind, looks up a key. Returns a pointer to its value, or NULL if it isn't in the map.
+ *
+ * Args: A struct, A string
+ * Return: A pointer to an integer
+ */
+size_t *mapFind(struct stringmap *map, const char *key)
+{
+    struct mapslot *slot;
+    if (map->count == 0)
+        return NULL;
+    slot = findSlot(map, key, hashString(key));
+    return slot->key != NULL && slot->key != MAP_TOMBSTONE ? &slot->value : NULL;
+}
+
+/**
+ * mapInsert, sets a key's value, adding the key if it is new. The map keeps the key pointer
+ *            itself, so it has to be interned or otherwise outlive the map. Returns -1 if out
+ *            of memory.
+ *
+ * Args: A struct, A string, An integer
+ * Return: An integer
+ */
+int mapInsert(struct stringmap *map, const char *key, size_t value)
+{
+    unsigned long hash = hashString(key);
+    struct mapslot *slot;
+    if ((map->used + 1) * 4 > map->capacity * 3 && growMap(map) != 0) // Kept under three quarters full
+        return -1;
+    slot = findSlot(map, key, hash);
+    if (slot->key == NULL || slot->key == MAP_TOMBSTONE)
     {
-      tmp->next = calloc(1, sizeof(struct pathelement));
-      tmp = tmp->next;
+        map->used += slot->key == NULL;
+        map->count++;
+        slot->key = key;
+        slot->hash = hash;
     }
-    tmp->element = p;	
-    tmp->next = NULL;
-  } while ((p = strtok(NULL, ":")));
+    slot->value = value;
+    return 0;
+}
+
+/**
+ * mapRemove, removes a key, leaving a tombstone so the keys probed past it are still found.
+ *            Returns -1 if it wasn't in the map.
+ *
+ * Args: A struct, A string
+ * Return: An integer
+ */
+int mapRemove(struct stringmap *map, const char *key)
+{
+    struct mapslot *slot;
+    if (map->count == 0)
+        return -1;
+    slot = findSlot(map, key, hashString(key));
+    if (slot->key == NULL || slot->key == MAP_TOMBSTONE)
+        return -1;
+    slot->key = MAP_TOMBSTONE;
+    map->count--;
+    return 0;
+}
 
-  return pathlist;
+/**
+ * mapFree, frees a map's slots, it can be used again afterwards. The keys aren't its to free.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+void mapFree(struct stringmap *map)
+{
+    free(map->slots);
+    memset(map, 0, sizeof(struct stringmap));
 }
 
 /**
- * addUser, this function appends a user to the end of the user list. No inserting in order here.
- *          The added user is returned from this function.
- * 
- * Args: A struct, a String
- * Return: A struct
+ * internString, returns the one shared copy of a string, making it the first time. Interned
+ *               strings are never freed before exit, so they can be map keys and compared by
+ *               pointer. Returns NULL if out of memory.
+ *
+ * Args: A string
+ * Return: A string
  */
-struct user *addUser(char *username) {
-    struct user **tracker = &userHead, *newNode;
-    while (*tracker) // Traverse the list until end
-        tracker = &(*tracker)->next;
-    newNode = (struct user*)malloc(sizeof(struct user));
-    newNode->username = username;
-    newNode->next = *tracker; // NULL
-    *tracker = newNode; // Insert newNode at end
-    return *tracker;
+const char *internString(const char *string)
+{
+    struct mapslot *slot;
+    char *copy;
+    if (strings.count > 0 && (slot = findSlot(&strings, string, hashString(string)))->key != NULL && slot->key != MAP_TOMBSTONE)
+        return slot->key;
+    if ((copy = strdup(string)) == NULL || mapInsert(&strings, copy, 0) != 0)
+    {
+        free(copy);
+        return NULL;
+    }
+    return copy;
 }
 
 /**
- * findUser, traverses the linked list to find the given user by username, pretty straightforward.
- *           Return NULL if not found.
+ * freeStrings, frees every interned string. Only for exit, after everything using them is gone.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeStrings()
+{
+    for (size_t i = 0; i < strings.capacity; i++)
+        if (strings.slots[i].key != NULL && strings.slots[i].key != MAP_TOMBSTONE)
+            free((char *)strings.slots[i].key);
+    mapFree(&strings);
+}
+
+// PATH List functions
+/**
+ * openPathEntry, opens dir and fills in an entry for it. Returns -1 if dir doesn't exist or
+ *                isn't a directory, those entries are dropped from the PATH list. A relative dir
+ *                (".", "bin") means a different directory after every cd, so it isn't opened or
+ *                checked: its dirfd is AT_FDCWD and it is looked up from the cwd each time.
+ *
  * Args: A struct, A string
- * Return: A struct
+ * Return: An integer
  */
-struct user *findUser(char *username) {
-    struct user **tracker = &userHead;
-    while (*tracker) {
-        if (strcmp(username, (*(tracker))->username) == 0)
-            return *tracker;
-        tracker = &(*tracker)->next;
+static int openPathEntry(struct pathelement *entry, const char *dir)
+{
+  struct stat st;
+  int fd;
+  if (dir[0] != '/')
+  {
+    entry->element = dir;
+    entry->dirfd = AT_FDCWD;
+    entry->device = 0;
+    entry->inode = 0;
+    return 0;
+  }
+  if ((fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0 || fstat(fd, &st) != 0)
+  {
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  entry->element = dir;
+  entry->dirfd = fd;
+  entry->device = st.st_dev;
+  entry->inode = st.st_ino;
+  return 0;
+}
+
+/**
+ * isDuplicateDir, returns 1 if an entry with the same device and inode is already in the list.
+ *                 This catches the same dir spelled twice, or reached through a symlink. Relative
+ *                 entries have no fixed identity and are never duplicates.
+ *
+ * Args: A struct, A struct
+ * Return: An integer
+ */
+static int isDuplicateDir(struct vector *list, struct pathelement *entry)
+{
+  if (entry->dirfd == AT_FDCWD)
+    return 0;
+  for (size_t i = 0; i < list->count; i++)
+    if (VECTOR_AT(*list, struct pathelement, i).device == entry->device &&
+        VECTOR_AT(*list, struct pathelement, i).inode == entry->inode)
+      return 1;
+  return 0;
+}
+
+/**
+ * updatePath, rebuilds the PATH list from the value given. Directories already in the list
+ *             keep their entry and open fd, only new directories are opened and only the
+ *             ones that disappeared are closed. Duplicates and directories that don't exist
+ *             are left out. Returns the number of directories that were added or removed.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int updatePath(const char *pathValue)
+{
+  struct vector newList = VECTOR_OF(struct pathelement);
+  struct stringmap oldIndex = {0};
+  struct pathelement entry, *added;
+  const char *p = pathValue ? pathValue : "", *dir;
+  char element[PATH_MAX];
+  size_t *found;
+  int changed = 0;
+  for (size_t i = 0; i < pathList.count; i++)
+    mapInsert(&oldIndex, VECTOR_AT(pathList, struct pathelement, i).element, i);
+  while (*p)
+  {
+    size_t length = strcspn(p, ":");	/* PATH is : delimited */
+    if (length > 0 && length < sizeof(element))
+    {
+      int reused = 0, opened = 0;
+      memcpy(element, p, length);
+      element[length] = '\0';
+      if ((dir = internString(element)) != NULL && (found = mapFind(&oldIndex, dir)) != NULL)
+      {
+        entry = VECTOR_AT(pathList, struct pathelement, *found);
+        VECTOR_AT(pathList, struct pathelement, *found).dirfd = -1; // Taken, freePath leaves it open
+        mapRemove(&oldIndex, dir);
+        reused = 1;
+      }
+      else if (dir != NULL)
+        opened = openPathEntry(&entry, dir) == 0;
+      if (!reused && !opened)
+        ;
+      else if (isDuplicateDir(&newList, &entry) || (added = vectorPush(&newList)) == NULL)
+      {
+        if (entry.dirfd >= 0)
+          close(entry.dirfd);
+        changed += reused;
+      }
+      else
+      {
+        *added = entry;
+        changed += !reused;
+      }
     }
-    return NULL; // returns NULL if not found
+    p += length;
+    if (*p == ':')
+      p++;
+  }
+  changed += oldIndex.count;
+  mapFree(&oldIndex);
+  freePath();
+  pathList = newList;
+  return changed;
 }
 
+/**
+ * openPathDir, a new fd on a PATH entry's directory, for reading it. Relative entries are opened
+ *              from the cwd. Returns -1 if it can't be opened, don't forget to close it otherwise.
+ *
+ * Args: A struct
+ * Return: An integer
+ */
+int openPathDir(const struct pathelement *dir)
+{
+  if (dir->dirfd == AT_FDCWD)
+    return open(dir->element, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  return fcntl(dir->dirfd, F_DUPFD_CLOEXEC, 0);
+}
 
 /**
- * removeUser, removes a user from the list based on the username given. Also returns the removed user
- *             in case it is needed for other operations.
+ * freePath, frees the PATH list and closes all of its directories.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freePath()
+{
+  for (size_t i = 0; i < pathList.count; i++)
+    if (VECTOR_AT(pathList, struct pathelement, i).dirfd >= 0)
+      close(VECTOR_AT(pathList, struct pathelement, i).dirfd);
+  vectorFree(&pathList);
+}
+
+/**
+ * addUser, this function appends a user to the end of the user list, or returns the one already
+ *          watched by that name. The list keeps an interned copy of the name, the one given is freed.
+ *          Returns NULL if out of memory.
  * 
- * Args: A struct, A string
+ * Args: A string
  * Return: A struct
  */
-struct user *removeUser(char *usernameToRemove) {
-    struct user **tracker = &userHead, *temp = userHead;
-    while (temp) {
-        if (strcmp(usernameToRemove, temp->username) == 0) {
-            *tracker = temp->next;
-            free(temp->username); // Clean up strdup
-            free(temp);
-            return *tracker;
-        }
-        tracker = &(*tracker)->next;
-        temp = temp->next;
+struct user *addUser(char *username) {
+    const char *name = internString(username);
+    struct user *newUser;
+    free(username);
+    if (name == NULL)
+        return NULL;
+    if ((newUser = findUser(name)) != NULL)
+        return newUser;
+    if ((newUser = vectorPush(&userList)) == NULL || mapInsert(&userIndex, name, userList.count - 1) != 0) {
+        if (newUser)
+            userList.count--;
+        return NULL;
     }
-    return NULL; // If the user to delete does not exist
+    newUser->username = name;
+    return newUser;
+}
+
+/**
+ * findUser, looks the given user up by username. Return NULL if not found. The pointer is only good
+ *           until the list next changes.
+ *
+ * Args: A string
+ * Return: A struct
+ */
+struct user *findUser(const char *username) {
+    size_t *index = mapFind(&userIndex, username);
+    return index ? &VECTOR_AT(userList, struct user, *index) : NULL;
 }
 
 
 /**
- * freeUsers, frees the entire users linked list data structure.
+ * removeUser, removes a user from the list based on the username given. The last user takes its
+ *             place in the list. Returns -1 if the user wasn't watched.
  * 
- * Args: A struct
+ * Args: A string
+ * Return: An integer
+ */
+int removeUser(const char *username) {
+    size_t *found = mapFind(&userIndex, username), index;
+    if (found == NULL)
+        return -1;
+    index = *found;
+    mapRemove(&userIndex, username);
+    if (vectorRemove(&userList, index) != index)
+        *mapFind(&userIndex, VECTOR_AT(userList, struct user, index).username) = index;
+    return 0;
+}
+
+
+/**
+ * freeUsers, frees the entire users list. The names are interned and go with freeStrings.
+ * 
+ * Args: Nothing
  * Return: Nothing
  */
-void freeUsers(struct user *list) {
-    struct user *temp;
-    while(list) {
-        temp = list;
-        list = list->next;
-        free(temp->username);
-        free(temp);
-    }
+void freeUsers() {
+    vectorFree(&userList);
+    mapFree(&userIndex);
 }
 
 
 /**
- * printMail, prints the list of users in the linked list.
+ * printUsers, prints the users in the list.
  * 
  * Args: Nothing
  * Return: Nothing
  */
 void printUsers() {
-    struct user *n = userHead;
-    while (n) {
-        printf("\nNAME: %s\n", n->username);
-        n = n->next;
-    }
+    for (size_t i = 0; i < userList.count; i++)
+        if (outputJson)
+            outRecord("watchuser", "name:s", VECTOR_AT(userList, struct user, i).username);
+        else
+            outPrintf("NAME: %s\n", VECTOR_AT(userList, struct user, i).username);
 }
 
 /**
- * addMail, makes a new mail struct and mallocs space for it. Sets its path and threadID attributes.
- *          This linked list will always just append new mails to the end of the list.
+ * addMail, makes a new mail struct and mallocs space for it. Sets its path, the rest is filled in
+ *          by the watcher. The list keeps an interned copy of the path, the one given is freed.
+ *          Returns NULL if out of memory.
  * 
- * Args: A string, A pthread_t
+ * Args: A string
  * Return: A struct
  */
-struct mail *addMail(char *pathToFile, pthread_t threadID) {
-    struct mail **tracker = &mailHead, *newMail;
-    while(*tracker)
-        tracker = &(*tracker)->next;
-    newMail = (struct mail*)malloc(sizeof(struct mail));
-    newMail->pathToFile = pathToFile;
-    newMail->thread = threadID;
-    newMail->next = *tracker; // NULL
-    *tracker = newMail;
-    return *tracker;
+struct mail *addMail(char *pathToFile) {
+    const char *path = internString(pathToFile);
+    struct mail *newMail, **slot;
+    free(pathToFile);
+    if (path == NULL || (newMail = calloc(1, sizeof(struct mail))) == NULL)
+        return NULL;
+    if ((slot = vectorPush(&mailList)) == NULL || mapInsert(&mailIndex, path, mailList.count - 1) != 0) {
+        if (slot)
+            mailList.count--;
+        free(newMail);
+        return NULL;
+    }
+    newMail->pathToFile = path;
+    newMail->fd = newMail->fileWatch = newMail->dirWatch = -1;
+    *slot = newMail;
+    return newMail;
 }
 
 
@@ -161,66 +504,79 @@ struct mail *addMail(char *pathToFile, pthread_t threadID) {
  * Return: Nothing
  */
 void printMail() {
-    struct mail *list = mailHead;
-    while (list != NULL) {
-        printf("\nFileName: --> %s, ThreadID: --> %ld\n", list->pathToFile, list->thread);
-        list = list->next;
+    for (size_t i = 0; i < mailList.count; i++) {
+        struct mail *mail = VECTOR_AT(mailList, struct mail *, i);
+        if (outputJson) {
+            outRecord("watchfile", "path:s inode:l offset:l", mail->pathToFile, (long long)mail->inode, (long long)mail->offset);
+            continue;
+        }
+        outPrintf("FileName: --> %s, Inode: --> %lu, Offset: --> %lld\n", mail->pathToFile,
+                  (unsigned long)mail->inode, (long long)mail->offset);
     }
 }
 
 
 /**
- * removeMail, removes the mail from the list based on the filename given.
+ * removeMail, removes the mail from the list based on the filename given and frees it. Returns -1
+ *             if it wasn't in the list.
  * 
  * Args: A string
- * Return: A struct
+ * Return: An integer
  */
-struct mail *removeMail(char *fileName) {
-    struct mail **tracker = &mailHead, *temp = mailHead;
-    while(temp) {
-        if (strcmp(temp->pathToFile, fileName) == 0) {
-            *tracker = temp->next;
-            free(temp->pathToFile);
-            free(temp);
-            return *tracker;
-        }
-        tracker = &(*tracker)->next;
-        temp = temp->next;
-    }
-    return NULL;
+int removeMail(const char *fileName) {
+    size_t *found = mapFind(&mailIndex, fileName), index;
+    struct mail *mail;
+    if (found == NULL)
+        return -1;
+    index = *found;
+    mail = VECTOR_AT(mailList, struct mail *, index);
+    mapRemove(&mailIndex, mail->pathToFile);
+    if (vectorRemove(&mailList, index) != index)
+        *mapFind(&mailIndex, VECTOR_AT(mailList, struct mail *, index)->pathToFile) = index;
+    freeMail(mail);
+    return 0;
 }
 
 
 /**
  * findMail, finds the piece of mail based on the string entered as the filename (or path). 
- *           It then returns the mail struct associated with that filename.
+ *           It then returns the mail struct associated with that filename, or NULL.
  * 
  * Args: A string
- * Return: Nothing
+ * Return: A struct
  */
-struct mail *findMail(char *fileName) {
-    struct mail **tracker = &mailHead;
-    while(*tracker) 
-        if (strcmp((*(tracker))->pathToFile, fileName) == 0)
-            return *tracker;
-    return NULL; // If the mail wasn't found
+struct mail *findMail(const char *fileName) {
+    size_t *index = mapFind(&mailIndex, fileName);
+    return index ? VECTOR_AT(mailList, struct mail *, *index) : NULL;
 }
 
 
 /**
- * freeAllMail, frees all the threads and or structs in the mailList.
+ * freeMail, closes the file a mail follows and frees it. The watcher's inotify watches are its to remove.
  * 
  * Args: A struct
  * Return: Nothing
  */
-void freeAllMail(struct mail *list) {
-    struct mail *temp;
-    while(list) {
-        temp = list;
-        list = list->next;
-        free(temp->pathToFile);
-        pthread_cancel(temp->thread);
-        pthread_join(temp->thread, NULL);
-        free(temp);
+void freeMail(struct mail *mail) {
+    if (mail->fd >= 0)
+        close(mail->fd);
+    if (mail->pattern) {
+        regfree(mail->pattern);
+        free(mail->pattern);
     }
-}
\ No newline at end of file
+    free(mail);
+}
+
+
+/**
+ * freeAllMail, frees all the structs in the mail list. The watcher thread must be stopped first.
+ * 
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeAllMail() {
+    for (size_t i = 0; i < mailList.count; i++)
+        freeMail(VECTOR_AT(mailList, struct mail *, i));
+    vectorFree(&mailList);
+    mapFree(&mailIndex);
+}
@@ -4,6 +4,11 @@
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <regex.h>
+#include <limits.h>
 
 /********************************************************
  * PROGRAM: Shell			                                  *
@@ -13,48 +18,101 @@
  *    Ben Segal | bensegal@udel.edu | 702425559         *
  ********************************************************/
 
-// getPath definitions
-char *path; // I made this global so I can free it from sh.c
+// Container definitions
+#define VECTOR_INITIAL 8
+#define MAP_INITIAL 16            // Slots, always a power of two
+#define MAP_TOMBSTONE ((const char *)1)   // Key of a slot whose entry was removed, probing goes on past it
 
-/* function prototype.  It returns a pointer to a linked list for the path
-   elements. */
-struct pathelement *getPath();
+/* A growable array of fixed size items, kept contiguous. Removing an item
+   moves the last one into its place, so order is only kept by appending. */
+struct vector {
+    void *items;
+    size_t itemSize;
+    size_t count;
+    size_t capacity;
+};
+#define VECTOR_OF(type) {NULL, sizeof(type), 0, 0}
+#define VECTOR_AT(vector, type, i) (((type *)(vector).items)[i])
+
+/* One slot of a stringmap. The hash is kept so growing never rehashes a string. */
+struct mapslot {
+    const char *key;          // NULL if never used, MAP_TOMBSTONE if removed
+    unsigned long hash;
+    size_t value;
+};
+
+/* An open addressing hash map from strings to indexes, probed linearly. The
+   keys aren't copied, they are interned strings that outlive the map. */
+struct stringmap {
+    struct mapslot *slots;
+    size_t capacity;
+    size_t count;             // Live keys
+    size_t used;              // Live keys and tombstones, what the load factor counts
+};
 
+void *vectorPush(struct vector *vector);
+size_t vectorRemove(struct vector *vector, size_t index);
+void vectorFree(struct vector *vector);
+size_t *mapFind(struct stringmap *map, const char *key);
+int mapInsert(struct stringmap *map, const char *key, size_t value);
+int mapRemove(struct stringmap *map, const char *key);
+void mapFree(struct stringmap *map);
+const char *internString(const char *string);
+void freeStrings();
+
+// PATH definitions
+/* The PATH list is owned by lists.c. updatePath diffs it against a new PATH value,
+   keeping the entries (and open directory fds) of directories that didn't change. */
 struct pathelement {
-  char *element;			/* a dir in the path */
-  struct pathelement *next;		/* pointer to next node */
+  const char *element;		/* a dir in the path, interned */
+  int dirfd;				/* open fd on the dir, for openat/faccessat probes, AT_FDCWD for a relative dir */
+  dev_t device;				/* device and inode of the dir, used to drop */
+  ino_t inode;				/* the same dir showing up under two names */
 };
+extern struct vector pathList;		/* of struct pathelement, in PATH order */
 
+int updatePath(const char *pathValue);
+int openPathDir(const struct pathelement *dir);
+void freePath();
 
 // End getPath definitions
 // watchUser definitions
 // Struct definition
 struct user {
     int isLoggedOn; // 1 if logged on, 0 if not logged on
-    char *username; // The user to be watched, or unwatched
-    struct user *next; // Pointer to the next userNode
-}*userHead;
-
+    const char *username; // The user to be watched, or unwatched, interned
+};
+extern struct vector userList; // Of struct user
 
-// Typical linked list functions
 struct user *addUser(char *username);
-struct user *findUser(char *username);
-struct user *removeUser(char *usernameToRemove);
-void freeUsers(struct user *list);
+struct user *findUser(const char *username);
+int removeUser(const char *username);
+void freeUsers();
 void printUsers();
 
 // End watchUser definitions
 // watchMail definitions
 // Struct definition
+/* A followed file. Every file is followed by the one watcher thread in watch.c,
+   which reads only the bytes past offset. */
 struct mail {
-    char *pathToFile;
-    pthread_t thread;
-    struct mail *next;
-}*mailHead;
+    const char *pathToFile;   // Interned
+    int fd;                   // Open on the file being followed, -1 while it is missing
+    dev_t device;             // Identity of the open file, a change means it was rotated
+    ino_t inode;
+    off_t offset;             // Bytes already seen
+    struct timespec mtime;    // Catches rewrites that don't change the size
+    int fileWatch;            // inotify watch on the file, -1 if none
+    int dirWatch;             // inotify watch on its directory, sees the file come back after rotation
+    int lines;                // New lines to print, -1 for all of them
+    regex_t *pattern;         // Only lines matching this are printed, NULL for any line
+    int notify;               // Print the "You've Got Mail" notice
+};
+extern struct vector mailList; // Of struct mail *, the watcher keeps pointers to them
 
-// Typical linked list functions
-struct mail *addMail(char *pathToFile, pthread_t threadID);
+struct mail *addMail(char *pathToFile);
 void printMail();
-struct mail *removeMail(char *fileName);
-void freeAllMail(struct mail *list);
-struct mail *findMail(char *fileName);
\ No newline at end of file
+int removeMail(const char *fileName);
+void freeMail(struct mail *mail);
+void freeAllMail();
+struct mail *findMail(const char *fileName);
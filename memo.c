@@ -0,0 +1,513 @@
+#include "memo.h"
+#include "env.h"
+#include "lists.h"
+#include "output.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Memo globals
+static struct memoentry *memoBuckets[MEMO_BUCKETS];
+static struct memoentry *lruHead = NULL, *lruTail = NULL;
+static size_t memoBytes = 0, memoCount = 0;
+static unsigned long memoHits = 0, memoMisses = 0;
+static unsigned long envHash = 0, envHashVersion = (unsigned long)-1;
+
+static const char memoMagic[8] = "SSMEMO1";
+
+/**
+ * fnv, FNV-1a over a block of bytes, continuing from hash.
+ *
+ * Args: An unsigned long, A pointer, An integer
+ * Return: An unsigned long
+ */
+static unsigned long fnv(unsigned long hash, const void *data, size_t length)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+/**
+ * environmentHash, hash of the whole exported environment. Only recomputed when a variable
+ *                  changed, so checking a memo costs nothing for the environment in the common case.
+ *
+ * Args: Nothing
+ * Return: An unsigned long
+ */
+static unsigned long environmentHash()
+{
+    if (envHashVersion != environmentVersion())
+    {
+        char **envp = exportEnvironment();
+        envHash = 14695981039346656037UL;
+        for (int i = 0; envp[i] != NULL; i++)
+            envHash = fnv(envHash, envp[i], strlen(envp[i]) + 1);
+        envHashVersion = environmentVersion();
+    }
+    return envHash;
+}
+
+/**
+ * memoKey, lays out argv, the cwd and the environment hash as one '\0' separated block. Built before
+ *          the command runs, since the command may change the cwd or the environment. Returns NULL
+ *          if it couldn't be allocated.
+ *
+ * Args: An array of strings, A pointer to an integer
+ * Return: A string
+ */
+char *memoKey(char **commandList, size_t *keyLength)
+{
+    char *cwd = getcwd(NULL, 0), hashText[24], *key;
+    size_t length = 0, at = 0;
+    snprintf(hashText, sizeof(hashText), "%016lx", environmentHash());
+    for (int i = 0; commandList[i] != NULL; i++)
+        length += strlen(commandList[i]) + 1;
+    length += 1 + (cwd ? strlen(cwd) : 0) + 1 + strlen(hashText) + 1;
+    if ((key = malloc(length)) == NULL)
+    {
+        free(cwd);
+        return NULL;
+    }
+    for (int i = 0; commandList[i] != NULL; i++)
+    {
+        size_t part = strlen(commandList[i]) + 1;
+        memcpy(key + at, commandList[i], part);
+        at += part;
+    }
+    key[at++] = '\0';
+    at += sprintf(key + at, "%s", cwd ? cwd : "") + 1;
+    at += sprintf(key + at, "%s", hashText) + 1;
+    free(cwd);
+    *keyLength = at;
+    return key;
+}
+
+/**
+ * fillSig, stats path into sig. A path that doesn't exist is a valid signature too.
+ *
+ * Args: A struct, A string
+ * Return: Nothing
+ */
+static void fillSig(struct memosig *sig, const char *path)
+{
+    struct stat st;
+    memset(sig, 0, sizeof(struct memosig));
+    sig->path = strdup(path);
+    if (stat(path, &st) != 0)
+        return;
+    sig->exists = 1;
+    sig->device = st.st_dev;
+    sig->inode = st.st_ino;
+    sig->size = st.st_size;
+    sig->mtime = st.st_mtim;
+    sig->ctime = st.st_ctim;
+}
+
+/**
+ * sigChanged, returns 1 if the file behind a signature changed since it was taken.
+ *
+ * Args: A struct
+ * Return: An integer
+ */
+static int sigChanged(struct memosig *sig)
+{
+    struct memosig now;
+    int changed;
+    fillSig(&now, sig->path);
+    changed = now.exists != sig->exists || now.device != sig->device || now.inode != sig->inode ||
+              now.size != sig->size || now.mtime.tv_sec != sig->mtime.tv_sec ||
+              now.mtime.tv_nsec != sig->mtime.tv_nsec || now.ctime.tv_sec != sig->ctime.tv_sec ||
+              now.ctime.tv_nsec != sig->ctime.tv_nsec;
+    free(now.path);
+    return changed;
+}
+
+/**
+ * collectSigs, signatures for everything a command's output may depend on: the cwd, the
+ *              executable, and every argument taken as a path.
+ *
+ * Args: An array of strings, A pointer to an integer
+ * Return: An array of structs
+ */
+static struct memosig *collectSigs(char **commandList, size_t *sigCount)
+{
+    char *cwd = getcwd(NULL, 0), executable[PATH_MAX] = "";
+    size_t count = 0, args = 0;
+    struct memosig *sigs;
+    while (commandList[args] != NULL)
+        args++;
+    if ((sigs = calloc(args + 2, sizeof(struct memosig))) == NULL)
+    {
+        free(cwd);
+        return NULL;
+    }
+    fillSig(&sigs[count++], cwd ? cwd : ".");
+    if (strchr(commandList[0], '/') != NULL)
+        snprintf(executable, sizeof(executable), "%s", commandList[0]);
+    else
+        for (size_t i = 0; i < pathList.count && executable[0] == '\0'; i++)
+        {
+            struct pathelement *dir = &VECTOR_AT(pathList, struct pathelement, i);
+            snprintf(executable, sizeof(executable), "%s/%s", dir->element, commandList[0]);
+            if (faccessat(dir->dirfd, dir->dirfd == AT_FDCWD ? executable : commandList[0], X_OK, AT_EACCESS) != 0)
+                executable[0] = '\0';
+        }
+    if (executable[0] != '\0')
+        fillSig(&sigs[count++], executable);
+    for (size_t i = 1; i < args; i++)
+        fillSig(&sigs[count++], commandList[i]);
+    free(cwd);
+    *sigCount = count;
+    return sigs;
+}
+
+/**
+ * unlinkEntry, takes an entry out of its bucket chain and the LRU list.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void unlinkEntry(struct memoentry *entry)
+{
+    for (struct memoentry **tracker = &memoBuckets[entry->hash % MEMO_BUCKETS]; *tracker; tracker = &(*tracker)->chain)
+        if (*tracker == entry)
+        {
+            *tracker = entry->chain;
+            break;
+        }
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        lruHead = entry->next;
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        lruTail = entry->prev;
+    memoBytes -= entry->outputLength;
+    memoCount--;
+}
+
+/**
+ * linkEntry, puts an entry in its bucket and at the front of the LRU list.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void linkEntry(struct memoentry *entry)
+{
+    entry->chain = memoBuckets[entry->hash % MEMO_BUCKETS];
+    memoBuckets[entry->hash % MEMO_BUCKETS] = entry;
+    entry->prev = NULL;
+    entry->next = lruHead;
+    if (lruHead)
+        lruHead->prev = entry;
+    else
+        lruTail = entry;
+    lruHead = entry;
+    memoBytes += entry->outputLength;
+    memoCount++;
+}
+
+/**
+ * freeEntry, frees an entry that is no longer linked anywhere.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void freeEntry(struct memoentry *entry)
+{
+    for (size_t i = 0; i < entry->sigCount; i++)
+        free(entry->sigs[i].path);
+    free(entry->sigs);
+    free(entry->key);
+    free(entry->output);
+    free(entry);
+}
+
+/**
+ * spillPath, the file an entry spills to under $SSSH_MEMO_DIR, or 0 if spilling is off.
+ *
+ * Args: An unsigned long, A string, An integer
+ * Return: An integer
+ */
+static int spillPath(unsigned long hash, char *path, size_t size)
+{
+    char *dir = getEnvVar("SSSH_MEMO_DIR");
+    if (dir == NULL || dir[0] == '\0')
+        return 0;
+    snprintf(path, size, "%s/%016lx.memo", dir, hash);
+    return 1;
+}
+
+/**
+ * spillEntry, writes an evicted entry to disk so a later lookup can still replay it.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void spillEntry(struct memoentry *entry)
+{
+    char path[PATH_MAX];
+    FILE *file;
+    if (!spillPath(entry->hash, path, sizeof(path)) || (file = fopen(path, "w")) == NULL)
+        return;
+    uint64_t keyLength = entry->keyLength, sigCount = entry->sigCount, outputLength = entry->outputLength;
+    int32_t status = entry->status;
+    fwrite(memoMagic, sizeof(memoMagic), 1, file);
+    fwrite(&keyLength, sizeof(keyLength), 1, file);
+    fwrite(entry->key, 1, keyLength, file);
+    fwrite(&status, sizeof(status), 1, file);
+    fwrite(&sigCount, sizeof(sigCount), 1, file);
+    for (size_t i = 0; i < entry->sigCount; i++)
+    {
+        uint64_t pathLength = strlen(entry->sigs[i].path);
+        struct memosig sig = entry->sigs[i];
+        sig.path = NULL;
+        fwrite(&sig, sizeof(sig), 1, file);
+        fwrite(&pathLength, sizeof(pathLength), 1, file);
+        fwrite(entry->sigs[i].path, 1, pathLength, file);
+    }
+    fwrite(&outputLength, sizeof(outputLength), 1, file);
+    fwrite(entry->output, 1, outputLength, file);
+    if (fclose(file) != 0)
+        unlink(path);
+}
+
+/**
+ * loadSpilled, reads an entry back from disk if one was spilled for this key. The caller
+ *              still has to check its signatures.
+ *
+ * Args: An unsigned long, A string, An integer
+ * Return: A struct, NULL if there is none
+ */
+static struct memoentry *loadSpilled(unsigned long hash, const char *key, size_t keyLength)
+{
+    char path[PATH_MAX], magic[sizeof(memoMagic)];
+    uint64_t storedKeyLength, sigCount, outputLength, pathLength;
+    int32_t status;
+    struct memoentry *entry;
+    FILE *file;
+    int ok = 0;
+    if (!spillPath(hash, path, sizeof(path)) || (file = fopen(path, "r")) == NULL)
+        return NULL;
+    if ((entry = calloc(1, sizeof(struct memoentry))) == NULL)
+    {
+        fclose(file);
+        return NULL;
+    }
+    if (fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, memoMagic, sizeof(magic)) == 0 &&
+        fread(&storedKeyLength, sizeof(storedKeyLength), 1, file) == 1 && storedKeyLength == keyLength &&
+        (entry->key = malloc(keyLength)) != NULL && fread(entry->key, 1, keyLength, file) == keyLength &&
+        memcmp(entry->key, key, keyLength) == 0 && fread(&status, sizeof(status), 1, file) == 1 &&
+        fread(&sigCount, sizeof(sigCount), 1, file) == 1 && sigCount < 4096 &&
+        (entry->sigs = calloc(sigCount + 1, sizeof(struct memosig))) != NULL)
+    {
+        ok = 1;
+        for (uint64_t i = 0; ok && i < sigCount; i++)
+        {
+            struct memosig *sig = &entry->sigs[i];
+            ok = fread(sig, sizeof(*sig), 1, file) == 1;
+            sig->path = NULL;
+            entry->sigCount = i + 1; // So freeEntry sees every path allocated so far
+            ok = ok && fread(&pathLength, sizeof(pathLength), 1, file) == 1 && pathLength < PATH_MAX &&
+                 (sig->path = calloc(pathLength + 1, 1)) != NULL && fread(sig->path, 1, pathLength, file) == pathLength;
+        }
+        ok = ok && fread(&outputLength, sizeof(outputLength), 1, file) == 1 && outputLength <= MEMO_ENTRY_MAX &&
+             (entry->output = malloc(outputLength + 1)) != NULL &&
+             fread(entry->output, 1, outputLength, file) == outputLength;
+    }
+    fclose(file);
+    if (!ok)
+    {
+        freeEntry(entry);
+        return NULL;
+    }
+    entry->keyLength = keyLength;
+    entry->hash = hash;
+    entry->status = status;
+    entry->outputLength = outputLength;
+    return entry;
+}
+
+/**
+ * makeRoom, evicts least recently used entries, spilling them if $SSSH_MEMO_DIR is set, until
+ *           length more bytes fit under MEMO_MAX_BYTES.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+static void makeRoom(size_t length)
+{
+    while (lruTail != NULL && memoBytes + length > MEMO_MAX_BYTES)
+    {
+        struct memoentry *evicted = lruTail;
+        unlinkEntry(evicted);
+        spillEntry(evicted);
+        freeEntry(evicted);
+    }
+}
+
+/**
+ * isMemoCommand, returns 1 if the command is listed in $SSSH_MEMO, the space or colon separated
+ *                list of commands that are always memoized without the memo prefix.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int isMemoCommand(const char *name)
+{
+    const char *list = getEnvVar("SSSH_MEMO");
+    size_t length = strlen(name);
+    if (list == NULL)
+        return 0;
+    while (*list)
+    {
+        size_t part = strcspn(list, " :");
+        if (part == length && strncmp(list, name, length) == 0)
+            return 1;
+        list += part;
+        if (*list)
+            list++;
+    }
+    return 0;
+}
+
+/**
+ * memoLookup, finds the cached result for a key from memoKey, checking memory first and then the
+ *             spill directory. An entry whose files changed is dropped. Returns NULL on a miss.
+ *
+ * Args: A string, An integer
+ * Return: A struct
+ */
+struct memoentry *memoLookup(const char *key, size_t keyLength)
+{
+    unsigned long hash;
+    struct memoentry *entry;
+    if (key == NULL)
+        return NULL;
+    hash = fnv(14695981039346656037UL, key, keyLength);
+    for (entry = memoBuckets[hash % MEMO_BUCKETS]; entry != NULL; entry = entry->chain)
+        if (entry->hash == hash && entry->keyLength == keyLength && memcmp(entry->key, key, keyLength) == 0)
+            break;
+    if (entry != NULL)
+        unlinkEntry(entry);
+    else
+        entry = loadSpilled(hash, key, keyLength);
+    for (size_t i = 0; entry != NULL && i < entry->sigCount; i++)
+        if (sigChanged(&entry->sigs[i]))
+        {
+            freeEntry(entry);
+            entry = NULL;
+        }
+    if (entry == NULL)
+    {
+        memoMisses++;
+        return NULL;
+    }
+    makeRoom(entry->outputLength);
+    linkEntry(entry);
+    memoHits++;
+    return entry;
+}
+
+/**
+ * memoStore, caches the output of a command that just ran under the key memoKey gave for it before
+ *            it ran. Takes ownership of key and output, nothing is cached without a key.
+ *
+ * Args: An array of strings, A string, An integer, An integer, A string, An integer
+ * Return: Nothing
+ */
+void memoStore(char **commandList, char *key, size_t keyLength, int status, char *output, size_t outputLength)
+{
+    struct memoentry *entry;
+    if (key == NULL || outputLength > MEMO_ENTRY_MAX || (entry = calloc(1, sizeof(struct memoentry))) == NULL)
+    {
+        free(key);
+        free(output);
+        return;
+    }
+    entry->key = key;
+    entry->keyLength = keyLength;
+    entry->sigs = collectSigs(commandList, &entry->sigCount);
+    entry->hash = fnv(14695981039346656037UL, entry->key, entry->keyLength);
+    entry->status = status;
+    entry->output = output;
+    entry->outputLength = outputLength;
+    makeRoom(outputLength);
+    linkEntry(entry);
+}
+
+/**
+ * printMemoStats, what the memo builtin prints when given no command.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void printMemoStats()
+{
+    char command[PATH_MAX];
+    size_t length;
+    if (outputJson)
+    {
+        outRecord("memo", "entries:l bytes:l hits:l misses:l", (long long)memoCount, (long long)memoBytes,
+                  (long long)memoHits, (long long)memoMisses);
+        for (struct memoentry *entry = lruHead; entry != NULL; entry = entry->next)
+        {
+            length = 0;
+            for (const char *arg = entry->key; *arg != '\0' && length < sizeof(command); arg += strlen(arg) + 1)
+                length += snprintf(command + length, sizeof(command) - length, "%s%s", length > 0 ? " " : "", arg);
+            outRecord("memoentry", "command:s bytes:l status:d", command, (long long)entry->outputLength, entry->status);
+        }
+        return;
+    }
+    outPrintf("memo: %zu entries, %zu bytes, %lu hits, %lu misses\n", memoCount, memoBytes, memoHits, memoMisses);
+    for (struct memoentry *entry = lruHead; entry != NULL; entry = entry->next)
+    {
+        outPrintf("    ");
+        for (const char *arg = entry->key; *arg != '\0'; arg += strlen(arg) + 1)
+            outPrintf("%s ", arg);
+        outPrintf("(%zu bytes, status %d)\n", entry->outputLength, entry->status);
+    }
+}
+
+/**
+ * clearMemo, forgets every cached result, both those held in memory and those spilled under
+ *            $SSSH_MEMO_DIR. Only files named the way spillPath names them are removed.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void clearMemo()
+{
+    char *dirName = getEnvVar("SSSH_MEMO_DIR");
+    unsigned long hash;
+    struct dirent *dirEntry;
+    DIR *dir;
+    int consumed;
+    while (lruHead)
+    {
+        struct memoentry *entry = lruHead;
+        unlinkEntry(entry);
+        freeEntry(entry);
+    }
+    if (dirName == NULL || dirName[0] == '\0' || (dir = opendir(dirName)) == NULL)
+        return;
+    while ((dirEntry = readdir(dir)) != NULL)
+    {
+        consumed = 0;
+        if (strlen(dirEntry->d_name) == 21 && sscanf(dirEntry->d_name, "%16lx.memo%n", &hash, &consumed) == 1 &&
+            consumed == 21 && unlinkat(dirfd(dir), dirEntry->d_name, 0) != 0)
+            perror(dirEntry->d_name);
+    }
+    closedir(dir);
+}
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef MEMO_H
+#define MEMO_H
+
+// memo definitions
+#define MEMO_MAX_BYTES (32 * 1024 * 1024) // Output held in memory across all entries
+#define MEMO_ENTRY_MAX (4 * 1024 * 1024)  // Bigger outputs are never cached
+#define MEMO_BUCKETS 256
+
+/* What a cached result depended on. A path that didn't exist is recorded too,
+   so creating it later invalidates the entry. */
+struct memosig {
+    char *path;
+    int exists;
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+};
+
+/* One cached command. Entries sit in a hash bucket chain and in a
+   doubly linked LRU list, most recently used at the head. */
+struct memoentry {
+    char *key;                // argv, cwd and environment hash, '\0' separated
+    size_t keyLength;
+    unsigned long hash;
+    int status;
+    char *output;
+    size_t outputLength;
+    struct memosig *sigs;
+    size_t sigCount;
+    struct memoentry *chain;
+    struct memoentry *prev;
+    struct memoentry *next;
+};
+
+int isMemoCommand(const char *name);
+char *memoKey(char **commandList, size_t *keyLength);
+struct memoentry *memoLookup(const char *key, size_t keyLength);
+void memoStore(char **commandList, char *key, size_t keyLength, int status, char *output, size_t outputLength);
+void printMemoStats();
+void clearMemo();
+
+#endif
@@ -0,0 +1,335 @@
+#include "output.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Output globals
+int outputJson = 0;
+static char *block = NULL;
+static size_t used = 0;
+// The watchuser thread prints through the sink too. Recursive, outHold keeps it across a whole builtin
+static pthread_mutex_t outputLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+/**
+ * writeAll, writes every byte to fd 1, retrying short writes and interrupted calls.
+ *
+ * Args: A string, An integer
+ * Return: Nothing
+ */
+static void writeAll(const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(STDOUT_FILENO, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("write");
+            return;
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+/**
+ * flushLocked, empties the block. Anything still sitting in stdio goes first so messages
+ *              printed with printf before a builtin ran stay ahead of its output.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+static void flushLocked()
+{
+    fflush(stdout);
+    if (used > 0)
+        writeAll(block, used);
+    used = 0;
+}
+
+/**
+ * reserve, makes sure the block exists and has room for length more bytes, flushing it if
+ *          not. Returns 0 if the data will not fit even in an empty block.
+ *
+ * Args: An integer
+ * Return: An integer
+ */
+static int reserve(size_t length)
+{
+    if (block == NULL && (block = malloc(OUTPUT_BLOCK_SIZE)) == NULL)
+        return 0;
+    if (used + length > OUTPUT_BLOCK_SIZE)
+        flushLocked();
+    return length <= OUTPUT_BLOCK_SIZE;
+}
+
+/**
+ * outWrite, adds raw bytes to the sink. Anything larger than a block is written straight through.
+ *
+ * Args: A string, An integer
+ * Return: Nothing
+ */
+void outWrite(const char *data, size_t length)
+{
+    pthread_mutex_lock(&outputLock);
+    if (reserve(length))
+    {
+        memcpy(block + used, data, length);
+        used += length;
+    }
+    else
+    {
+        flushLocked();
+        writeAll(data, length);
+    }
+    pthread_mutex_unlock(&outputLock);
+}
+
+/**
+ * outPrintf, printf for builtins. Formats straight into the block when it fits.
+ *
+ * Args: A format string, and its arguments
+ * Return: Nothing
+ */
+void outPrintf(const char *format, ...)
+{
+    va_list args, retry;
+    int length;
+    va_start(args, format);
+    va_copy(retry, args);
+    pthread_mutex_lock(&outputLock);
+    if (reserve(0))
+    {
+        length = vsnprintf(block + used, OUTPUT_BLOCK_SIZE - used, format, args);
+        if (length >= 0 && used + length < OUTPUT_BLOCK_SIZE)
+        {
+            used += length;
+        }
+        else if (length >= 0)
+        {
+            // Didn't fit, make room and format again
+            char *large = NULL;
+            if (reserve(length + 1))
+            {
+                vsnprintf(block + used, OUTPUT_BLOCK_SIZE - used, format, retry);
+                used += length;
+            }
+            else if ((large = malloc(length + 1)) != NULL)
+            {
+                vsnprintf(large, length + 1, format, retry);
+                flushLocked();
+                writeAll(large, length);
+                free(large);
+            }
+        }
+    }
+    pthread_mutex_unlock(&outputLock);
+    va_end(retry);
+    va_end(args);
+}
+
+/* A record being built by outRecord. */
+struct record {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int onHeap;
+};
+
+/**
+ * recordAppend, adds bytes to a record, moving it to the heap when it outgrows the stack.
+ *               Returns -1 if out of memory.
+ *
+ * Args: A struct, A string, An integer
+ * Return: An integer
+ */
+static int recordAppend(struct record *record, const char *data, size_t length)
+{
+    if (record->length + length > record->capacity)
+    {
+        size_t capacity = record->capacity * 2 > record->length + length ? record->capacity * 2 : record->length + length;
+        char *grown = record->onHeap ? realloc(record->data, capacity) : malloc(capacity);
+        if (grown == NULL)
+            return -1;
+        if (!record->onHeap)
+            memcpy(grown, record->data, record->length);
+        record->data = grown;
+        record->capacity = capacity;
+        record->onHeap = 1;
+    }
+    memcpy(record->data + record->length, data, length);
+    record->length += length;
+    return 0;
+}
+
+/**
+ * recordString, adds a JSON string, escaping quotes, backslashes and control characters.
+ *               Other bytes go through as they are. NULL is written as null.
+ *
+ * Args: A struct, A string
+ * Return: Nothing
+ */
+static void recordString(struct record *record, const char *string)
+{
+    const char *start;
+    char escape[8];
+    if (string == NULL)
+    {
+        recordAppend(record, "null", 4);
+        return;
+    }
+    recordAppend(record, "\"", 1);
+    while (*string)
+    {
+        for (start = string; *string && *string != '"' && *string != '\\' && (unsigned char)*string >= 0x20; string++);
+        recordAppend(record, start, string - start);
+        if (*string == '\0')
+            break;
+        if (*string == '"' || *string == '\\')
+            snprintf(escape, sizeof(escape), "\\%c", *string);
+        else if (*string == '\n')
+            snprintf(escape, sizeof(escape), "\\n");
+        else if (*string == '\t')
+            snprintf(escape, sizeof(escape), "\\t");
+        else
+            snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)*string);
+        recordAppend(record, escape, strlen(escape));
+        string++;
+    }
+    recordAppend(record, "\"", 1);
+}
+
+/**
+ * outRecord, the serializer for --json. Writes one NDJSON record to the sink: {"type":TYPE, ...}
+ *            on one line. fields names the rest, space separated as name:kind, and the values
+ *            follow in order. The kinds are s for a string (NULL for null), d for an int, l for
+ *            a long long, f for a double and b for an int written as true or false.
+ *
+ * Args: A string, A string, and the values
+ * Return: Nothing
+ */
+void outRecord(const char *type, const char *fields, ...)
+{
+    char stackSpace[RECORD_INITIAL], number[64];
+    struct record record = {stackSpace, 0, sizeof(stackSpace), 0};
+    const char *name = fields, *colon, *flag;
+    va_list args;
+    va_start(args, fields);
+    recordAppend(&record, "{\"type\":", 8);
+    recordString(&record, type);
+    while (name != NULL && (colon = strchr(name, ':')) != NULL && colon[1] != '\0')
+    {
+        recordAppend(&record, ",\"", 2);
+        recordAppend(&record, name, colon - name);
+        recordAppend(&record, "\":", 2);
+        switch (colon[1])
+        {
+        case 's':
+            recordString(&record, va_arg(args, const char *));
+            break;
+        case 'd':
+            recordAppend(&record, number, snprintf(number, sizeof(number), "%d", va_arg(args, int)));
+            break;
+        case 'l':
+            recordAppend(&record, number, snprintf(number, sizeof(number), "%lld", va_arg(args, long long)));
+            break;
+        case 'f':
+            recordAppend(&record, number, snprintf(number, sizeof(number), "%.3f", va_arg(args, double)));
+            break;
+        case 'b':
+            flag = va_arg(args, int) ? "true" : "false";
+            recordAppend(&record, flag, strlen(flag));
+            break;
+        }
+        for (name = colon + 2; *name == ' '; name++);
+    }
+    recordAppend(&record, "}\n", 2);
+    va_end(args);
+    outWrite(record.data, record.length);
+    if (record.onHeap)
+        free(record.data);
+}
+
+/**
+ * outFlush, writes out everything the builtins printed. Called at the end of every command
+ *           and before forking so children never inherit half a block.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void outFlush()
+{
+    pthread_mutex_lock(&outputLock);
+    flushLocked();
+    pthread_mutex_unlock(&outputLock);
+}
+
+/**
+ * outHold, keeps the sink and fd 1 to the calling thread until outRelease. The shell holds it while fd 1
+ *          is pointed somewhere else for a builtin (a redirection, a memo or substitution capture), so the
+ *          watcher threads can't print into the user's file.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void outHold()
+{
+    pthread_mutex_lock(&outputLock);
+}
+
+/**
+ * outTryHold, outHold for the watcher threads, which never wait for it: the shell may be joining them
+ *             while it holds the sink. Returns 1 if it is now held, 0 if the thread should try later.
+ *
+ * Args: Nothing
+ * Return: An integer
+ */
+int outTryHold()
+{
+    return pthread_mutex_trylock(&outputLock) == 0;
+}
+
+/**
+ * outRelease, gives back what outHold or outTryHold took.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void outRelease()
+{
+    pthread_mutex_unlock(&outputLock);
+}
+
+/**
+ * setOutputFormat, the output shell variable. "json" makes builtins print NDJSON records, "text"
+ *                  (or unsetting it) puts back the usual output.
+ *
+ * Args: A string
+ * Return: Nothing
+ */
+void setOutputFormat(const char *format)
+{
+    if (strcmp(format, "json") == 0 || strcmp(format, "text") == 0 || format[0] == '\0')
+        outputJson = strcmp(format, "json") == 0;
+    else
+        fprintf(stderr, " set: output: Unknown format %s, use json or text.\n", format);
+}
+
+/**
+ * freeOutput, flushes and frees the block.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeOutput()
+{
+    outFlush();
+    free(block);
+    block = NULL;
+}
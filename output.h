@@ -0,0 +1,42 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // For the recursive mutex initializer
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+// builtin output definitions
+#define OUTPUT_BLOCK_SIZE 65536
+#define RECORD_INITIAL 256        // Bytes of a record built on the stack before it moves to the heap
+
+extern int outputJson;            // Builtins print NDJSON records instead of text, set by --json or set output=json
+
+/* Builtins write through this sink instead of printf. Output collects in one
+   block and goes to whatever fd 1 is when it is flushed, so redirections and
+   pipes set up around a builtin catch all of it in a handful of writes. */
+void outPrintf(const char *format, ...);
+void outRecord(const char *type, const char *fields, ...);
+void outWrite(const char *data, size_t length);
+void outFlush();
+void outHold();
+int outTryHold();
+void outRelease();
+void setOutputFormat(const char *format);
+void freeOutput();
+
+#endif
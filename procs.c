@@ -0,0 +1,498 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// The signals kill knows by name, in kill -l order
+static const struct signalname signalNames[] = {
+    {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"ILL", SIGILL}, {"TRAP", SIGTRAP}, {"ABRT", SIGABRT},
+    {"BUS", SIGBUS}, {"FPE", SIGFPE}, {"KILL", SIGKILL}, {"USR1", SIGUSR1}, {"SEGV", SIGSEGV}, {"USR2", SIGUSR2},
+    {"PIPE", SIGPIPE}, {"ALRM", SIGALRM}, {"TERM", SIGTERM}, {"STKFLT", SIGSTKFLT}, {"CHLD", SIGCHLD},
+    {"CONT", SIGCONT}, {"STOP", SIGSTOP}, {"TSTP", SIGTSTP}, {"TTIN", SIGTTIN}, {"TTOU", SIGTTOU}, {"URG", SIGURG},
+    {"XCPU", SIGXCPU}, {"XFSZ", SIGXFSZ}, {"VTALRM", SIGVTALRM}, {"PROF", SIGPROF}, {"WINCH", SIGWINCH},
+    {"IO", SIGIO}, {"PWR", SIGPWR}, {"SYS", SIGSYS}, {"IOT", SIGABRT}, {"CLD", SIGCHLD}, {"POLL", SIGIO},
+};
+#define SIGNAL_NAME_COUNT (sizeof(signalNames) / sizeof(signalNames[0]))
+#define SIGNAL_LISTED 31          // The aliases after this aren't printed by kill -l
+
+// Process scanner globals
+static struct procinfo *procCache = NULL;   // The last scan, sorted by pid
+static size_t procCount = 0;
+static uint64_t lastScan = 0;
+static int openFds = 0;                     // /proc/<pid> fds held by procCache
+
+/**
+ * readProcessName, reads a process's name (its comm) from /proc/pid/stat. Returns -1 if it is gone.
+ *
+ * Args: A pid_t, A string
+ * Return: An integer
+ */
+int readProcessName(pid_t pid, char name[PROC_NAME_MAX])
+{
+    char path[32], buffer[256], *start, *finish;
+    ssize_t length;
+    int fd;
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        return -1;
+    length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0)
+        return -1;
+    buffer[length] = '\0';
+    // The name can hold spaces and parentheses itself, it runs from the first ( to the last )
+    if ((start = strchr(buffer, '(')) == NULL || (finish = strrchr(buffer, ')')) == NULL || finish < start)
+        return -1;
+    length = finish - start - 1 < PROC_NAME_MAX - 1 ? finish - start - 1 : PROC_NAME_MAX - 1;
+    memcpy(name, start + 1, length);
+    name[length] = '\0';
+    return 0;
+}
+
+/**
+ * monotonicNow, the monotonic clock in nanoseconds.
+ *
+ * Args: Nothing
+ * Return: An unsigned 64 bit integer
+ */
+static uint64_t monotonicNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * readProcessStat, fills in a process from its stat file, read relative to its /proc/<pid> fd if it has one.
+ *                  Returns -1 if the process is gone (a cached fd of a process that exited gives ESRCH).
+ *
+ * Args: A struct
+ * Return: An integer
+ */
+static int readProcessStat(struct procinfo *info)
+{
+    char path[32], buffer[1024], *start, *finish;
+    ssize_t length;
+    int fd;
+    snprintf(path, sizeof(path), "/proc/%d/stat", info->pid);
+    if ((fd = info->dirFd >= 0 ? openat(info->dirFd, "stat", O_RDONLY | O_CLOEXEC) : open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        return -1;
+    length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0)
+        return -1;
+    buffer[length] = '\0';
+    if ((start = strchr(buffer, '(')) == NULL || (finish = strrchr(buffer, ')')) == NULL || finish < start)
+        return -1;
+    length = finish - start - 1 < PROC_NAME_MAX - 1 ? finish - start - 1 : PROC_NAME_MAX - 1;
+    memcpy(info->name, start + 1, length);
+    info->name[length] = '\0';
+    unsigned long utime, stime;
+    if (sscanf(finish + 2, "%c %d %d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d %*d %ld %*d %llu %*u %ld",
+               &info->state, &info->ppid, &info->pgid, &utime, &stime, &info->threads, &info->startTime, &info->rss) != 8)
+        return -1;
+    info->ticks = utime + stime;
+    return 0;
+}
+
+/**
+ * readProcessOwner, sets whose a process is from the owner of its /proc/<pid> directory.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void readProcessOwner(struct procinfo *info)
+{
+    char path[32];
+    struct stat owner;
+    snprintf(path, sizeof(path), "/proc/%d", info->pid);
+    if (info->dirFd >= 0 ? fstat(info->dirFd, &owner) == 0 : stat(path, &owner) == 0)
+        info->uid = owner.st_uid;
+}
+
+/**
+ * comparePids, qsort and bsearch callback ordering processes by pid.
+ *
+ * Args: Two pointers
+ * Return: An integer
+ */
+static int comparePids(const void *first, const void *second)
+{
+    return ((const struct procinfo *)first)->pid - ((const struct procinfo *)second)->pid;
+}
+
+/**
+ * scanProcesses, takes one pass over /proc and sets processes to every process, sorted by pid. The array belongs to
+ *                the scanner and stays good until the next scan. Processes seen last time keep their open /proc/<pid>
+ *                directory and only stat is reread through it, with openat. Their %CPU covers the time since that
+ *                scan, a new process's covers its life. Returns how many there are, or -1 if /proc can't be read.
+ *
+ * Args: A pointer to an array of structs
+ * Return: An integer
+ */
+int scanProcesses(struct procinfo **processes)
+{
+    DIR *proc = opendir("/proc");
+    struct dirent *entry;
+    struct procinfo *list = NULL, *grown, *old, key;
+    size_t count = 0, capacity = 0;
+    uint64_t now = monotonicNow();
+    double elapsed = (now - lastScan) / 1e9, uptime = 0, hertz = sysconf(_SC_CLK_TCK);
+    FILE *uptimeFile;
+    char *end, path[32];
+    long pid;
+    *processes = procCache;
+    if (proc == NULL)
+        return -1;
+    if ((uptimeFile = fopen("/proc/uptime", "re")) != NULL)
+    {
+        if (fscanf(uptimeFile, "%lf", &uptime) != 1)
+            uptime = 0;
+        fclose(uptimeFile);
+    }
+    while ((entry = readdir(proc)) != NULL)
+    {
+        if ((pid = strtol(entry->d_name, &end, 10)) <= 0 || *end != '\0')
+            continue;
+        if (count == capacity)
+        {
+            if ((grown = realloc(list, (capacity ? capacity * 2 : PROCS_INITIAL) * sizeof(struct procinfo))) == NULL)
+                break;
+            list = grown;
+            capacity = capacity ? capacity * 2 : PROCS_INITIAL;
+        }
+        memset(&list[count], 0, sizeof(struct procinfo));
+        list[count++].pid = pid;
+    }
+    closedir(proc);
+    qsort(list, count, sizeof(struct procinfo), comparePids);
+    for (size_t i = 0; i < count; i++)
+    {
+        key.pid = list[i].pid;
+        old = procCache ? bsearch(&key, procCache, procCount, sizeof(struct procinfo), comparePids) : NULL;
+        list[i].dirFd = old ? old->dirFd : -1;
+        if (old)
+            old->dirFd = -1; // Handed over
+        if (list[i].dirFd >= 0 && readProcessStat(&list[i]) != 0)
+        {
+            // The pid was recycled since the last scan, the old directory fd is dead
+            close(list[i].dirFd);
+            openFds--;
+            list[i].dirFd = -1;
+            old = NULL;
+        }
+        if (list[i].dirFd < 0 && openFds < PROCS_FD_MAX)
+        {
+            snprintf(path, sizeof(path), "/proc/%ld", (long)list[i].pid);
+            if ((list[i].dirFd = open(path, O_PATH | O_DIRECTORY | O_CLOEXEC)) >= 0)
+                openFds++;
+        }
+        if (list[i].state == '\0' && readProcessStat(&list[i]) != 0)
+        {
+            list[i].pid = 0; // Exited since readdir
+            continue;
+        }
+        if (old != NULL && old->startTime == list[i].startTime && elapsed > 0)
+        {
+            list[i].uid = old->uid;
+            list[i].cpu = (list[i].ticks - old->ticks) / hertz / elapsed * 100;
+            continue;
+        }
+        readProcessOwner(&list[i]);
+        if (uptime > list[i].startTime / hertz)
+            list[i].cpu = list[i].ticks / hertz / (uptime - list[i].startTime / hertz) * 100;
+    }
+    for (size_t i = 0; i < procCount; i++)
+        if (procCache[i].dirFd >= 0)
+        {
+            close(procCache[i].dirFd);
+            openFds--;
+        }
+    free(procCache);
+    // Drop the ones that exited in between
+    procCount = 0;
+    for (size_t i = 0; i < count; i++)
+        if (list[i].pid != 0)
+            list[procCount++] = list[i];
+    procCache = list;
+    lastScan = now;
+    *processes = procCache;
+    return procCount;
+}
+
+/**
+ * signalNumber, turns a signal given to kill into its number: a number, or a name with or without SIG in
+ *               any case. Returns -1 if it isn't a signal.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int signalNumber(const char *name)
+{
+    char *end;
+    long number;
+    if (name == NULL || name[0] == '\0')
+        return -1;
+    number = strtol(name, &end, 10);
+    if (*end == '\0')
+        return number >= 0 && number < NSIG ? number : -1;
+    if (strncasecmp(name, "SIG", 3) == 0)
+        name += 3;
+    for (size_t i = 0; i < SIGNAL_NAME_COUNT; i++)
+        if (strcasecmp(name, signalNames[i].name) == 0)
+            return signalNames[i].number;
+    return -1;
+}
+
+/**
+ * signalName, the name of a signal without the SIG, NULL if it has none.
+ *
+ * Args: An integer
+ * Return: A string
+ */
+const char *signalName(int number)
+{
+    for (size_t i = 0; i < SIGNAL_NAME_COUNT; i++)
+        if (signalNames[i].number == number)
+            return signalNames[i].name;
+    return NULL;
+}
+
+/**
+ * listSignals, prints the signal names for kill -l.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void listSignals()
+{
+    for (size_t i = 0; i < SIGNAL_LISTED; i++)
+        if (outputJson)
+            outRecord("signal", "name:s number:d", signalNames[i].name, signalNames[i].number);
+        else
+            outPrintf("%s%s", signalNames[i].name, (i + 1) % 16 == 0 || i + 1 == SIGNAL_LISTED ? "\n" : " ");
+}
+
+/**
+ * sendSignal, sends a signal to one process through a pidfd, so it can't land on another process that was given
+ *             the same pid after this one exited. With a pattern the process's name is checked again once the pidfd
+ *             is open, and it is left alone if it no longer matches. Falls back to kill(2) on kernels without
+ *             pidfds, and for process groups (pid 0 or below). Returns -1 with errno set if it wasn't sent.
+ *
+ * Args: A pid_t, An integer, A pointer to a regex_t
+ * Return: An integer
+ */
+int sendSignal(pid_t pid, int signal, const regex_t *pattern)
+{
+    char name[PROC_NAME_MAX];
+    int fd = -1, result = -1;
+    if (pid <= 0)
+        return kill(pid, signal);
+#ifdef SYS_pidfd_open
+    fd = syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+#endif
+    if (fd < 0 && errno != ENOSYS)
+        return -1;
+    if (pattern != NULL && (readProcessName(pid, name) != 0 || regexec(pattern, name, 0, NULL, 0) != 0))
+    {
+        if (fd >= 0)
+            close(fd);
+        errno = ESRCH;
+        return -1;
+    }
+    if (fd < 0)
+        return kill(pid, signal);
+#ifdef SYS_pidfd_send_signal
+    result = syscall(SYS_pidfd_send_signal, fd, signal, NULL, 0);
+#else
+    errno = ENOSYS;
+#endif
+    if (result < 0 && errno == ENOSYS)
+        result = kill(pid, signal);
+    close(fd);
+    return result;
+}
+
+/**
+ * isShellDescendant, whether a process is the shell's own child or below it, found by walking up the parents in a
+ *                    scan. Gives up after PROCS_ANCESTRY_MAX steps in case of a loop from a recycled pid.
+ *
+ * Args: An array of structs, An integer, A struct
+ * Return: An integer
+ */
+static int isShellDescendant(struct procinfo *processes, int count, struct procinfo *process)
+{
+    pid_t shell = getpid();
+    struct procinfo key;
+    for (int depth = 0; process != NULL && depth < PROCS_ANCESTRY_MAX; depth++)
+    {
+        if (process->ppid == shell)
+            return 1;
+        key.pid = process->ppid;
+        process = bsearch(&key, processes, count, sizeof(struct procinfo), comparePids);
+    }
+    return 0;
+}
+
+/**
+ * printProcesses, prints one table of the processes that pass the filters.
+ *
+ * Args: An array of structs, An integer, A uid_t or -1, A pattern or NULL, An integer
+ * Return: Nothing
+ */
+static void printProcesses(struct procinfo *processes, int count, uid_t user, const regex_t *pattern, int jobTree)
+{
+    static uid_t lastUid = -1;
+    static char lastUser[LOGIN_NAME_MAX + 1];
+    long pageKbytes = sysconf(_SC_PAGESIZE) / 1024, hertz = sysconf(_SC_CLK_TCK);
+    struct passwd *owner;
+    if (!outputJson)
+        outPrintf("%7s %7s %-10s S  %%CPU %9s %9s %s\n", "PID", "PPID", "USER", "RSS(K)", "TIME", "NAME");
+    for (int i = 0; i < count; i++)
+    {
+        struct procinfo *process = &processes[i];
+        if ((user != (uid_t)-1 && process->uid != user) || (pattern != NULL && regexec(pattern, process->name, 0, NULL, 0) != 0) ||
+            (jobTree && !isShellDescendant(processes, count, process)))
+            continue;
+        if (process->uid != lastUid)
+        {
+            // Consecutive processes mostly belong to the same user, keep the last lookup
+            lastUid = process->uid;
+            if ((owner = getpwuid(lastUid)) != NULL)
+                snprintf(lastUser, sizeof(lastUser), "%s", owner->pw_name);
+            else
+                snprintf(lastUser, sizeof(lastUser), "%d", (int)lastUid);
+        }
+        unsigned long seconds = process->ticks / hertz;
+        if (outputJson)
+        {
+            char state[2] = {process->state, '\0'};
+            outRecord("process", "pid:d ppid:d pgid:d user:s state:s cpu:f rss:l time:f threads:l name:s", (int)process->pid,
+                      (int)process->ppid, (int)process->pgid, lastUser, state, process->cpu,
+                      (long long)process->rss * pageKbytes * 1024, (double)process->ticks / hertz, (long long)process->threads,
+                      process->name);
+            continue;
+        }
+        outPrintf("%7d %7d %-10.10s %c %5.1f %9ld %3lu:%02lu:%02lu %s\n", (int)process->pid, (int)process->ppid, lastUser,
+                  process->state, process->cpu, process->rss * pageKbytes, seconds / 3600, seconds / 60 % 60, seconds % 60,
+                  process->name);
+    }
+}
+
+/**
+ * listProcesses, procs [-u USER] [-n PATTERN] [-j] [-r SECONDS [COUNT]]. Lists processes like a small ps. -u keeps
+ *                a user's (a name or a uid), -n those whose name matches an extended regex, -j the shell's jobs and
+ *                everything under them. -r redraws the list every SECONDS until COUNT lists are shown or Ctrl+C,
+ *                with %CPU then measured over the interval, like top.
+ *
+ * Args: A list of strings
+ * Return: Nothing
+ */
+void listProcesses(char **commandList)
+{
+    struct procinfo *processes;
+    struct passwd *owner;
+    struct timespec interval;
+    regex_t pattern;
+    uid_t user = -1;
+    int hasPattern = 0, jobTree = 0, count, error;
+    long repeats = 1, uid;
+    double seconds = 0;
+    char *end, message[128];
+    lastExitStatus = 0;
+    for (int i = 1; commandList[i] != NULL; i++)
+    {
+        if (strcmp(commandList[i], "-u") == 0 && commandList[i + 1] != NULL)
+        {
+            i++;
+            if ((owner = getpwnam(commandList[i])) != NULL)
+            {
+                user = owner->pw_uid;
+                continue;
+            }
+            // Parsed as a long first, uid_t is unsigned, and (uid_t)-1 already means any user
+            errno = 0;
+            uid = strtol(commandList[i], &end, 10);
+            if (errno == ERANGE || uid < 0 || uid >= (uid_t)-1 || *end != '\0' || end == commandList[i])
+            {
+                fprintf(stderr, " procs: %s: No such user\n", commandList[i]);
+                lastExitStatus = 1;
+                break;
+            }
+            user = uid;
+        }
+        else if (strcmp(commandList[i], "-n") == 0 && commandList[i + 1] != NULL && !hasPattern)
+        {
+            if ((error = regcomp(&pattern, commandList[++i], REG_EXTENDED | REG_NOSUB)) != 0)
+            {
+                regerror(error, &pattern, message, sizeof(message));
+                fprintf(stderr, " procs: %s: %s\n", commandList[i], message);
+                lastExitStatus = 1;
+                break;
+            }
+            hasPattern = 1;
+        }
+        else if (strcmp(commandList[i], "-j") == 0)
+            jobTree = 1;
+        else if (strcmp(commandList[i], "-r") == 0 && commandList[i + 1] != NULL &&
+                 (seconds = strtod(commandList[++i], &end)) > 0 && *end == '\0')
+        {
+            repeats = 0; // Until interrupted
+            if (commandList[i + 1] != NULL && commandList[i + 1][0] != '-' &&
+                ((repeats = strtol(commandList[++i], &end, 10)) < 1 || *end != '\0'))
+                seconds = 0;
+        }
+        else
+            seconds = -1;
+        if (seconds < 0 || (seconds == 0 && repeats != 1))
+        {
+            fprintf(stderr, " usage: procs [-u user] [-n pattern] [-j] [-r seconds [count]]\n");
+            lastExitStatus = 1;
+            break;
+        }
+    }
+    interval.tv_sec = seconds;
+    interval.tv_nsec = (seconds - interval.tv_sec) * 1e9;
+    for (long shown = 0; lastExitStatus == 0 && (repeats == 0 || shown < repeats); shown++)
+    {
+        if (shown > 0 && nanosleep(&interval, NULL) != 0)
+            break; // Ctrl+C
+        if ((count = scanProcesses(&processes)) < 0)
+        {
+            perror(" procs: /proc");
+            lastExitStatus = 1;
+            break;
+        }
+        if (seconds > 0 && !outputJson && isatty(STDOUT_FILENO))
+            outPrintf("\033[H\033[2J");
+        printProcesses(processes, count, user, hasPattern ? &pattern : NULL, jobTree);
+        outFlush();
+    }
+    if (hasPattern)
+        regfree(&pattern);
+}
+
+/**
+ * freeProcesses, closes the cached /proc directories and frees the last scan.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeProcesses()
+{
+    for (size_t i = 0; i < procCount; i++)
+        if (procCache[i].dirFd >= 0)
+            close(procCache[i].dirFd);
+    free(procCache);
+    procCache = NULL;
+    procCount = 0;
+    openFds = 0;
+    lastScan = 0;
+}
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <regex.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef PROCS_H
+#define PROCS_H
+
+// process definitions
+#define PROC_NAME_MAX 16          // comm is at most 15 characters
+#define PROCS_INITIAL 256
+#define PROCS_FD_MAX 512          // /proc/<pid> directories kept open between scans, the rest are opened by path
+#define PROCS_ANCESTRY_MAX 64     // How far up the parents procs -j looks for the shell
+
+/* One process from a scan of /proc. The scan keeps the array and each process's
+   /proc/<pid> directory open, so the next scan only has to reread stat. */
+struct procinfo {
+    pid_t pid;
+    pid_t ppid;
+    pid_t pgid;
+    uid_t uid;
+    char state;
+    char name[PROC_NAME_MAX];
+    unsigned long long startTime; // Clock ticks after boot, tells a recycled pid apart
+    unsigned long ticks;          // User and system CPU time
+    long threads;
+    long rss;                     // Pages
+    double cpu;                   // Percent of one CPU since the last scan, or over its life if it is new
+    int dirFd;                    // O_PATH fd of /proc/<pid>, -1 if not cached
+};
+
+/* A signal the kill builtin knows by name, without the SIG. */
+struct signalname {
+    const char *name;
+    int number;
+};
+
+int scanProcesses(struct procinfo **processes);
+void listProcesses(char **commandList);
+void freeProcesses();
+int readProcessName(pid_t pid, char name[PROC_NAME_MAX]);
+int signalNumber(const char *name);
+const char *signalName(int number);
+void listSignals();
+int sendSignal(pid_t pid, int signal, const regex_t *pattern);
+
+#endif
@@ -0,0 +1,401 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Startup file globals
+static struct vector touchedEnv = VECTOR_OF(char *);    // Names the rc file gave to setenv
+static struct vector touchedVars = VECTOR_OF(char *);   // Names the rc file gave to set and unset
+static char **promptWords = NULL;                       // The words of the last prompt the rc file ran
+static size_t promptCount = 0;
+static const char *recordCommands[] = {NULL, "setenv", "set", "unset", "alias", "prompt"}; // By SNAPSHOT_*
+
+/**
+ * rcPath, where the startup file lives: $SSSH_RC, or RC_FILE in $HOME. Free it.
+ *
+ * Args: Nothing
+ * Return: A string
+ */
+static char *rcPath()
+{
+    char *file = getEnvVar("SSSH_RC"), *home = getEnvVar("HOME"), *path;
+    if (file != NULL && file[0] != '\0')
+        return strdup(file);
+    if (home == NULL || (path = malloc(strlen(home) + strlen(RC_FILE) + 2)) == NULL)
+        return NULL;
+    sprintf(path, "%s/%s", home, RC_FILE);
+    return path;
+}
+
+/**
+ * touchName, remembers a name the rc file set, once.
+ *
+ * Args: A struct, A string, A size_t
+ * Return: Nothing
+ */
+static void touchName(struct vector *names, const char *name, size_t length)
+{
+    char **slot, *copy;
+    for (size_t i = 0; i < names->count; i++)
+        if (strncmp(VECTOR_AT(*names, char *, i), name, length) == 0 && VECTOR_AT(*names, char *, i)[length] == '\0')
+            return;
+    if ((copy = strndup(name, length)) == NULL || (slot = vectorPush(names)) == NULL)
+    {
+        free(copy);
+        return;
+    }
+    *slot = copy;
+}
+
+/**
+ * canSnapshotLine, whether a line of the rc file, before it is parsed, gives the same words every time.
+ *                  A glob pattern or a command substitution can give other words on the next startup.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+static int canSnapshotLine(const char *line)
+{
+    char *copy = strdup(line), *word, *rest;
+    int plain = copy != NULL;
+    for (word = plain ? strtok_r(copy, " \t", &rest) : NULL; word != NULL && plain; word = strtok_r(NULL, " \t", &rest))
+        plain = !hasSubstitution(word) && ((strchr(word, '*') == NULL && strchr(word, '?') == NULL) || strstr(word, "\\!") != NULL);
+    free(copy);
+    return plain;
+}
+
+/**
+ * recordCommand, notes what a parsed rc line is about to change. Returns 1 if the line is one command that
+ *                only sets the environment, shell variables, aliases or the prompt, which a snapshot can
+ *                bring back. Anything else (cd, watchuser, an external command...) has to run every time.
+ *
+ * Args: An array of strings
+ * Return: An integer
+ */
+static int recordCommand(char **commandList)
+{
+    size_t count = 0;
+    for (; commandList[count] != NULL; count++)
+        if (operatorLength(commandList[count]) > 0 || strchr(commandList[count], '&') != NULL ||
+            strchr(commandList[count], '|') != NULL || isRedirection(commandList[count]))
+            return 0;
+    if (strcmp(commandList[0], "setenv") == 0)
+    {
+        if (commandList[1] != NULL)
+            touchName(&touchedEnv, commandList[1], strlen(commandList[1]));
+        return 1;
+    }
+    if (strcmp(commandList[0], "set") == 0 || strcmp(commandList[0], "unset") == 0)
+    {
+        for (int i = 1; commandList[i] != NULL; i++)
+            touchName(&touchedVars, commandList[i], strcspn(commandList[i], "="));
+        return 1;
+    }
+    if (strcmp(commandList[0], "alias") == 0 || strcmp(commandList[0], "unalias") == 0)
+        return 1;
+    if (strcmp(commandList[0], "prompt") != 0 || count < 2)
+        return 0; // prompt with no words asks for one
+    for (size_t i = 0; i < promptCount; i++)
+        free(promptWords[i]);
+    free(promptWords);
+    promptCount = 0;
+    if ((promptWords = malloc(count * sizeof(char *))) == NULL)
+        return 0;
+    for (size_t i = 1; i < count; i++)
+        if ((promptWords[promptCount] = strdup(commandList[i])) != NULL)
+            promptCount++;
+    return promptCount == count - 1;
+}
+
+/**
+ * runRcFile, runs each line of the rc file as if it were typed. Blank lines and lines starting with #
+ *            are skipped. snapshot is cleared if any line can't be brought back from a snapshot. Returns
+ *            the command list, which may have moved.
+ *
+ * Args: A string, An array of strings, An array of strings, A pointer to an integer
+ * Return: An array of strings
+ */
+static char **runRcFile(const char *path, char **commandList, char **argv, int *snapshot)
+{
+    FILE *file = fopen(path, "re");
+    char *line = NULL, *start;
+    size_t size = 0;
+    ssize_t length;
+    if (file == NULL)
+    {
+        perror(path);
+        *snapshot = 0;
+        return commandList;
+    }
+    while ((length = getline(&line, &size, file)) >= 0)
+    {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        for (start = line; *start == ' ' || *start == '\t'; start++);
+        if (*start == '\0' || *start == '#')
+            continue;
+        if (!canSnapshotLine(start))
+            *snapshot = 0;
+        commandList = parseBuffer(start, commandList);
+        if (commandList[0] == NULL)
+            continue;
+        if (!recordCommand(commandList))
+            *snapshot = 0;
+        runCommandLine(commandList, argv);
+    }
+    free(line);
+    fclose(file);
+    return commandList;
+}
+
+/**
+ * writeRecord, appends one record to a snapshot being written: first, then count more words.
+ *
+ * Args: A file, A struct, An integer, A string, An array of strings, A size_t
+ * Return: Nothing
+ */
+static void writeRecord(FILE *file, struct snapshotheader *header, int kind, const char *first, char **rest, size_t count)
+{
+    struct snapshotrecord record = {kind, count + 1, strlen(first) + 1, 0};
+    static const char padding[8];
+    for (size_t i = 0; i < count; i++)
+        record.length += strlen(rest[i]) + 1;
+    size_t unpadded = record.length;
+    record.length = (record.length + 7) & ~7U;
+    fwrite(&record, sizeof(record), 1, file);
+    fwrite(first, strlen(first) + 1, 1, file);
+    for (size_t i = 0; i < count; i++)
+        fwrite(rest[i], strlen(rest[i]) + 1, 1, file);
+    fwrite(padding, record.length - unpadded, 1, file);
+    header->count++;
+    header->length += sizeof(record) + record.length;
+}
+
+/**
+ * writeSnapshot, saves the state the rc file left behind: the final value of everything it set with
+ *                setenv, set and unset, every alias and the prompt. It is written to a temporary file and
+ *                renamed over the old image, so a shell starting at the same time never maps half of one.
+ *                A snapshot that can't be written is just made again next time.
+ *
+ * Args: A string, A struct
+ * Return: Nothing
+ */
+static void writeSnapshot(const char *path, const struct stat *rc)
+{
+    struct snapshotheader header;
+    char *temporary = malloc(strlen(path) + 5), *name, *value, *setting;
+    FILE *file;
+    int failed;
+    if (temporary == NULL)
+        return;
+    sprintf(temporary, "%s.tmp", path);
+    if ((file = fopen(temporary, "we")) == NULL)
+    {
+        free(temporary);
+        return;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.length = sizeof(header);
+    header.device = rc->st_dev;
+    header.inode = rc->st_ino;
+    header.size = rc->st_size;
+    header.mtimeSeconds = rc->st_mtim.tv_sec;
+    header.mtimeNanoseconds = rc->st_mtim.tv_nsec;
+    fwrite(&header, sizeof(header), 1, file);
+    for (size_t i = 0; i < touchedEnv.count; i++)
+        if ((value = getEnvVar(name = VECTOR_AT(touchedEnv, char *, i))) != NULL)
+            writeRecord(file, &header, SNAPSHOT_SETENV, name, &value, 1);
+    for (size_t i = 0; i < touchedVars.count; i++)
+    {
+        name = VECTOR_AT(touchedVars, char *, i);
+        if ((value = getShellVar(name)) == NULL)
+            writeRecord(file, &header, SNAPSHOT_UNSET, name, NULL, 0);
+        else if ((setting = malloc(strlen(name) + strlen(value) + 2)) != NULL)
+        {
+            sprintf(setting, "%s=%s", name, value);
+            writeRecord(file, &header, SNAPSHOT_SET, setting, NULL, 0);
+            free(setting);
+        }
+    }
+    for (size_t i = 0; i < aliasList.count; i++)
+    {
+        struct alias *alias = &VECTOR_AT(aliasList, struct alias, i);
+        writeRecord(file, &header, SNAPSHOT_ALIAS, alias->name, alias->words, alias->count);
+    }
+    if (promptCount > 0)
+        writeRecord(file, &header, SNAPSHOT_PROMPT, promptWords[0], promptWords + 1, promptCount - 1);
+    rewind(file);
+    fwrite(&header, sizeof(header), 1, file);
+    failed = ferror(file);
+    failed |= fclose(file) != 0;
+    if (failed || rename(temporary, path) != 0)
+        unlink(temporary);
+    free(temporary);
+}
+
+/**
+ * checkSnapshot, whether a mapped image is whole and was made from this rc file. Every record is checked
+ *                before any is used, so a damaged image changes nothing.
+ *
+ * Args: A pointer, A size_t, A struct
+ * Return: An integer
+ */
+static int checkSnapshot(const char *image, size_t length, const struct stat *rc)
+{
+    const struct snapshotheader *header = (const struct snapshotheader *)image;
+    const struct snapshotrecord *record;
+    size_t offset = sizeof(struct snapshotheader), words;
+    if (length < sizeof(struct snapshotheader) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->length != length || header->device != (int64_t)rc->st_dev ||
+        header->inode != (int64_t)rc->st_ino || header->size != (int64_t)rc->st_size ||
+        header->mtimeSeconds != (int64_t)rc->st_mtim.tv_sec || header->mtimeNanoseconds != (int64_t)rc->st_mtim.tv_nsec)
+        return 0;
+    for (uint32_t i = 0; i < header->count; i++)
+    {
+        if (length - offset < sizeof(struct snapshotrecord))
+            return 0;
+        record = (const struct snapshotrecord *)(image + offset);
+        offset += sizeof(struct snapshotrecord);
+        if (record->kind < SNAPSHOT_SETENV || record->kind > SNAPSHOT_PROMPT || record->words == 0 ||
+            record->length > length - offset || record->length % 8 != 0)
+            return 0;
+        words = 0;
+        for (uint32_t j = 0; j < record->length && words < record->words; j++)
+            words += image[offset + j] == '\0';
+        if (words != record->words)
+            return 0;
+        offset += record->length;
+    }
+    return offset == length;
+}
+
+/**
+ * loadSnapshot, brings back the state saved from the rc file by mapping the image and running each
+ *               record's builtin on the words right where they lie, with no reading, parsing, globbing or
+ *               alias expansion. The image is mapped private and writable since set writes into its
+ *               argument for a moment. PATH's directories are opened again by setenv, open fds can't be
+ *               saved. Returns 0 if the image is missing, stale or damaged, nothing is changed then.
+ *
+ * Args: A string, A struct
+ * Return: An integer
+ */
+static int loadSnapshot(const char *path, const struct stat *rc)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    struct snapshotrecord *record;
+    char *image, *word, **args;
+    size_t offset = sizeof(struct snapshotheader);
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct snapshotheader) ||
+        (image = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+    {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    if (!checkSnapshot(image, st.st_size, rc))
+    {
+        munmap(image, st.st_size);
+        return 0;
+    }
+    for (uint32_t i = 0; i < ((struct snapshotheader *)image)->count; i++)
+    {
+        record = (struct snapshotrecord *)(image + offset);
+        word = image + offset + sizeof(struct snapshotrecord);
+        offset += sizeof(struct snapshotrecord) + record->length;
+        if ((args = malloc((record->words + 2) * sizeof(char *))) == NULL)
+        {
+            perror("snapshot");
+            continue;
+        }
+        args[0] = (char *)recordCommands[record->kind];
+        for (uint32_t j = 1; j <= record->words; j++, word += strlen(word) + 1)
+            args[j] = word;
+        args[record->words + 1] = NULL;
+        runBuiltIn(args);
+        free(args);
+    }
+    munmap(image, st.st_size);
+    return 1;
+}
+
+/**
+ * freeRecorded, frees what recordCommand noted.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+static void freeRecorded()
+{
+    for (size_t i = 0; i < touchedEnv.count; i++)
+        free(VECTOR_AT(touchedEnv, char *, i));
+    for (size_t i = 0; i < touchedVars.count; i++)
+        free(VECTOR_AT(touchedVars, char *, i));
+    for (size_t i = 0; i < promptCount; i++)
+        free(promptWords[i]);
+    vectorFree(&touchedEnv);
+    vectorFree(&touchedVars);
+    free(promptWords);
+    promptWords = NULL;
+    promptCount = 0;
+}
+
+/**
+ * loadStartupFile, runs ~/.ssshrc (or $SSSH_RC) when the shell starts, quietly. If its snapshot was made
+ *                  from the file as it is now (same inode, size and mtime) the snapshot is mapped instead
+ *                  of running the file. Otherwise the file is run, and if every line only set things a
+ *                  snapshot can hold, a new one is written for next time, else any old one is removed.
+ *                  Returns the command list, which may have moved.
+ *
+ * Args: An array of strings, An array of strings
+ * Return: An array of strings
+ */
+char **loadStartupFile(char **commandList, char **argv)
+{
+    char *path = rcPath(), *snapshot;
+    int wasAnnouncing = announceCommands, canSnapshot = 1;
+    uint64_t rcStart = traceStart();
+    struct stat rc;
+    if (path == NULL)
+        return commandList;
+    if (stat(path, &rc) != 0)
+    {
+        if (errno != ENOENT)
+            perror(path);
+        free(path);
+        return commandList;
+    }
+    if ((snapshot = malloc(strlen(path) + strlen(SNAPSHOT_SUFFIX) + 1)) == NULL)
+    {
+        free(path);
+        return commandList;
+    }
+    sprintf(snapshot, "%s%s", path, SNAPSHOT_SUFFIX);
+    announceCommands = 0;
+    if (loadSnapshot(snapshot, &rc))
+        traceEnd("rc", rcStart, snapshot);
+    else
+    {
+        commandList = runRcFile(path, commandList, argv, &canSnapshot);
+        if (canSnapshot)
+            writeSnapshot(snapshot, &rc);
+        else
+            unlink(snapshot);
+        traceEnd("rc", rcStart, path);
+    }
+    outFlush();
+    announceCommands = wasAnnouncing;
+    freeRecorded();
+    free(snapshot);
+    free(path);
+    return commandList;
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef RC_H
+#define RC_H
+
+// startup file definitions
+#define RC_FILE ".ssshrc"               // In $HOME unless $SSSH_RC names another file
+#define SNAPSHOT_SUFFIX ".snapshot"     // The snapshot sits next to the rc file
+#define SNAPSHOT_MAGIC "SSSHSNAP"
+#define SNAPSHOT_VERSION 1              // Bump when a record changes meaning, old images are then remade
+
+// snapshot record kinds
+#define SNAPSHOT_SETENV 1               // setenv name value
+#define SNAPSHOT_SET 2                  // set name=value
+#define SNAPSHOT_UNSET 3                // unset name
+#define SNAPSHOT_ALIAS 4                // alias name words...
+#define SNAPSHOT_PROMPT 5               // prompt words...
+
+/* The start of a snapshot image. The rc file's identity is kept so a changed file is run again. */
+struct snapshotheader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;                     // Records that follow
+    uint64_t length;                    // Bytes in the whole image
+    int64_t device, inode, size;        // Of the rc file the image was made from
+    int64_t mtimeSeconds, mtimeNanoseconds;
+};
+
+/* One record, followed by its words, each ending in '\0', padded to a multiple of 8 bytes. */
+struct snapshotrecord {
+    uint32_t kind;
+    uint32_t words;
+    uint32_t length;                    // Bytes of words, padding included
+    uint32_t unused;
+};
+
+char **loadStartupFile(char **commandList, char **argv);
+
+#endif
@@ -0,0 +1,447 @@
+#include "resources.h"
+#include "output.h"
+#include "env.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Limits given to every job, named like tcsh's
+static struct resourcelimit limits[] = {
+    {.name = "cputime", .resource = RLIMIT_CPU, .kind = LIMIT_SECONDS},
+    {.name = "filesize", .resource = RLIMIT_FSIZE, .kind = LIMIT_KBYTES},
+    {.name = "datasize", .resource = RLIMIT_DATA, .kind = LIMIT_KBYTES},
+    {.name = "stacksize", .resource = RLIMIT_STACK, .kind = LIMIT_KBYTES},
+    {.name = "coredumpsize", .resource = RLIMIT_CORE, .kind = LIMIT_KBYTES},
+    {.name = "vmemoryuse", .resource = RLIMIT_AS, .kind = LIMIT_KBYTES},
+    {.name = "descriptors", .resource = RLIMIT_NOFILE, .kind = LIMIT_COUNT},
+    {.name = "maxproc", .resource = RLIMIT_NPROC, .kind = LIMIT_COUNT},
+    {.name = "memory", .resource = CGROUP_MEMORY, .kind = LIMIT_KBYTES},
+    {.name = "cpu", .resource = CGROUP_CPU, .kind = LIMIT_PERCENT},
+};
+#define LIMIT_COUNT_TOTAL (sizeof(limits) / sizeof(limits[0]))
+
+// cgroup globals, the jobs' cgroups live under cgroupBase
+static char *cgroupBase = NULL;
+static int cgroupState = 0;   // 0 not tried yet, 1 usable, -1 not usable
+static int cgroupCounter = 0;
+static int cgroupWarned = 0;  // Missing controllers are reported once per limit command
+
+/**
+ * findLimit, looks a limit up by name. Returns NULL if there is no such limit.
+ *
+ * Args: A string
+ * Return: A struct
+ */
+static struct resourcelimit *findLimit(const char *name)
+{
+    for (size_t i = 0; i < LIMIT_COUNT_TOTAL; i++)
+        if (strcmp(limits[i].name, name) == 0)
+            return &limits[i];
+    return NULL;
+}
+
+/**
+ * parseLimitValue, reads a value the way tcsh does: "unlimited", seconds for cputime (or a
+ *                  number followed by m or h, or mm:ss), kilobytes for sizes unless k, m or g
+ *                  follows. Returns -1 if it can't be read.
+ *
+ * Args: A struct, A string, A pointer to an rlim_t
+ * Return: An integer
+ */
+static int parseLimitValue(struct resourcelimit *limit, const char *text, rlim_t *value)
+{
+    char *end;
+    double number;
+    if (strcmp(text, "unlimited") == 0)
+    {
+        *value = RLIM_INFINITY;
+        return 0;
+    }
+    number = strtod(text, &end);
+    if (end == text || number < 0)
+        return -1;
+    if (limit->kind == LIMIT_SECONDS && *end == ':')
+        number = number * 60 + strtod(end + 1, &end);
+    else if (limit->kind == LIMIT_SECONDS && (*end == 'm' || *end == 'h'))
+        number *= *end++ == 'm' ? 60 : 3600;
+    else if (limit->kind == LIMIT_KBYTES)
+    {
+        number *= *end == 'm' ? 1024 * 1024 : *end == 'g' ? 1024 * 1024 * 1024 : 1024;
+        end += (*end == 'k' || *end == 'm' || *end == 'g');
+    }
+    if (*end != '\0' || (limit->kind == LIMIT_PERCENT && number < 1))
+        return -1;
+    *value = (rlim_t)number;
+    return 0;
+}
+
+/**
+ * printLimit, prints one limit as limit would show it: what a job started now would get.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void printLimit(struct resourcelimit *limit)
+{
+    struct rlimit current = {RLIM_INFINITY, RLIM_INFINITY};
+    rlim_t value = limit->value;
+    if (!limit->isSet)
+    {
+        if (limit->resource >= 0)
+            getrlimit(limit->resource, &current);
+        value = current.rlim_cur;
+    }
+    static const char *units[] = {"seconds", "bytes", "count", "percent"};
+    if (outputJson && value == RLIM_INFINITY)
+        outRecord("limit", "name:s value:s unit:s", limit->name, NULL, units[limit->kind]);
+    else if (outputJson)
+        outRecord("limit", "name:s value:l unit:s", limit->name, (long long)value, units[limit->kind]);
+    else if (value == RLIM_INFINITY)
+        outPrintf("%-13s unlimited\n", limit->name);
+    else if (limit->kind == LIMIT_SECONDS)
+        outPrintf("%-13s %lu:%02lu\n", limit->name, (unsigned long)value / 60, (unsigned long)value % 60);
+    else if (limit->kind == LIMIT_KBYTES)
+        outPrintf("%-13s %lu kbytes\n", limit->name, (unsigned long)(value / 1024));
+    else if (limit->kind == LIMIT_PERCENT)
+        outPrintf("%-13s %lu%%\n", limit->name, (unsigned long)value);
+    else
+        outPrintf("%-13s %lu\n", limit->name, (unsigned long)value);
+}
+
+/**
+ * setLimit, the limit builtin. "limit" prints every limit, "limit name" one of them and "limit [-h] name value"
+ *           sets what jobs started from now on get. Nothing is applied to the shell itself, the child sets
+ *           them just before execve. memory and cpu aren't rlimits: they put each job in its own cgroup v2
+ *           with memory.max and cpu.max set, where the cgroup tree is writable.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void setLimit(char **commandList)
+{
+    int hard = commandList[1] != NULL && strcmp(commandList[1], "-h") == 0;
+    char **args = commandList + 1 + hard;
+    struct resourcelimit *limit;
+    struct rlimit current;
+    rlim_t value;
+    if (args[0] == NULL)
+    {
+        for (size_t i = 0; i < LIMIT_COUNT_TOTAL; i++)
+            printLimit(&limits[i]);
+        return;
+    }
+    if ((limit = findLimit(args[0])) == NULL)
+    {
+        fprintf(stderr, " limit: %s: No such limit.\n", args[0]);
+        return;
+    }
+    if (args[1] == NULL)
+    {
+        printLimit(limit);
+        return;
+    }
+    if (args[2] != NULL || parseLimitValue(limit, args[1], &value) != 0)
+    {
+        fprintf(stderr, " limit: Improper or unknown scale factor.\n");
+        return;
+    }
+    // Only root can raise a hard limit, better to say so now than fail in every child
+    if (limit->resource >= 0 && getrlimit(limit->resource, &current) == 0 &&
+        value > current.rlim_max && geteuid() != 0)
+    {
+        fprintf(stderr, " limit: %s: Can't set limit (Operation not permitted)\n", limit->name);
+        return;
+    }
+    limit->isSet = 1;
+    limit->hard = hard;
+    cgroupWarned = 0;
+    limit->value = value;
+}
+
+/**
+ * removeLimit, the unlimit builtin. Forgets the limits named, or all of them with no arguments, so jobs
+ *              get the shell's own limits again.
+ *
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void removeLimit(char **commandList)
+{
+    int first = commandList[1] != NULL && strcmp(commandList[1], "-h") == 0 ? 2 : 1;
+    struct resourcelimit *limit;
+    if (commandList[first] == NULL)
+    {
+        for (size_t i = 0; i < LIMIT_COUNT_TOTAL; i++)
+            limits[i].isSet = 0;
+        return;
+    }
+    for (int i = first; commandList[i] != NULL; i++)
+    {
+        if ((limit = findLimit(commandList[i])) == NULL)
+            fprintf(stderr, " unlimit: %s: No such limit.\n", commandList[i]);
+        else
+            limit->isSet = 0;
+    }
+}
+
+/**
+ * applyJobLimits, called in the child between fork and execve. Sets every rlimit that was given with
+ *                 limit. Returns -1 if one couldn't be set.
+ *
+ * Args: Nothing
+ * Return: An integer
+ */
+int applyJobLimits()
+{
+    struct rlimit current;
+    for (size_t i = 0; i < LIMIT_COUNT_TOTAL; i++)
+    {
+        if (!limits[i].isSet || limits[i].resource < 0 || getrlimit(limits[i].resource, &current) != 0)
+            continue;
+        current.rlim_cur = limits[i].value;
+        if (limits[i].hard || current.rlim_max < limits[i].value)
+            current.rlim_max = limits[i].value;
+        if (setrlimit(limits[i].resource, &current) != 0)
+        {
+            perror(limits[i].name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * writeCgroupFile, writes a value to one of a cgroup's control files. Returns 0 on success.
+ *
+ * Args: Three strings
+ * Return: An integer
+ */
+static int writeCgroupFile(const char *cgroup, const char *file, const char *value)
+{
+    char path[PATH_MAX];
+    int fd, result;
+    snprintf(path, sizeof(path), "%s/%s", cgroup, file);
+    if ((fd = open(path, O_WRONLY | O_CLOEXEC)) < 0)
+        return -1;
+    result = write(fd, value, strlen(value)) == (ssize_t)strlen(value) ? 0 : -1;
+    close(fd);
+    return result;
+}
+
+/**
+ * readCgroupValue, reads the number after key in a cgroup file like cpu.stat, or the first number
+ *                  in the file when key is NULL. Returns -1 if it isn't there.
+ *
+ * Args: Three strings
+ * Return: A long long
+ */
+static long long readCgroupValue(const char *cgroup, const char *file, const char *key)
+{
+    char path[PATH_MAX], name[64];
+    long long value, found = -1;
+    FILE *stats;
+    snprintf(path, sizeof(path), "%s/%s", cgroup, file);
+    if ((stats = fopen(path, "re")) == NULL)
+        return -1;
+    if (key == NULL)
+    {
+        if (fscanf(stats, "%lld", &value) == 1)
+            found = value;
+    }
+    else
+    {
+        while (found < 0 && fscanf(stats, "%63s %lld", name, &value) == 2)
+            if (strcmp(name, key) == 0)
+                found = value;
+    }
+    fclose(stats);
+    return found;
+}
+
+/**
+ * initCgroups, makes the cgroup the jobs' cgroups go under, sssh-<pid> next to the shell's own cgroup
+ *              in the cgroup v2 tree (under the root if the shell is in the root), and turns on the
+ *              memory and cpu controllers for it where the tree allows. It can't go inside the shell's
+ *              own cgroup: with the shell in it, that cgroup can't hand controllers to children (the
+ *              no internal processes rule). Returns 0 if it could be made.
+ *
+ * Args: Nothing
+ * Return: An integer
+ */
+static int initCgroups()
+{
+    char line[PATH_MAX], mount[PATH_MAX] = "", own[PATH_MAX] = "", path[PATH_MAX * 2 + 32];
+    FILE *file;
+    if (cgroupState != 0)
+        return cgroupState > 0 ? 0 : -1;
+    cgroupState = -1;
+    // The cgroup2 mount, /sys/fs/cgroup or /sys/fs/cgroup/unified on hybrid systems
+    if ((file = fopen("/proc/self/mountinfo", "re")) != NULL)
+    {
+        while (mount[0] == '\0' && fgets(line, sizeof(line), file) != NULL)
+            if (strstr(line, " - cgroup2 ") != NULL)
+                sscanf(line, "%*s %*s %*s %*s %4095s", mount);
+        fclose(file);
+    }
+    if ((file = fopen("/proc/self/cgroup", "re")) != NULL)
+    {
+        while (own[0] == '\0' && fgets(line, sizeof(line), file) != NULL)
+            if (strncmp(line, "0::", 3) == 0)
+                sscanf(line + 3, "%4095s", own);
+        fclose(file);
+    }
+    if (mount[0] == '\0' || own[0] == '\0')
+        return -1;
+    // The parent of the shell's cgroup, the root is exempt from the rule and is its own parent here
+    *strrchr(own, '/') = '\0';
+    snprintf(path, sizeof(path), "%s%s", mount, own);
+    writeCgroupFile(path, "cgroup.subtree_control", "+memory +cpu"); // Usually on already, the shell's cgroup has them
+    snprintf(path + strlen(path), sizeof(path) - strlen(path), "/sssh-%d", getpid());
+    if (mkdir(path, 0755) != 0 && errno != EEXIST)
+        return -1;
+    writeCgroupFile(path, "cgroup.subtree_control", "+memory");
+    writeCgroupFile(path, "cgroup.subtree_control", "+cpu");
+    cgroupBase = strdup(path);
+    cgroupState = 1;
+    return 0;
+}
+
+/**
+ * createJobCgroup, makes a cgroup for the next job if memory or cpu is limited, or if the jobcgroups
+ *                  shell variable asks for one just to see the job's usage. Called before fork, the child
+ *                  joins it with joinJobCgroup. Returns its path, or NULL if no cgroup is wanted or none
+ *                  could be made. A cap whose controller isn't available is reported and skipped.
+ *
+ * Args: Nothing
+ * Return: A string
+ */
+char *createJobCgroup()
+{
+    struct resourcelimit *memory = findLimit("memory"), *cpu = findLimit("cpu");
+    char path[PATH_MAX], value[64];
+    if (!memory->isSet && !cpu->isSet && getShellVar("jobcgroups") == NULL)
+        return NULL;
+    if (initCgroups() != 0)
+    {
+        if (!cgroupWarned)
+            fprintf(stderr, " limit: no writable cgroup v2 tree, memory and cpu are not limited\n");
+        cgroupWarned = 1;
+        return NULL;
+    }
+    snprintf(path, sizeof(path), "%s/job-%d", cgroupBase, ++cgroupCounter);
+    if (mkdir(path, 0755) != 0)
+    {
+        perror(path);
+        return NULL;
+    }
+    if (memory->isSet)
+    {
+        if (memory->value == RLIM_INFINITY)
+            strcpy(value, "max");
+        else
+            snprintf(value, sizeof(value), "%lu", (unsigned long)memory->value);
+        if (writeCgroupFile(path, "memory.max", value) != 0 && !cgroupWarned)
+            fprintf(stderr, " limit: the memory controller isn't available, memory is not limited\n");
+    }
+    if (cpu->isSet)
+    {
+        if (cpu->value == RLIM_INFINITY)
+            snprintf(value, sizeof(value), "max %d", CGROUP_CPU_PERIOD);
+        else
+            snprintf(value, sizeof(value), "%lu %d", (unsigned long)cpu->value * CGROUP_CPU_PERIOD / 100, CGROUP_CPU_PERIOD);
+        if (writeCgroupFile(path, "cpu.max", value) != 0 && !cgroupWarned)
+            fprintf(stderr, " limit: the cpu controller isn't available, cpu is not limited\n");
+    }
+    cgroupWarned = 1;
+    return strdup(path);
+}
+
+/**
+ * joinJobCgroup, moves the calling child into the job's cgroup before it execs.
+ *
+ * Args: A string
+ * Return: Nothing
+ */
+void joinJobCgroup(const char *cgroup)
+{
+    if (cgroup != NULL && writeCgroupFile(cgroup, "cgroup.procs", "0") != 0)
+        perror("cgroup");
+}
+
+/**
+ * removeJobCgroup, removes a finished job's cgroup. It stays if something the job started is still
+ *                  running in it.
+ *
+ * Args: A string
+ * Return: Nothing
+ */
+void removeJobCgroup(const char *cgroup)
+{
+    if (cgroup != NULL)
+        rmdir(cgroup);
+}
+
+/**
+ * readJobUsage, the CPU time and memory a job is using now. With a cgroup that covers every process in
+ *               the job, from cpu.stat and memory.current. Otherwise only the job's first process is
+ *               counted, from /proc. Values that can't be read are -1. Returns 0 if anything was read.
+ *
+ * Args: A pid_t, A string, A pointer to a double, A pointer to a long long
+ * Return: An integer
+ */
+int readJobUsage(pid_t pid, const char *cgroup, double *cpuSeconds, long long *memoryBytes)
+{
+    char path[64];
+    unsigned long utime, stime;
+    long long usage, resident;
+    FILE *stat;
+    *cpuSeconds = -1;
+    *memoryBytes = -1;
+    if (cgroup != NULL)
+    {
+        if ((usage = readCgroupValue(cgroup, "cpu.stat", "usage_usec")) >= 0)
+            *cpuSeconds = usage / 1e6;
+        *memoryBytes = readCgroupValue(cgroup, "memory.current", NULL);
+    }
+    if (*cpuSeconds < 0)
+    {
+        snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+        if ((stat = fopen(path, "re")) != NULL)
+        {
+            // comm can hold spaces, so skip to the ) that ends it
+            if (fscanf(stat, "%*d (%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) == 2)
+                *cpuSeconds = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+            fclose(stat);
+        }
+    }
+    if (*memoryBytes < 0)
+    {
+        snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+        if ((stat = fopen(path, "re")) != NULL)
+        {
+            if (fscanf(stat, "%*s %lld", &resident) == 1)
+                *memoryBytes = resident * sysconf(_SC_PAGESIZE);
+            fclose(stat);
+        }
+    }
+    return *cpuSeconds >= 0 || *memoryBytes >= 0 ? 0 : -1;
+}
+
+/**
+ * freeResources, removes the shell's cgroup, if it is empty, and frees its path.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeResources()
+{
+    if (cgroupBase != NULL)
+        rmdir(cgroupBase);
+    free(cgroupBase);
+    cgroupBase = NULL;
+}
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+// resource limit definitions
+#define LIMIT_SECONDS 0
+#define LIMIT_KBYTES 1            // Sizes, given in kilobytes unless a k, m or g follows like tcsh
+#define LIMIT_COUNT 2
+#define LIMIT_PERCENT 3           // Percent of one CPU
+
+#define CGROUP_MEMORY -1          // Not an RLIMIT_*, written to the job's memory.max
+#define CGROUP_CPU -2             // Not an RLIMIT_*, written to the job's cpu.max
+#define CGROUP_CPU_PERIOD 100000  // Microseconds in a cpu.max period
+
+/* One limit the limit builtin knows. isSet means it overrides what the shell itself has. */
+struct resourcelimit {
+    const char *name;
+    int resource;             // RLIMIT_*, CGROUP_MEMORY or CGROUP_CPU
+    int kind;                 // LIMIT_SECONDS, LIMIT_KBYTES, LIMIT_COUNT or LIMIT_PERCENT
+    int isSet;
+    int hard;                 // Set with limit -h, the hard limit is lowered too
+    rlim_t value;             // Seconds, bytes, a count or a percent, RLIM_INFINITY for unlimited
+};
+
+void setLimit(char **commandList);
+void removeLimit(char **commandList);
+int applyJobLimits();
+char *createJobCgroup();
+void joinJobCgroup(const char *cgroup);
+void removeJobCgroup(const char *cgroup);
+int readJobUsage(pid_t pid, const char *cgroup, double *cpuSeconds, long long *memoryBytes);
+void freeResources();
+
+#endif
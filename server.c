@@ -0,0 +1,394 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Server globals
+static volatile sig_atomic_t serverStopping = 0;
+static struct sigaction shellInterrupt;   // The shell's SIGINT handling, put back in each session
+
+/**
+ * serverStopHandler, callback for SIGINT and SIGTERM in the server. The accept loop sees it and stops.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+static void serverStopHandler(int signal)
+{
+    serverStopping = 1;
+}
+
+/**
+ * readFully, reads exactly length bytes, however many reads that takes. Returns -1 on an error or
+ *            if the other end closes first.
+ *
+ * Args: An integer, A pointer, A size_t
+ * Return: An integer
+ */
+static int readFully(int fd, void *data, size_t length)
+{
+    size_t done = 0;
+    ssize_t got;
+    while (done < length)
+    {
+        if ((got = read(fd, (char *)data + done, length - done)) < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return -1;
+        done += got;
+    }
+    return 0;
+}
+
+/**
+ * writeFully, writes exactly length bytes. Returns -1 on an error.
+ *
+ * Args: An integer, A pointer, A size_t
+ * Return: An integer
+ */
+static int writeFully(int fd, const void *data, size_t length)
+{
+    size_t done = 0;
+    ssize_t put;
+    while (done < length)
+    {
+        if ((put = write(fd, (const char *)data + done, length - done)) < 0 && errno == EINTR)
+            continue;
+        if (put <= 0)
+            return -1;
+        done += put;
+    }
+    return 0;
+}
+
+/**
+ * findSocketPath, the path following option in the arguments, NULL if the option isn't there.
+ *
+ * Args: An integer, An array of strings, A string
+ * Return: A string
+ */
+static const char *findSocketPath(int argc, char **argv, const char *option)
+{
+    for (int i = 1; i + 1 < argc; i++)
+        if (strcmp(argv[i], option) == 0)
+            return argv[i + 1];
+    return NULL;
+}
+
+/**
+ * makeAddress, fills in a Unix socket address for path. Returns -1 if the path is too long for one.
+ *
+ * Args: A string, A struct
+ * Return: An integer
+ */
+static int makeAddress(const char *path, struct sockaddr_un *address)
+{
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path))
+    {
+        errno = ENAMETOOLONG;
+        perror(path);
+        return -1;
+    }
+    strcpy(address->sun_path, path);
+    return 0;
+}
+
+/**
+ * closeFds, closes every fd in the array that is open.
+ *
+ * Args: An array of integers
+ * Return: Nothing
+ */
+static void closeFds(int fds[SERVER_FD_COUNT])
+{
+    for (int i = 0; i < SERVER_FD_COUNT; i++)
+        if (fds[i] >= 0)
+            close(fds[i]);
+}
+
+/**
+ * receiveRequest, reads one request off a session's connection: the header with the client's stdin, stdout and stderr
+ *                 attached, then the working directory and the line. Returns -1 when the client is done or sent
+ *                 something that isn't a request, otherwise cwd and line are set and must be freed.
+ *
+ * Args: An integer, An array of integers, Two pointers to strings
+ * Return: An integer
+ */
+static int receiveRequest(int connection, int fds[SERVER_FD_COUNT], char **cwd, char **line)
+{
+    struct serverrequest request;
+    struct iovec vector = {&request, sizeof(request)};
+    struct msghdr message;
+    struct cmsghdr *header;
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * SERVER_FD_COUNT)];
+        struct cmsghdr align;
+    } control;
+    ssize_t got;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    for (int i = 0; i < SERVER_FD_COUNT; i++)
+        fds[i] = -1;
+    while ((got = recvmsg(connection, &message, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR);
+    if (got <= 0)
+        return -1;
+    if ((header = CMSG_FIRSTHDR(&message)) != NULL && header->cmsg_level == SOL_SOCKET &&
+        header->cmsg_type == SCM_RIGHTS && header->cmsg_len == CMSG_LEN(sizeof(int) * SERVER_FD_COUNT))
+        memcpy(fds, CMSG_DATA(header), sizeof(int) * SERVER_FD_COUNT);
+    // A stream socket may hand over the header in pieces, the fds come with the first one
+    if ((got < (ssize_t)sizeof(request) && readFully(connection, (char *)&request + got, sizeof(request) - got) != 0) ||
+        request.magic != SERVER_MAGIC || fds[0] < 0 || request.cwdLength >= PATH_MAX || request.lineLength > LINE_LIMIT_DEFAULT ||
+        (*cwd = calloc(request.cwdLength + 1, 1)) == NULL)
+    {
+        closeFds(fds);
+        return -1;
+    }
+    if ((*line = calloc(request.lineLength + 1, 1)) == NULL || readFully(connection, *cwd, request.cwdLength) != 0 ||
+        readFully(connection, *line, request.lineLength) != 0)
+    {
+        free(*cwd);
+        free(*line);
+        closeFds(fds);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * runSession, the forked process serving one client connection. It is a background subshell of the server, so it
+ *             starts with everything the server has warmed up and keeps its own working directory. Each request
+ *             moves the client's fds onto 0, 1 and 2, changes to the client's directory and runs the line through
+ *             parseBuffer and runCommandLine as if it were typed, then sends back the exit status. The fds go back
+ *             to /dev/null in between so the client's pipes see EOF.
+ *
+ * Args: An integer, An array of strings
+ * Return: Nothing
+ */
+static void runSession(int connection, char **argv)
+{
+    int fds[SERVER_FD_COUNT], empty;
+    char *cwd, *line, **commandList;
+    int32_t status;
+    sigaction(SIGINT, &shellInterrupt, NULL);
+    signal(SIGTERM, SIG_IGN);
+    enterSubshell(0);
+    inSubshell = 1;
+    threadExists = 0;
+    announceCommands = 0;
+    jobTimeout = 0;
+    commandList = growCommandList(NULL, &commandCapacity, ARGV_INITIAL);
+    while (commandList != NULL && receiveRequest(connection, fds, &cwd, &line) == 0)
+    {
+        for (int i = 0; i < SERVER_FD_COUNT; i++)
+        {
+            dup2(fds[i], i);
+            close(fds[i]);
+        }
+        lastExitStatus = 0;
+        if (cwd[0] != '\0' && changeTo(cwd) != 0)
+        {
+            perror(cwd);
+            lastExitStatus = 1;
+        }
+        else if ((commandList = parseBuffer(line, commandList)) != NULL && commandList[0] != NULL)
+            runCommandLine(commandList, argv);
+        outFlush();
+        fflush(stdout);
+        fflush(stderr);
+        if ((empty = open("/dev/null", O_RDWR)) >= 0)
+        {
+            for (int i = 0; i < SERVER_FD_COUNT; i++)
+                dup2(empty, i);
+            close(empty);
+        }
+        status = lastExitStatus;
+        free(cwd);
+        free(line);
+        if (writeFully(connection, &status, sizeof(status)) != 0)
+            break;
+    }
+    _exit(0);
+}
+
+/**
+ * isServerRun, whether sssh was started as a server with --server.
+ *
+ * Args: An integer, An array of strings
+ * Return: An integer
+ */
+int isServerRun(int argc, char **argv)
+{
+    return findSocketPath(argc, argv, "--server") != NULL;
+}
+
+/**
+ * runServer, sssh --server SOCKET. Listens on a Unix socket and forks a session (see runSession) for every client
+ *            that connects, so any number run at once. Only the user running the server may connect. The socket is
+ *            removed when the server gets SIGINT or SIGTERM. Returns 0, or 1 if it couldn't start.
+ *
+ * Args: An integer, An array of strings
+ * Return: An integer
+ */
+int runServer(int argc, char **argv)
+{
+    const char *path = findSocketPath(argc, argv, "--server");
+    struct sockaddr_un address;
+    struct sigaction action;
+    struct ucred peer;
+    socklen_t peerLength;
+    mode_t mask;
+    int listener, connection, probe;
+    pid_t pid;
+    if (makeAddress(path, &address) != 0 || (listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+        return 1;
+    // A socket someone still answers on belongs to a live server, a dead one's is just left over
+    if ((probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) >= 0)
+    {
+        if (connect(probe, (struct sockaddr *)&address, sizeof(address)) == 0)
+        {
+            fprintf(stderr, "%s: a server is already running there\n", path);
+            close(probe);
+            close(listener);
+            return 1;
+        }
+        close(probe);
+    }
+    unlink(path);
+    mask = umask(077);
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, SERVER_BACKLOG) != 0)
+    {
+        perror(path);
+        umask(mask);
+        close(listener);
+        return 1;
+    }
+    umask(mask);
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serverStopHandler; // No SA_RESTART, accept has to return to see it
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &shellInterrupt);
+    sigaction(SIGTERM, &action, NULL);
+    warmCommandIndex();
+    fprintf(stderr, "sssh: serving on %s\n", path);
+    while (!serverStopping)
+    {
+        while (waitpid(-1, NULL, WNOHANG) > 0); // Sessions that have ended
+        if ((connection = accept4(listener, NULL, NULL, SOCK_CLOEXEC)) < 0)
+        {
+            if (errno != EINTR)
+                perror("accept");
+            continue;
+        }
+        peerLength = sizeof(peer);
+        if (getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &peer, &peerLength) != 0 || peer.uid != getuid())
+        {
+            close(connection);
+            continue;
+        }
+        outFlush();
+        fflush(stdout);
+        if ((pid = fork()) < 0)
+            perror("fork error");
+        else if (pid == 0)
+        {
+            close(listener);
+            runSession(connection, argv);
+        }
+        close(connection);
+    }
+    close(listener);
+    unlink(path);
+    sigaction(SIGINT, &shellInterrupt, NULL);
+    return 0;
+}
+
+/**
+ * isClientRun, whether sssh was started as a client with --client.
+ *
+ * Args: An integer, An array of strings
+ * Return: An integer
+ */
+int isClientRun(int argc, char **argv)
+{
+    return argc > 1 && strcmp(argv[1], "--client") == 0;
+}
+
+/**
+ * runClient, sssh --client SOCKET command [args...]. The thin client: it does none of the shell's startup, just
+ *            sends the words after the socket as one command line to the server, with its own stdin, stdout, stderr
+ *            and working directory, and waits for the exit status, which it exits with.
+ *
+ * Args: An integer, An array of strings
+ * Return: An integer
+ */
+int runClient(int argc, char **argv)
+{
+    struct serverrequest request = {SERVER_MAGIC, 0, 0};
+    struct sockaddr_un address;
+    struct iovec vector = {&request, sizeof(request)};
+    struct msghdr message;
+    struct cmsghdr *header;
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * SERVER_FD_COUNT)];
+        struct cmsghdr align;
+    } control;
+    int fds[SERVER_FD_COUNT] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO}, connection;
+    char cwd[PATH_MAX] = "", *line;
+    size_t length = 0;
+    int32_t status;
+    if (argc < 4)
+    {
+        fprintf(stderr, "usage: %s --client SOCKET command [args...]\n", argv[0]);
+        return 2;
+    }
+    for (int i = 3; i < argc; i++)
+        length += strlen(argv[i]) + 1;
+    if ((line = calloc(length + 1, 1)) == NULL)
+        return SERVER_LOST_STATUS;
+    for (int i = 3; i < argc; i++)
+    {
+        if (i > 3)
+            strcat(line, " ");
+        strcat(line, argv[i]);
+    }
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+        cwd[0] = '\0';
+    request.cwdLength = strlen(cwd);
+    request.lineLength = strlen(line);
+    if (makeAddress(argv[2], &address) != 0 || (connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0 ||
+        connect(connection, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        perror(argv[2]);
+        free(line);
+        return SERVER_LOST_STATUS;
+    }
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(header), fds, sizeof(fds));
+    if (sendmsg(connection, &message, 0) != sizeof(request) || writeFully(connection, cwd, request.cwdLength) != 0 ||
+        writeFully(connection, line, request.lineLength) != 0 || readFully(connection, &status, sizeof(status)) != 0)
+    {
+        fprintf(stderr, "%s: the server closed the connection\n", argv[2]);
+        status = SERVER_LOST_STATUS;
+    }
+    close(connection);
+    free(line);
+    return status;
+}
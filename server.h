@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+// client/server definitions
+#define SERVER_MAGIC 0x73737368   // "sssh"
+#define SERVER_BACKLOG 64
+#define SERVER_FD_COUNT 3         // The client's stdin, stdout and stderr ride along with every request
+#define SERVER_LOST_STATUS 255    // What the client exits with if the server never answers
+
+/* Sent ahead of each request with the client's three fds attached, followed by
+   cwdLength bytes of working directory and lineLength bytes of command line.
+   The answer is the line's exit status as an int32_t. */
+struct serverrequest {
+    uint32_t magic;
+    uint32_t cwdLength;
+    uint32_t lineLength;
+};
+
+int isServerRun(int argc, char **argv);
+int runServer(int argc, char **argv);
+int isClientRun(int argc, char **argv);
+int runClient(int argc, char **argv);
+
+#endif
@@ -11,118 +11,280 @@
 // Globals
 char *prefix = NULL;
 char *last_dir = NULL;
-int timeout = 0;
-int isChildDone = 0;
-int pid;
 int threadExists = 0;
 pthread_t watchUserID;
 pthread_mutex_t mutexLock;
 int hasNoClobber = 0;
-
-void sigHandler(int signal) {
-  if (signal == SIGINT) {
-    // For ctrl+c
-    printf(" Interrupt\n");
-    printShell();
-    fflush(stdout);
-  }
-}
+int lastExitStatus = 0;
+size_t commandCapacity = 0; // Slots allocated in the main loop's commandList
+int inSubshell = 0;         // Set in the child running a ( ... ) group
+int announceCommands = 1;   // Print "Executing: ...", off while capturing a substitution
+const char *builtInCommands[BUILT_IN_COMMAND_COUNT] = {"exit", "which", "where", "cd", "pwd", "list", "pid", "kill", "prompt",
+                                                       "printenv", "setenv", "watchuser", "watchmail", "noclobber",
+                                                       "jobs", "fg", "bg", "memo", "set", "unset", "watchfile",
+                                                       "limit", "unlimit", "pushd", "popd", "dirs", "z", "procs", "joblog",
+                                                       "alias", "unalias"};
 
 int main(int argc, char **argv, char **envp)
 {
+    if (isClientRun(argc, argv))
+        return runClient(argc, argv); // The client skips all of the shell's startup
     last_dir = getcwd(NULL, 0);
-    // Signal setup
-    signal(SIGCHLD, childHandler);
-    sigignore(SIGTSTP); // Ignore control z
-    sigignore(SIGTERM); // Ignore control z and control c
-    signal(SIGINT, sigHandler); // more control c handler
-    char buffer[BUFFERSIZE], **commandList;
-    struct pathelement *pathList = getPath();
-    commandList = calloc(MAX_CMD, sizeof(char *));
+    loadEnvironment(envp);
+    // Signal and terminal setup
+    initJobControl();
+    char *line, *promptString, **commandList;
+    updatePath(getEnvVar("PATH"));
+    if (getEnvVar("SSSH_TRACE") != NULL && getEnvVar("SSSH_TRACE")[0] != '\0')
+    {
+        setShellVar("trace", getEnvVar("SSSH_TRACE"));
+        enableTracing(getEnvVar("SSSH_TRACE"));
+    }
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--json") == 0)
+        {
+            setShellVar("output", "json");
+            setOutputFormat("json");
+        }
+    commandList = growCommandList(NULL, &commandCapacity, ARGV_INITIAL);
+    if (isBatchRun(argc, argv))
+    {
+        lastExitStatus = runBatch(argc, argv);
+        freeAndExit(commandList);
+    }
+    if (isServerRun(argc, argv))
+    {
+        lastExitStatus = runServer(argc, argv);
+        freeAndExit(commandList);
+    }
+    initCompletion(builtInCommands, BUILT_IN_COMMAND_COUNT);
+    commandList = loadStartupFile(commandList, argv);
+    if (isatty(STDIN_FILENO))
+        warmCommandIndex();
 
-    printf("Welcome to sssh\nThe shell so bad it will make you mad\n");
+    if (!outputJson)
+        printf("Welcome to sssh\nThe shell so bad it will make you mad\n");
 
     // Main loop for shell
     while (1)
     {
-        printShell();
-        if (fgets(buffer, BUFFERSIZE, stdin) == NULL)
+        reapJobs();
+        // Records only on a pipe, no prompt in between them
+        promptString = outputJson && !isatty(STDIN_FILENO) ? strdup("") : getPrompt();
+        line = readLine(promptString);
+        free(promptString);
+        if (line == NULL)
         { 
             // Ignore ctrl+d / EOF
             printf("^D\nUse \"exit\" to leave shell.\n");
             continue; // Continue just ignores the rest of the loop and continues to the next iteration
         }
 
-        // Handle \n appended by fgets()
-        buffer[strlen(buffer) - 1] = '\0';
-        if (strlen(buffer) < 1)
+        if (strlen(line) < 1)
+        {
+            free(line);
+            continue;
+        }
+        commandList = parseBuffer(line, commandList);
+        free(line);
+        if (commandList[0] == NULL)
             continue;
-        commandList = parseBuffer(buffer, commandList);
         // Execute whatever command was entered by the user
-        executeBuiltInFunctions(commandList, envp, pathList, argv);
+        runCommandLine(commandList, argv);
     }
 }
 
 /**
- * parseBuffer, gets the string produced by fgets and tokenizes it via strtok. This handles allocating memory for the commandList
- *              be it the commands entered by the user or the glob paths found by the glob(3) library function. This function
- *              returns the command list and of course, it must be reset and freed in the sh function. If globbing is detected
- *              and no patterns are found, an error message is displayed but the command preceding the glob will still go through.
+ * operatorLength, the length of the control operator at the start of text: 2 for "&&" and "||", 1 for ";", "(" and ")",
+ *                 0 if there isn't one. These are split into their own words even when typed against other words, a
+ *                 single & or | is left alone so "|&", ">&" and a trailing "&" keep working.
  * 
- * Args: A string, An array of strings
+ * Args: A string
+ * Return: An integer
+ */
+int operatorLength(const char *text)
+{
+    if (strncmp(text, "&&", 2) == 0 || strncmp(text, "||", 2) == 0)
+        return 2;
+    if (*text == ';' || *text == '(' || *text == ')')
+        return 1;
+    return 0;
+}
+
+/**
+ * appendWord, adds one word to the command list, or every path it matches if it is a glob pattern. Words with a command
+ *             substitution in them are left for expandWord to glob after expanding, and an alias's \!* isn't a pattern.
+ *             The list grows as needed. Returns the list (which may have moved), or NULL if memory ran out.
+ * 
+ * Args: An array of strings, Two pointers to a size_t, A string
  * Return: An array of strings
  */
-char **parseBuffer(char buffer[], char **commandList)
+char **appendWord(char **commandList, size_t *count, size_t *capacity, char *word)
 {
     int csource;
-    char *token;
+    char **grown;
     glob_t paths;
-    token = strtok(buffer, " ");
-    for (int i = 0; token != NULL;)
+    uint64_t globStart;
+    if ((strstr(word, "*") != NULL || strstr(word, "?") != NULL) && !hasSubstitution(word) && strstr(word, "\\!") == NULL)
     {
-        if ((strstr(token, "*") != NULL) || (strstr(token, "?") != NULL))
+        globStart = traceStart();
+        csource = glob(word, 0, NULL, &paths);
+        traceEnd("glob", globStart, word);
+        if (csource != 0)
         {
-            csource = glob(token, 0, NULL, &paths);
-            if (csource == 0)
-            {
-                for (char **p = paths.gl_pathv; *p != NULL; p++)
-                {
-                    commandList[i] = (char *)malloc((int)strlen(*p) + 1);
-                    strcpy(commandList[i], *p);
-                    i++;
-                }
-                globfree(&paths);
-            }
-            else
+            errno = ENOENT;
+            perror("glob");
+            return commandList;
+        }
+        if ((grown = growCommandList(commandList, capacity, *count + paths.gl_pathc + 1)) != NULL)
+            for (char **p = paths.gl_pathv; *p != NULL; p++)
+                grown[(*count)++] = strdup(*p);
+        globfree(&paths);
+        return grown;
+    }
+    if ((grown = growCommandList(commandList, capacity, *count + 2)) != NULL)
+        grown[(*count)++] = strdup(word);
+    return grown;
+}
+
+/**
+ * parseBuffer, gets the line read by readLine and splits it into the main loop's command list with tokenizeLine, then
+ *              expands any aliases in it. One left much bigger than usual by a huge line is shrunk back first, so memory
+ *              stays proportional to the line.
+ *              This function returns the command list (which may have moved) and of course, it must be reset and freed
+ *              in the sh function.
+ * 
+ * Args: A string, An array of strings
+ * Return: An array of strings
+ */
+char **parseBuffer(char buffer[], char **commandList)
+{
+    char **grown;
+    uint64_t parseStart = traceStart();
+    if (commandCapacity > ARGV_KEEP_MAX && (grown = realloc(commandList, ARGV_INITIAL * sizeof(char *))) != NULL)
+    {
+        commandList = grown;
+        commandCapacity = ARGV_INITIAL;
+    }
+    commandList = tokenizeLine(buffer, commandList, &commandCapacity);
+    commandList = expandAliases(commandList, &commandCapacity);
+    traceEnd("parse", parseStart, commandList[0]);
+    return commandList;
+}
+
+/**
+ * tokenizeLine, splits a line into words on spaces and tabs. Control operators are split out of the words they are typed
+ *               against (see operatorLength), a $( ... ) or ` ... ` is kept whole inside its word, spaces and all, for
+ *               runGroup to expand when the command runs, and every word goes through appendWord, which expands glob
+ *               patterns with the glob(3) library function. The list grows geometrically to fit however many words and
+ *               glob paths there are, pass NULL and a zero capacity for a new one. If globbing is detected and no patterns
+ *               are found, an error message is displayed but the command preceding the glob will still go through. If memory
+ *               runs out or a substitution isn't closed the whole line is dropped and an empty list is returned. Returns
+ *               NULL only if not even that could be allocated.
+ * 
+ * Args: A string, An array of strings, A pointer to a size_t
+ * Return: An array of strings
+ */
+char **tokenizeLine(char *line, char **commandList, size_t *capacity)
+{
+    size_t count = 0, length = 0;
+    int operator, failed = 0;
+    char *word = malloc(strlen(line) + 1), **grown;
+    const char *end;
+    if ((grown = growCommandList(commandList, capacity, 1)) == NULL || word == NULL)
+    {
+        free(word);
+        return grown;
+    }
+    commandList = grown;
+    for (char *p = line; !failed; p++)
+    {
+        operator = *p == '\0' ? 0 : operatorLength(p);
+        if (*p == ' ' || *p == '\t' || *p == '\0' || operator > 0)
+        {
+            // End of a word, then the operator if that is what ended it
+            word[length] = '\0';
+            if (length > 0 && (grown = appendWord(commandList, &count, capacity, word)) == NULL)
+                failed = 1;
+            commandList = length > 0 && grown ? grown : commandList;
+            if (!failed && operator > 0 && (grown = growCommandList(commandList, capacity, count + 2)) == NULL)
+                failed = 1;
+            else if (!failed && operator > 0)
             {
-                errno = ENOENT;
-                perror("glob");
+                commandList = grown;
+                commandList[count++] = strndup(p, operator);
             }
+            length = 0;
+            if (*p == '\0')
+                break;
+            p += operator > 0 ? operator - 1 : 0;
+        }
+        else if ((strncmp(p, "$(", 2) == 0 || *p == '`') && (end = findSubstitutionEnd(p)) == NULL)
+        {
+            fprintf(stderr, "sssh: unterminated command substitution\n");
+            failed = 1;
+        }
+        else if (strncmp(p, "$(", 2) == 0 || *p == '`')
+        {
+            memcpy(word + length, p, end - p + 1);
+            length += end - p + 1;
+            p = (char *)end;
         }
         else
         {
-            commandList[i] = (char *)malloc((int)strlen(token) + 1);
-            strcpy(commandList[i], token);
-            i++;
+            word[length++] = *p;
         }
-        token = strtok(NULL, " ");
     }
+    if (failed)
+    {
+        while (count > 0)
+            free(commandList[--count]);
+    }
+    commandList[count] = NULL;
+    free(word);
     return commandList;
 }
 
+/**
+ * growCommandList, makes sure an argument vector has room for needed entries, doubling its capacity until it does.
+ *                  Pass NULL and a zero capacity to allocate a new one. Returns the vector, which may have moved,
+ *                  or NULL with the old vector untouched if memory ran out.
+ * 
+ * Args: An array of strings, A pointer to a size_t, A size_t
+ * Return: An array of strings
+ */
+char **growCommandList(char **commandList, size_t *capacity, size_t needed)
+{
+    size_t newCapacity = *capacity > 0 ? *capacity : ARGV_INITIAL;
+    char **grown;
+    if (commandList != NULL && needed <= *capacity)
+        return commandList;
+    while (newCapacity < needed)
+        newCapacity *= 2;
+    if ((grown = realloc(commandList, newCapacity * sizeof(char *))) == NULL)
+    {
+        perror("command too long");
+        return NULL;
+    }
+    memset(grown + *capacity, 0, (newCapacity - *capacity) * sizeof(char *));
+    *capacity = newCapacity;
+    return grown;
+}
+
 /**
  * executeBuiltInFunctions, this is the function that is ultimately responsible for running every other function in this file at some point. 
  *            First if a pipe was entered as a command, the handlePipes function is called to use its special logic for
  *            properly running a piped command. Next, if no pipe was found, runCommand is called to run normal commands that
  *            don't use pipes. This will be either an external or built-in command.
  * 
- * Args: Three arrays of strings, a struct
+ * Args: Two arrays of strings
  * Return: Nothing
  */
-void executeBuiltInFunctions(char **commandList, char **envp, struct pathelement *pathList, char **argv)
+void executeBuiltInFunctions(char **commandList, char **argv)
 {
-    if (!handlePipes(commandList, envp, pathList, argv))
-        runExecutable(commandList, envp, pathList, argv);
+    if (!handlePipes(commandList, argv))
+        runExecutable(commandList, argv);
+    outFlush();
     for (int i = 0; commandList[i] != NULL; i++)
     {
         free(commandList[i]);
@@ -130,6 +292,271 @@ void executeBuiltInFunctions(char **commandList, char **envp, struct pathelement
     }
 }
 
+/**
+ * runCommandLine, runs a whole line of words from parseBuffer: commands joined by ;, &, && and ||, and grouped with
+ *                 ( ... ) in a subshell or { ... } in this shell. The line is checked once without running anything so a
+ *                 syntax error anywhere runs nothing, then run for real. The words are freed afterwards.
+ * 
+ * Args: Two arrays of strings
+ * Return: An integer
+ */
+int runCommandLine(char **commandList, char **argv)
+{
+    int count = 0;
+    while (commandList[count] != NULL)
+        count++;
+    clearStatCache();
+    if (runList(commandList, 0, count, argv, 0) == SYNTAX_ERROR)
+        lastExitStatus = 2;
+    else
+        lastExitStatus = runList(commandList, 0, count, argv, 1);
+    for (int i = 0; i < count; i++)
+    {
+        free(commandList[i]);
+        commandList[i] = NULL;
+    }
+    return lastExitStatus;
+}
+
+/**
+ * groupDelta, tells whether the word at index i opens a group (1), closes one (-1) or neither (0). ( and ) always do,
+ *             { and } only where a command could start, so "echo }" is just an argument like in sh.
+ * 
+ * Args: An array of strings, An integer
+ * Return: An integer
+ */
+int groupDelta(char **commandList, int i)
+{
+    const char *before[] = {";", "&", "&&", "||", "(", ")", "{", "}"};
+    int commandPosition = i == 0;
+    for (size_t j = 0; j < sizeof(before) / sizeof(before[0]) && !commandPosition; j++)
+        commandPosition = strcmp(commandList[i - 1], before[j]) == 0;
+    if (strcmp(commandList[i], "(") == 0 || (commandPosition && strcmp(commandList[i], "{") == 0))
+        return 1;
+    if (strcmp(commandList[i], ")") == 0 || (commandPosition && strcmp(commandList[i], "}") == 0))
+        return -1;
+    return 0;
+}
+
+/**
+ * findGroupEnd, finds the word that closes the group opened at index open. Returns -1 if the group isn't closed
+ *               before end or is closed by the wrong kind of bracket.
+ * 
+ * Args: An array of strings, Two integers
+ * Return: An integer
+ */
+int findGroupEnd(char **commandList, int open, int end)
+{
+    int depth = 0;
+    for (int i = open; i < end; i++)
+        if ((depth += groupDelta(commandList, i)) == 0)
+            return commandList[i][0] == (commandList[open][0] == '(' ? ')' : '}') ? i : -1;
+    return -1;
+}
+
+/**
+ * syntaxError, reports the word the parser didn't expect.
+ * 
+ * Args: A string
+ * Return: An integer
+ */
+int syntaxError(const char *word)
+{
+    fprintf(stderr, "sssh: syntax error near unexpected token `%s'\n", word);
+    return SYNTAX_ERROR;
+}
+
+/**
+ * runList, runs the and-or lists between start and end that are separated by ; or &. A & stays with the command
+ *          before it so that command goes to the background. A command killed by ctrl+c stops the rest of the list,
+ *          like in sh. Returns the status of the last one run. With execute
+ *          at 0 nothing runs and SYNTAX_ERROR is returned if the words don't parse.
+ * 
+ * Args: An array of strings, Two integers, An array of strings, An integer
+ * Return: An integer
+ */
+int runList(char **commandList, int start, int end, char **argv, int execute)
+{
+    int status = 0, depth = 0, from = start, stop;
+    for (int i = start; i <= end; i++)
+    {
+        if (i < end)
+        {
+            if ((depth += groupDelta(commandList, i)) < 0)
+                return syntaxError(commandList[i]);
+            if (depth > 0 || (strcmp(commandList[i], ";") != 0 && (strcmp(commandList[i], "&") != 0 || i + 1 == end)))
+                continue;
+        }
+        stop = i < end && commandList[i][0] == '&' ? i + 1 : i;
+        if (stop > from)
+        {
+            if ((status = runAndOr(commandList, from, stop, argv, execute)) == SYNTAX_ERROR || status == 128 + SIGINT)
+                return status; // Ctrl+c abandons the rest of the line
+        }
+        else if (i < end)
+        {
+            return syntaxError(commandList[i]);
+        }
+        from = i + 1;
+    }
+    return status;
+}
+
+/**
+ * runAndOr, runs the commands between start and end that are joined by && and ||, left to right. A command after &&
+ *           only runs if the status so far is 0, one after || only if it isn't, so "make && ./run || echo fail" works
+ *           like in sh. Skipping is decided here in the shell, no process is spawned for it.
+ * 
+ * Args: An array of strings, Two integers, An array of strings, An integer
+ * Return: An integer
+ */
+int runAndOr(char **commandList, int start, int end, char **argv, int execute)
+{
+    int status = 0, depth = 0, from = start, skip = 0, result;
+    for (int i = start; i <= end; i++)
+    {
+        if (i < end)
+        {
+            depth += groupDelta(commandList, i);
+            if (depth > 0 || (strcmp(commandList[i], "&&") != 0 && strcmp(commandList[i], "||") != 0))
+                continue;
+        }
+        if (i == from)
+            return syntaxError(i < end ? commandList[i] : commandList[i - 1]);
+        if (!skip || !execute)
+        {
+            if ((result = runGroup(commandList, from, i, argv, execute)) == SYNTAX_ERROR || result == 128 + SIGINT)
+                return result;
+            status = result;
+        }
+        if (i < end)
+            skip = commandList[i][0] == '&' ? status != 0 : status == 0;
+        from = i + 1;
+    }
+    return status;
+}
+
+/**
+ * runGroup, runs one command between start and end. A ( ... ) group runs in a subshell, a { ... } group runs its list
+ *           right here, and anything else (a simple command or a pipe) goes to executeBuiltInFunctions, after any command
+ *           substitutions in it are expanded. A group followed by & runs in a background subshell. Returns the exit status.
+ * 
+ * Args: An array of strings, Two integers, An array of strings, An integer
+ * Return: An integer
+ */
+int runGroup(char **commandList, int start, int end, char **argv, int execute)
+{
+    int delta = groupDelta(commandList, start), close, background;
+    size_t count = 0, capacity = 0;
+    char **segment, **grown;
+    if (delta < 0)
+        return syntaxError(commandList[start]);
+    if (delta > 0)
+    {
+        if ((close = findGroupEnd(commandList, start, end)) < 0)
+            return syntaxError("newline");
+        if (close == start + 1)
+            return syntaxError(commandList[close]);
+        background = close + 2 == end && strcmp(commandList[close + 1], "&") == 0;
+        if (close + 1 != end && !background)
+            return syntaxError(commandList[close + 1]);
+        if (!execute || (commandList[start][0] == '{' && !background))
+            return runList(commandList, start + 1, close, argv, execute);
+        return runSubshell(commandList, start + 1, close, background, argv);
+    }
+    for (int i = start; i < end; i++)
+        if (groupDelta(commandList, i) != 0)
+            return syntaxError(commandList[i]);
+    if (!execute)
+        return 0;
+    if ((segment = growCommandList(NULL, &capacity, end - start + 1)) == NULL)
+        return 1;
+    for (int i = start; i < end && segment != NULL; i++)
+    {
+        if (hasSubstitution(commandList[i]))
+            grown = expandWord(commandList[i], segment, &count, &capacity, argv);
+        else if ((grown = growCommandList(segment, &capacity, count + 2)) != NULL)
+            grown[count++] = strdup(commandList[i]);
+        if (grown == NULL)
+        {
+            while (count > 0)
+                free(segment[--count]);
+            free(segment);
+            return lastExitStatus ? lastExitStatus : 1;
+        }
+        segment = grown;
+    }
+    segment[count] = NULL;
+    if (count > 0)
+        executeBuiltInFunctions(segment, argv);
+    free(segment);
+    return lastExitStatus;
+}
+
+/**
+ * runSubshell, forks a copy of the shell to run the list between start and end, as its own job. The child takes over
+ *              job control for what it runs and exits with the list's status. The parent waits for it like any other
+ *              foreground job, or reports it and moves on if it runs in the background.
+ * 
+ * Args: An array of strings, Three integers, An array of strings
+ * Return: An integer
+ */
+int runSubshell(char **commandList, int start, int end, int background, char **argv)
+{
+    int status = 0, spool = background ? createJobSpool() : -1;
+    pid_t pid;
+    struct job *job;
+    char **described;
+    outFlush();
+    fflush(stderr);
+    if ((pid = fork()) < 0)
+    {
+        perror("fork error");
+        if (spool >= 0)
+            releaseJobSpool(spool, 1);
+        return 1;
+    }
+    if (pid == 0)
+    {
+        if (spool >= 0)
+        {
+            dup2(spool, STDOUT_FILENO);
+            dup2(spool, STDERR_FILENO);
+            close(spool);
+        }
+        enterSubshell(!background);
+        inSubshell = 1;
+        threadExists = 0;
+        status = runList(commandList, start, end, argv, 1);
+        outFlush();
+        fflush(stderr);
+        _exit(status);
+    }
+    setpgid(pid, pid);
+    // The job is described by the group with its brackets
+    if ((described = calloc(end - start + 3, sizeof(char *))) != NULL)
+        memcpy(described, commandList + start - 1, (end - start + 2) * sizeof(char *));
+    if (described == NULL || (job = addJob(pid, described)) == NULL)
+    {
+        perror("job");
+        if (spool >= 0)
+            releaseJobSpool(spool, 1);
+    }
+    else
+    {
+        job->spool = spool;
+        if (background && outputJson)
+            outRecord("job", "id:d pid:d state:s command:s", job->id, pid, "running", job->command);
+        else if (background)
+            outPrintf("[%d] %d\n", job->id, pid);
+        else
+            status = waitForJob(job, 0);
+    }
+    outFlush();
+    free(described);
+    return status;
+}
+
 /**
  * shouldRunAsBackground, searches through the commandList array tokenized in the main loop and returns
  *                        1 if the & (ampersand) character appears at the end of the array as an indicator
@@ -160,106 +587,306 @@ int shouldRunAsBackground(char **commandList)
  *                checking fore redirection are called. THe path for the external command is returned, either sn absolute, ie. contains
  *                a "./" or "../", or "/", or something of the like, or the which function returns the path to the command if it is not
  *                an absolute or relative path. Then fork() is called and execve is called rirght after witht the appropriate commandList
- *                for either a normal command or one involving redirection. The parent handles a couple of things. FIrst if a command takes
- *                longer than the time interval specified in the command line argument, the process is aborted and the child is killed. If
- *                the command finishes in time, no problem. There is also good use of waitpid here as well as a callback such that zombies
- *                are avoided.
+ *                for either a normal command or one involving redirection. Every child is put in its own process group and added to
+ *                the job table. A background job is left running and reported when reapJobs collects it, a foreground job gets the
+ *                terminal and is waited on by waitForJob, which also interrupts it if it runs longer than JOB_TIMEOUT seconds.
+ * 
+ * Args: Two lists of strings
+ * Return: Nothing
+ */
+void runExecutable(char **commandList, char **argv)
+{
+    if (commandList[0] == NULL)
+        return;
+    if (strcmp(commandList[0], "memo") == 0 || isMemoCommand(commandList[0]))
+        runMemoized(commandList, argv);
+    else
+        runCommand(commandList, argv);
+}
+
+/**
+ * announceCommand, prints the "Executing" line for a command about to run, externalPath is NULL for a built-in.
+ *                  Nothing is printed while announceCommands is off.
+ * 
+ * Args: A string, A string
+ * Return: Nothing
+ */
+static void announceCommand(const char *command, const char *externalPath)
+{
+    if (!announceCommands)
+        return;
+    if (outputJson && externalPath == NULL)
+        outRecord("exec", "command:s builtin:b", command, 1);
+    else if (outputJson)
+        outRecord("exec", "command:s builtin:b path:s", command, 0, externalPath);
+    else if (externalPath == NULL)
+        printf("Executing built-in: %s\n", command);
+    else
+        printf("Executing: %s\n", externalPath);
+}
+
+/**
+ * runCommand, runs one command. Built-ins run in the shell, anything else is forked and exec'd, see runExecutable.
+ *             Sets lastExitStatus.
  * 
- * Args: Three lists of strings, a struct
+ * Args: Two lists of strings
  * Return: Nothing
  */
-void runExecutable(char **commandList, char **envp, struct pathelement *pathList, char **argv)
+void runCommand(char **commandList, char **argv)
 {
     if (isBuiltIn(commandList[0]))
     {
         // Built-in command check
-        printf("Executing built-in: %s\n", commandList[0]);
-        runBuiltIn(commandList, pathList, envp);
+        uint64_t builtInStart = traceStart();
+        announceCommand(commandList[0], NULL);
+        lastExitStatus = 0; // A built-in that fails sets it
+        runRedirectedBuiltIn(commandList);
+        traceEnd("builtin", builtInStart, commandList[0]);
         return;
     }
-    int result, abortProcess = 0, status = 0, redirectionType = getRedirectionType(commandList);
+    int abortProcess = 0, redirectionType = getRedirectionType(commandList);
     int shouldRunInBg = shouldRunAsBackground(commandList);
-    char *externalPath = getExternalPath(commandList, pathList);
+    char *externalPath = getExternalPath(commandList);
+    pid_t pid;
+    struct job *job;
+    uint64_t forkStart, childStart;
+    char *cgroup;
+    int spool = -1;
     if (shouldRunInBg)
-        commandList[shouldRunInBg] = '\0';
+    {
+        free(commandList[shouldRunInBg]);
+        commandList[shouldRunInBg] = NULL;
+    }
+    lastExitStatus = externalPath ? 0 : 127;
     if (externalPath != NULL)
     {
-        printf("Executing: %s\n", externalPath);
+        // Built before forking so the child execs straight from the cached array
+        char **envp = exportEnvironment();
+        announceCommand(commandList[0], externalPath);
+        outFlush();
+        cgroup = createJobCgroup();
+        if (shouldRunInBg)
+            spool = createJobSpool();
         // Child
+        forkStart = traceStart();
         if ((pid = fork()) < 0)
         { 
             // fork(), execve() and waitpid()
             perror("fork error");
+            removeJobCgroup(cgroup);
+            free(cgroup);
+            if (spool >= 0)
+                releaseJobSpool(spool, 1);
         }
         else if (pid == 0)
         {
+            childStart = traceStart();
+            prepareJobChild(!shouldRunInBg);
+            joinJobCgroup(cgroup);
+            if (spool >= 0)
+            {
+                // Redirections below still win over the spool
+                dup2(spool, STDOUT_FILENO);
+                dup2(spool, STDERR_FILENO);
+            }
             if (redirectionType)
             {
                 abortProcess = handleRedirection(redirectionType, getRedirectionDest(commandList));
                 removeAfterRedirect(commandList);
             }
-            if (abortProcess)
-                kill(pid, SIGTERM);
+            // Limits go on last so a small descriptors limit can't stop the redirection
+            if (abortProcess || applyJobLimits() != 0)
+                _exit(1);
+            traceEnd("child setup", childStart, externalPath);
+            traceInstant("exec", externalPath);
             execve(externalPath, commandList, envp);
             perror("execve problem: ");
-        }
-        // Parent
-        if (shouldRunInBg)
-        {
-            // background process stuff
-            printShell();
-            if ((result = waitpid(pid, &status, WNOHANG)) == -1 && errno != ECHILD)
-                perror("waitpid error");
+            _exit(127);
         }
         else
         {
-            free(externalPath);
-            signal(SIGALRM, alarmHandler);
-            signal(SIGCHLD, childHandler);
-            alarm(30);
-            pause();
-            if (timeout)
+            // Parent, set the group here too so it exists whichever process runs first
+            traceEnd("fork", forkStart, externalPath);
+            setpgid(pid, pid);
+            if ((job = addJob(pid, commandList)) == NULL)
             {
-                if ((result = waitpid(pid, &status, WNOHANG)) == -1 && errno != ECHILD)
-                {
-                    perror("waitpid error");
-                }
-                else if (result == 0)
-                {
-                    printf("!!! taking too long to execute this command !!!\n");
-                    kill(pid, SIGINT);
-                }
+                perror("job");
+                free(cgroup);
+                free(externalPath);
+                if (spool >= 0)
+                    releaseJobSpool(spool, 1);
+                return;
             }
+            job->cgroup = cgroup;
+            job->spool = spool;
+            if (shouldRunInBg && outputJson)
+                outRecord("job", "id:d pid:d state:s command:s", job->id, pid, "running", job->command);
+            else if (shouldRunInBg)
+                outPrintf("[%d] %d\n", job->id, pid);
+            else
+                lastExitStatus = waitForJob(job, 0);
         }
-        if (WEXITSTATUS(status) != 0)
-            printf("exit code of child: %d\n", WEXITSTATUS(status));
+        free(externalPath);
     }
 }
 
 /**
- * childHandler, callback function for signal SIGCHLD, the reason waitpid uses WNOHANG is so that 
- *               waitpid cannot block. The reason waitpid is in a loop is because if there are multiple
- *               zombies, they all get reaped.
+ * runMemoized, runs a command through the memo cache, either as "memo command args" or because the command is
+ *              listed in $SSSH_MEMO. On a hit the cached output and exit status are replayed without running anything.
+ *              On a miss the command runs with stdout pointed at a memfd, and what it wrote is replayed and cached.
+ *              Commands with redirection or & are just run, so are built-ins other than the read-only ones subst.c
+ *              runs in process, and stderr is never cached. "memo" alone lists the cache and "memo -c" clears it.
  * 
- * Args: An integer
+ * Args: Two lists of strings
  * Return: Nothing
  */
-void childHandler(int signal)
+void runMemoized(char **commandList, char **argv)
 {
-    isChildDone = 1;
-    while (waitpid((pid_t)(-1), 0, WNOHANG) > 0);
+    char **command = strcmp(commandList[0], "memo") == 0 ? commandList + 1 : commandList;
+    struct memoentry *entry;
+    int capture, savedStdout, jobsBefore = 0, jobsAfter = 0, wasAnnouncing = announceCommands;
+    size_t keyLength;
+    char *key, *externalPath = NULL;
+    if (command[0] == NULL || strcmp(command[0], "-c") == 0)
+    {
+        if (command[0] == NULL)
+            printMemoStats();
+        else
+            clearMemo();
+        lastExitStatus = 0;
+        return;
+    }
+    // A hit skips running the command, so a built-in that changes the shell (cd, setenv, ...) is never cached
+    if (getRedirectionType(command) || shouldRunAsBackground(command) || getPipeType(command) ||
+        (isBuiltIn(command[0]) && !isReadOnlyBuiltIn(command[0])))
+    {
+        runCommand(command, argv);
+        return;
+    }
+    // The key is taken before running, the command may change the cwd or the environment
+    if ((key = memoKey(command, &keyLength)) != NULL && (entry = memoLookup(key, keyLength)) != NULL)
+    {
+        free(key);
+        outWrite(entry->output, entry->outputLength);
+        lastExitStatus = entry->status;
+        return;
+    }
+    if (key == NULL)
+    {
+        runCommand(command, argv);
+        return;
+    }
+    if (!isBuiltIn(command[0]) && (externalPath = getExternalPath(command)) == NULL)
+    {
+        // getExternalPath already said why, as runCommand would have
+        free(key);
+        lastExitStatus = 127;
+        return;
+    }
+    // Announced here, runCommand's own line would be captured and replayed on every hit
+    announceCommand(command[0], externalPath);
+    free(externalPath);
+    fflush(stdout);
+    outFlush();
+    if ((capture = memfd_create("sssh-memo", MFD_CLOEXEC)) < 0)
+    {
+        free(key);
+        announceCommands = 0;
+        runCommand(command, argv);
+        announceCommands = wasAnnouncing;
+        return;
+    }
+    for (struct job *job = jobHead; job != NULL; job = job->next)
+        jobsBefore++;
+    outHold(); // Or a watcher's notice would be cached along with the output
+    savedStdout = dup(STDOUT_FILENO);
+    dup2(capture, STDOUT_FILENO);
+    announceCommands = 0;
+    runCommand(command, argv);
+    announceCommands = wasAnnouncing;
+    outFlush();
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    outRelease();
+    for (struct job *job = jobHead; job != NULL; job = job->next)
+        jobsAfter++;
+
+    off_t length = lseek(capture, 0, SEEK_END), offset = 0;
+    char *output = length <= MEMO_ENTRY_MAX ? malloc(length + 1) : NULL;
+    if (output != NULL && pread(capture, output, length, 0) == length)
+    {
+        outWrite(output, length);
+        // A command that got stopped hasn't finished writing, don't remember half of it
+        if (jobsAfter == jobsBefore)
+            memoStore(command, key, keyLength, lastExitStatus, output, length);
+        else
+        {
+            free(key);
+            free(output);
+        }
+    }
+    else
+    {
+        free(key);
+        free(output);
+        while (offset < length && sendfile(STDOUT_FILENO, capture, &offset, length - offset) > 0);
+    }
+    close(capture);
 }
 
 /**
- * alarmHandler, updates the global variable timeout when called by signal(2)
- *               in the runExecutable function.
+ * runRedirectedBuiltIn, runs a built-in in the shell itself with any redirection applied the same way the
+ *                       child of an external command would get it. The shell's own stdin, stdout and stderr
+ *                       are saved first and put back once the builtin's buffered output has been flushed.
  * 
- * Args: An integer
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void runRedirectedBuiltIn(char **commandList)
+{
+    int redirectionType = getRedirectionType(commandList), savedFds[3];
+    if (redirectionType)
+    {
+        outHold(); // Keeps the watcher threads' notices out of the file until fd 1 is back
+        fflush(stdout);
+        fflush(stderr);
+        for (int i = 0; i < 3; i++)
+            savedFds[i] = dup(i);
+        if (handleRedirection(redirectionType, getRedirectionDest(commandList)))
+        {
+            lastExitStatus = 1;
+            restoreStandardFds(savedFds);
+            outRelease();
+            return;
+        }
+        removeAfterRedirect(commandList);
+    }
+    runBuiltIn(commandList);
+    outFlush();
+    if (redirectionType)
+    {
+        fflush(stderr);
+        restoreStandardFds(savedFds);
+        outRelease();
+    }
+}
+
+/**
+ * restoreStandardFds, puts back stdin, stdout and stderr saved with dup(2) and closes the copies.
+ * 
+ * Args: An array of integers
  * Return: Nothing
  */
-void alarmHandler(int signal)
+void restoreStandardFds(int savedFds[3])
 {
-    timeout = 1;
+    for (int i = 0; i < 3; i++)
+    {
+        if (savedFds[i] < 0)
+            continue;
+        dup2(savedFds[i], i);
+        close(savedFds[i]);
+    }
 }
 
 /**
@@ -267,30 +894,29 @@ void alarmHandler(int signal)
  *                  a / ./ or ../ or something of the like, or returns the path to an 
  *                  executable found by the which function.
  * 
- * Args: A list of strings, a struct
+ * Args: A list of strings
  * Return: A string
  */
-char *getExternalPath(char **commandList, struct pathelement *pathList)
+char *getExternalPath(char **commandList)
 {
     char *externalPath;
-    char temp[BUFFERSIZE];
-    struct stat file;
+    struct statx file;
+    uint64_t resolveStart = traceStart();
 
     if (strstr(commandList[0], "./") || strstr(commandList[0], "../") || strstr(commandList[0], "/"))
     {
-        if (stat(commandList[0], &file) == 0)
+        if (cachedStat(AT_FDCWD, commandList[0], commandList[0], &file) == 0)
         {
-            if (S_ISDIR(file.st_mode))
+            if (S_ISDIR(file.stx_mode))
             {
                 errno = EISDIR;
                 printf("shell: %s: %s\n", commandList[0], strerror(errno));
                 return NULL;
             }
-            if (file.st_mode & S_IXUSR && file.st_mode & S_IXGRP && file.st_mode & S_IXOTH)
+            // Whether we may run it, not whether everyone may
+            if (cachedAccess(AT_FDCWD, commandList[0], commandList[0], X_OK) == 0)
             {
-                strcpy(temp, commandList[0]);
-                externalPath = (char *)malloc(sizeof(temp));
-                strcpy(externalPath, temp);
+                externalPath = strdup(commandList[0]);
             }
             else
             {
@@ -307,59 +933,16 @@ char *getExternalPath(char **commandList, struct pathelement *pathList)
     }
     else
     {
-        externalPath = which(commandList[0], pathList);
+        externalPath = which(commandList[0]);
     }
+    traceEnd("resolve", resolveStart, commandList[0]);
     return externalPath;
 }
 
-/**
- * watchMailCallback, this function is a callback which is called when pthread_create is used when using the watchmail
- *                    built-in command. When a file specified by the user in the mailList linked list increases in size,
- *                    a beep noise is played and a message is printed out to notify the user that there is new mail in 
- *                    file that got larger. This is accomplished through an infinite loop that sleeps for 1 second each
- *                    iteration and uses stat(2) to check for file size increases among the files in the mailList data
- *                    structure (linked list).
- * 
- * Args: Args that are given by pthread_create
- * Return: Nothing
- */
-void *watchMailCallback(void *callbackArgs)
-{
-    char *fileName = (char *)callbackArgs;
-    struct stat st;
-    if (stat(fileName, &st) != 0)
-    {
-        perror("stat problem");
-        pthread_exit(NULL);
-    }
-    long prevFileSize = (long)st.st_size;
-    struct timeval tv;
-    time_t currentTime;
-    while (1)
-    {
-        if (gettimeofday(&tv, NULL) != 0)
-        {
-            perror("Get current time problem");
-            pthread_exit(NULL);
-        }
-        currentTime = tv.tv_sec;
-        if (stat(fileName, &st) != 0)
-        {
-            perror("stat problem");
-            pthread_exit(NULL);
-        }
-        if ((long)st.st_size > prevFileSize)
-        {
-            printf("\a\nYou've Got Mail in %s at %s", fileName, ctime(&currentTime));
-            prevFileSize = (long)st.st_size;
-        }
-        sleep(1);
-    }
-}
-
 /**
  * watchUserCallback, loops infinitely on a sleep timer of 20 seconds. Finds the user on the machine and tracks their logins.
- *                  The data shared the global users linked list is protected by a mutex_lock and unlock.
+ *                  Each login record is looked up in the watched users by name with findUser. The shared userList is
+ *                  protected by a mutex_lock and unlock.
  * 
  * Args: Anything, whatever the watchUser built-in supplies
  * Return: Nothing
@@ -367,32 +950,43 @@ void *watchMailCallback(void *callbackArgs)
 void *watchUserCallback(void *callbackArgs)
 {
     struct utmpx *up;
+    struct user *someUser;
+    char name[sizeof(up->ut_user) + 1];
+    blockSignalsInThread();
     while (1)
     {
+        // Only cancelled while asleep, never holding the lock or halfway through printing
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        // fd 1 belongs to a builtin's redirection right now, look again next time
+        if (!outTryHold())
+        {
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            sleep(5);
+            continue;
+        }
         setutxent();
         while ((up = getutxent()))
         {
             if (up->ut_type == USER_PROCESS)
             {
+                // ut_user isn't terminated when the name fills it
+                snprintf(name, sizeof(name), "%.*s", (int)sizeof(up->ut_user), up->ut_user);
                 pthread_mutex_lock(&mutexLock);
-                struct user *someUser = userHead;
-                while (someUser)
+                if ((someUser = findUser(name)) != NULL)
                 {
-                    if (strcmp(someUser->username, up->ut_user) == 0)
-                    {
-                        someUser->isLoggedOn = 1;
-                        printf("\n%s has logged on %s from %s\n", up->ut_user, up->ut_line, up->ut_host);
-                    }
+                    someUser->isLoggedOn = 1;
+                    if (outputJson)
+                        outRecord("login", "user:s line:s host:s", name, up->ut_line, up->ut_host);
                     else
-                    {
-                        printf("\n%s, no such user\n", someUser->username);
-                    }
-                    someUser = someUser->next;
+                        printf("\n%s has logged on %s from %s\n", name, up->ut_line, up->ut_host);
                 }
                 pthread_mutex_unlock(&mutexLock);
             }
         }
         printUsers();
+        outFlush();
+        outRelease();
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
         sleep(5);
     }
     return NULL;
@@ -406,8 +1000,6 @@ void *watchUserCallback(void *callbackArgs)
  */
 int isBuiltIn(char *command)
 {
-    const char *builtInCommands[] = {"exit", "which", "where", "cd", "pwd", "list", "pid", "kill", "prompt",
-                                     "printenv", "setenv", "watchuser", "watchmail", "noclobber"};
     int inList = 0;
     for (int i = 0; i < BUILT_IN_COMMAND_COUNT; i++)
     {
@@ -422,13 +1014,13 @@ int isBuiltIn(char *command)
 
 /**
  * runBuiltIn, runs the built in commands, if a command like list is called with multiple arguments, its handler function is called, 
- *             calling the command for each argument given. This function also handles exiting the program and freeing/getting the 
- *             old and new linked lists for the PATH environment variable if need be.
+ *             calling the command for each argument given. This function also handles exiting the program and updating the 
+ *             PATH list if setenv changed the PATH environment variable.
  * 
- * Args: Two arrays of strings, a string, a struct
+ * Args: An array of strings
  * Return: Nothing
  */
-void runBuiltIn(char **commandList, struct pathelement *pathList, char **envp)
+void runBuiltIn(char **commandList)
 {
     int shouldExit = 0, pathChanged = 0;
     if (strcmp(commandList[0], "exit") == 0)
@@ -437,11 +1029,11 @@ void runBuiltIn(char **commandList, struct pathelement *pathList, char **envp)
     }
     else if (strcmp(commandList[0], "which") == 0)
     {
-        whichHandler(commandList, pathList);
+        whichHandler(commandList);
     }
     else if (strcmp(commandList[0], "where") == 0)
     {
-        whereHandler(commandList, pathList);
+        whereHandler(commandList);
     }
     else if (strcmp(commandList[0], "cd") == 0)
     {
@@ -451,6 +1043,22 @@ void runBuiltIn(char **commandList, struct pathelement *pathList, char **envp)
     {
         printWorkingDirectory();
     }
+    else if (strcmp(commandList[0], "pushd") == 0)
+    {
+        pushDirectory(commandList);
+    }
+    else if (strcmp(commandList[0], "popd") == 0)
+    {
+        popDirectory(commandList);
+    }
+    else if (strcmp(commandList[0], "dirs") == 0)
+    {
+        printDirectories(commandList);
+    }
+    else if (strcmp(commandList[0], "z") == 0)
+    {
+        jumpDirectory(commandList);
+    }
     else if (strcmp(commandList[0], "list") == 0)
     {
         listHandler(commandList);
@@ -459,6 +1067,22 @@ void runBuiltIn(char **commandList, struct pathelement *pathList, char **envp)
     {
         printPid();
     }
+    else if (strcmp(commandList[0], "procs") == 0)
+    {
+        listProcesses(commandList);
+    }
+    else if (strcmp(commandList[0], "joblog") == 0)
+    {
+        showJobLog(commandList);
+    }
+    else if (strcmp(commandList[0], "alias") == 0)
+    {
+        setAlias(commandList);
+    }
+    else if (strcmp(commandList[0], "unalias") == 0)
+    {
+        removeAlias(commandList);
+    }
     else if (strcmp(commandList[0], "kill") == 0)
     {
         killIt(commandList);
@@ -469,17 +1093,17 @@ void runBuiltIn(char **commandList, struct pathelement *pathList, char **envp)
     }
     else if (strcmp(commandList[0], "printenv") == 0)
     {
-        printEnvironment(commandList, envp);
+        printEnvironment(commandList);
     }
     else if (strcmp(commandList[0], "setenv") == 0)
     {
-        pathChanged = setEnvironment(commandList, envp, pathList);
+        pathChanged = setEnvironment(commandList);
     }
     else if (strcmp(commandList[0], "watchuser") == 0)
     {
         watchUser(commandList);
     }
-    else if (strcmp(commandList[0], "watchmail") == 0)
+    else if (strcmp(commandList[0], "watchmail") == 0 || strcmp(commandList[0], "watchfile") == 0)
     {
         watchMail(commandList);
     }
@@ -487,13 +1111,34 @@ void runBuiltIn(char **commandList, struct pathelement *pathList, char **envp)
     {
         noClobber();
     }
-    if (pathChanged)
+    else if (strcmp(commandList[0], "set") == 0)
+    {
+        setVariable(commandList);
+    }
+    else if (strcmp(commandList[0], "unset") == 0)
+    {
+        unsetVariable(commandList);
+    }
+    else if (strcmp(commandList[0], "jobs") == 0)
+    {
+        printJobs(commandList[1] != NULL && strcmp(commandList[1], "-l") == 0);
+    }
+    else if (strcmp(commandList[0], "fg") == 0 || strcmp(commandList[0], "bg") == 0)
+    {
+        resumeJob(commandList, commandList[0][0] == 'f');
+    }
+    else if (strcmp(commandList[0], "limit") == 0)
+    {
+        setLimit(commandList);
+    }
+    else if (strcmp(commandList[0], "unlimit") == 0)
     {
-        freePath(pathList);
-        pathList = getPath();
+        removeLimit(commandList);
     }
+    if (pathChanged && updatePath(getEnvVar("PATH")) > 0 && isatty(STDIN_FILENO))
+        warmCommandIndex();
     if (shouldExit)
-        freeAndExit(pathList, commandList);
+        freeAndExit(commandList);
 }
 
 /**
@@ -515,25 +1160,31 @@ int getRedirectionType(char **commandList)
 {
     int redirectionType = 0;
     for (int i = 0; commandList[i] != NULL; i++)
-    {
-        if (!strcmp(commandList[i], ">"))
-            redirectionType = 1;
-        if (!strcmp(commandList[i], ">>"))
-            redirectionType = 2;
-        if (!strcmp(commandList[i], "<"))
-            redirectionType = 3;
-        if (!strcmp(commandList[i], ">>&"))
-            redirectionType = 4;
-        if (!strcmp(commandList[i], ">&"))
-            redirectionType = 5;
-    }
+        if (isRedirection(commandList[i]))
+            redirectionType = isRedirection(commandList[i]);
     return redirectionType;
 }
 
+/**
+ * isRedirection, tells whether a word is one of the redirection symbols, returning its type as getRedirectionType
+ *                numbers them, or 0. Only whole words count, so "a>b" is an ordinary argument everywhere.
+ * 
+ * Args: A string
+ * Return: An integer
+ */
+int isRedirection(const char *word)
+{
+    const char *symbols[] = {">", ">>", "<", ">>&", ">&"};
+    for (int i = 0; i < 5; i++)
+        if (!strcmp(word, symbols[i]))
+            return i + 1;
+    return 0;
+}
+
 /**
  * removeAfterRedirect, this function removes all garbage in the command list including and after the redirection symbol because execve
  *                      only cares about what comes before the redirection symbol. All the extra stuff after will cause problems in 
- *                      exec if not removed.
+ *                      exec if not removed. The removed strings are freed since builtins run in the shell itself.
  * 
  * Args: An array of strings
  * Return: Nothing
@@ -541,14 +1192,11 @@ int getRedirectionType(char **commandList)
 void removeAfterRedirect(char **commandList)
 {
     int commandCount = 0;
-    while (1)
-    {
-        if (strstr(commandList[commandCount], "<") || strstr(commandList[commandCount], ">"))
-            break;
+    while (commandList[commandCount] != NULL && !isRedirection(commandList[commandCount]))
         commandCount++;
-    }
     while (commandList[commandCount] != NULL)
     {
+        free(commandList[commandCount]);
         commandList[commandCount] = NULL;
         commandCount++;
     }
@@ -564,15 +1212,9 @@ void removeAfterRedirect(char **commandList)
  */
 char *getRedirectionDest(char **commandList)
 {
-    char *redirectionDest;
     for (int i = 0; commandList[i] != NULL; i++)
-        if (strstr(commandList[i], "<") || strstr(commandList[i], ">"))
-            if (commandList[i + 1] != NULL)
-            {
-                redirectionDest = (char *)malloc(strlen(commandList[i + 1]) + 1);
-                strcpy(redirectionDest, commandList[i + 1]);
-                return redirectionDest;
-            }
+        if (isRedirection(commandList[i]))
+            return commandList[i + 1] != NULL ? strdup(commandList[i + 1]) : NULL;
     return NULL;
 }
 
@@ -586,11 +1228,17 @@ char *getRedirectionDest(char **commandList)
  */
 int handleRedirection(int redirectionType, char *destFile)
 {
-    int fileDescriptor;
+    int fileDescriptor = 0;
     int abort = 0;
     int wrx = 0666;
-    struct stat buffer;
-    int fileExists = (stat(destFile, &buffer) == 0) ? 1 : 0;
+    struct statx buffer;
+    if (destFile == NULL)
+    {
+        fprintf(stderr, "Missing name for redirect.\n");
+        return 1;
+    }
+    uint64_t redirectStart = traceStart();
+    int fileExists = (cachedStat(AT_FDCWD, destFile, destFile, &buffer) == 0) ? 1 : 0;
     if (redirectionType == 0)
     {
         abort = 0;
@@ -674,6 +1322,14 @@ int handleRedirection(int redirectionType, char *destFile)
             close(fileDescriptor);
         }
     }
+    if (!abort && fileDescriptor < 0)
+    {
+        perror(destFile);
+        abort = 1;
+    }
+    if (redirectionType != 3)
+        forgetStat(destFile); // Made or truncated just now
+    traceEnd("redirect", redirectStart, destFile);
     free(destFile);
     return abort;
 }
@@ -713,7 +1369,7 @@ int getPipeType(char **commandList)
 int getPipeIndex(char **commandList)
 {
     for (int i = 0; commandList[i] != NULL; i++)
-        if (strstr(commandList[i], "|"))
+        if (!strcmp(commandList[i], "|") || !strcmp(commandList[i], "|&"))
             return i;
     return -1;
 }
@@ -721,15 +1377,20 @@ int getPipeIndex(char **commandList)
 /**
  * splitPipe, This function splits the command list before or after where the pipe lies. If the beforeOrAfter parameter
  *            is non-zero, this function returns the commandList before the pipe, if it is zero, this function returns
- *            the commandList after the pipe.
+ *            the commandList after the pipe. Either can come back empty when the pipe starts or ends the line, and NULL is
+ *            returned if memory runs out.
  * 
  * Args: An array of strings, an integer
  * Return: An array of strings
  */
 char **splitPipe(char **commandList, int beforeOrAfter)
 {
-    char **pipeList = calloc(MAX_CMD, sizeof(char *));
-    int pipeIndex = getPipeIndex(commandList);
+    int pipeIndex = getPipeIndex(commandList), count = 0;
+    while (commandList[count] != NULL)
+        count++;
+    char **pipeList = calloc(count + 1, sizeof(char *));
+    if (pipeList == NULL)
+        return NULL;
     if (beforeOrAfter)
     {
         for (int i = 0; i < pipeIndex; i++)
@@ -755,56 +1416,62 @@ char **splitPipe(char **commandList, int beforeOrAfter)
  * handlePipes, handles the logic for piping. If the pipeType function returns 0, that means there is no pipe and this function
  *              does nothing. If the pipe exists, then pipe(2) is called to set a file descriptor array and the file descriptors
  *              for stdin, stdout, and stderr are opened/closed appropriately. There are two calls the the runExecutable function
- *              here, the first call executes the command given before the pipe, stdout and stderr are returned to the terminal 
- *              and then the second call to runExecutable is made. This time, runExecutable runs the command that comes after the
- *              pipe.  
+ *              here, the first call executes the command given before the pipe, stdout and stderr are put back the way they
+ *              were before the pipe and then the second call to runExecutable is made. This time, runExecutable runs the command
+ *              that comes after the pipe. The shell's own descriptors are saved with dup(2) rather than reopening /dev/tty, so
+ *              pipes also work when the shell's input or output is not a terminal.
  * 
- * Args: Three arrays of strings, A struct
+ * Args: Two arrays of strings
  * Return: An integer
  */
-int handlePipes(char **commandList, char **envp, struct pathelement *pathList, char **argv)
+int handlePipes(char **commandList, char **argv)
 {
-    int fileDescriptor, before = 1, after = 0, wasPiped = 0, pipeType = getPipeType(commandList), pipeFileDescriptor[2];
+    int before = 1, after = 0, wasPiped = 0, pipeType = getPipeType(commandList), pipeFileDescriptor[2], savedFds[3];
     char **beforePipe = splitPipe(commandList, before), **afterPipe = splitPipe(commandList, after);
-    if (pipeType)
+    if (beforePipe == NULL || afterPipe == NULL)
+    {
+        perror("pipe");
+        freePipeArrays(beforePipe, afterPipe);
+        return 1;
+    }
+    if (pipeType && (beforePipe[0] == NULL || afterPipe[0] == NULL))
+    {
+        fprintf(stderr, "Invalid null command.\n");
+        lastExitStatus = 1;
+        wasPiped = 1;
+    }
+    else if (pipeType)
     {
         if (pipe(pipeFileDescriptor) != 0)
         {
             perror("pipe");
+            freePipeArrays(beforePipe, afterPipe);
+            return 1;
         }
+        fflush(stdout);
+        for (int i = 0; i < 3; i++)
+            savedFds[i] = dup(i);
 
-        close(0); // Close stdin
-        dup(pipeFileDescriptor[0]);
+        dup2(pipeFileDescriptor[0], 0); // stdin comes from the pipe
         close(pipeFileDescriptor[0]);
 
         if (pipeType == 2)
-        {
-            close(2);
-            dup(pipeFileDescriptor[1]);
-        }
+            dup2(pipeFileDescriptor[1], 2);
 
-        close(1); // Close stdout
-        dup(pipeFileDescriptor[1]);
+        dup2(pipeFileDescriptor[1], 1); // stdout goes into the pipe
         close(pipeFileDescriptor[1]);
 
-        runExecutable(beforePipe, envp, pathList, argv); 
+        runExecutable(beforePipe, argv); 
 
-        fileDescriptor = open("/dev/tty", O_WRONLY);
-        close(1);
-        dup(fileDescriptor);
-        close(fileDescriptor);
+        // Put stdout and stderr back so the only write end left belongs to the first command
+        outFlush();
+        dup2(savedFds[1], 1);
+        dup2(savedFds[2], 2);
 
-        fileDescriptor = open("/dev/tty", O_WRONLY);
-        close(2);
-        dup(fileDescriptor);
-        close(fileDescriptor);
+        runExecutable(afterPipe, argv);
 
-        runExecutable(afterPipe, envp, pathList, argv);
-
-        fileDescriptor = open("/dev/tty", O_RDONLY);
-        close(0);
-        dup(fileDescriptor);
-        close(fileDescriptor);
+        outFlush();
+        restoreStandardFds(savedFds);
 
         wasPiped = 1;
     }
@@ -820,12 +1487,12 @@ int handlePipes(char **commandList, char **envp, struct pathelement *pathList, c
  */
 void freePipeArrays(char **beforePipe, char **afterPipe)
 {
-    for (int i = 0; afterPipe[i] != NULL; i++)
+    for (int i = 0; afterPipe != NULL && afterPipe[i] != NULL; i++)
     {
         free(afterPipe[i]);
     }
     free(afterPipe);
-    for (int i = 0; beforePipe[i] != NULL; i++)
+    for (int i = 0; beforePipe != NULL && beforePipe[i] != NULL; i++)
     {
         free(beforePipe[i]);
     }
@@ -845,67 +1512,67 @@ void noClobber()
     if (hasNoClobber == 0)
     {
         hasNoClobber = 1;
-        printf("noclobber is now on\n");
+        if (outputJson)
+            outRecord("noclobber", "value:b", 1);
+        else
+            outPrintf("noclobber is now on\n");
     }
     else
     {
         hasNoClobber = 0;
-        printf("noclobber is now off\n");
+        if (outputJson)
+            outRecord("noclobber", "value:b", 0);
+        else
+            outPrintf("noclobber is now off\n");
     }
 }
 
 /**
- * watchMail, if no arguments are given, an error message is printed. With one argument given, this function spawns 
- *            a thread that calls the watchMailCallback function which watches the given file in an infinite loop for
- *            updates to the file, read more about that function in the description for it. If two arguments are given,
- *            if the second argument is the word "off", then the thread is killed and all of its memory is collected.
+ * watchMail, handles watchmail and watchfile. With a file given, the file is followed from its current end by the
+ *            watcher thread in watch.c: only new bytes are read, and truncation, rewrites and rotation are noticed.
+ *            watchmail prints a "You've Got Mail" notice, watchfile prints the new lines like tail -f. "-n N" limits
+ *            how many new lines are printed (watchmail prints none by default) and "-m PATTERN" only reports lines
+ *            matching the regex. If the second argument is the word "off", the file is no longer followed.
+ *            watchfile alone lists the followed files, watchmail alone is an error.
  * 
  * Args: An array of strings
  * Return: Nothing
  */
 void watchMail(char **commandList)
 {
-    char *fileName = strdup(commandList[1]);
+    int notify = strcmp(commandList[0], "watchmail") == 0, lines = notify ? 0 : -1;
+    char *pattern = NULL;
     if (commandList[1] == NULL)
     {
-        errno = ENOENT;
-        perror("watchmail");
-    }
-    else if (commandList[2] != NULL)
-    {
-        if (strcmp("off", commandList[2]) == 0)
-        {
-            struct mail *toRemove = findMail(commandList[1]);
-            free(fileName);
-            if (toRemove == NULL)
-            {
-                printf("Cannot unwatch %s, not in mail list.\n", commandList[1]);
-                return;
-            }
-            pthread_cancel(toRemove->thread);
-            pthread_join(toRemove->thread, NULL);
-            removeMail(toRemove->pathToFile);
-        }
-        else
+        if (notify)
         {
-            errno = EINVAL;
+            errno = ENOENT;
             perror("watchmail");
         }
+        else
+            printMail();
+        return;
     }
-    else
+    if (commandList[2] != NULL && strcmp("off", commandList[2]) == 0 && commandList[3] == NULL)
+    {
+        if (unwatchFile(commandList[1]) != 0)
+            printf("Cannot unwatch %s, not in mail list.\n", commandList[1]);
+        return;
+    }
+    for (int i = 2; commandList[i] != NULL; i++)
     {
-        struct stat buffer;
-        pthread_t mailID;
-        int fileExists;
-        if ((fileExists = stat(commandList[1], &buffer)) != 0)
+        if (strcmp(commandList[i], "-n") == 0 && commandList[i + 1] != NULL)
+            lines = atoi(commandList[++i]);
+        else if (strcmp(commandList[i], "-m") == 0 && commandList[i + 1] != NULL)
+            pattern = commandList[++i];
+        else
         {
-            errno = ENOENT;
-            perror("stat");
+            errno = EINVAL;
+            perror(commandList[0]);
             return;
         }
-        pthread_create(&mailID, NULL, watchMailCallback, (void *)fileName);
-        addMail(fileName, mailID);
     }
+    watchFile(commandList[1], lines, pattern, notify);
 }
 
 /**
@@ -936,7 +1603,7 @@ void watchUser(char **commandList)
                 return;
             }
             pthread_mutex_lock(&mutexLock);
-            removeUser(toRemove->username);
+            removeUser(commandList[1]);
             pthread_mutex_unlock(&mutexLock);
         }
         else
@@ -962,59 +1629,207 @@ void watchUser(char **commandList)
 }
 
 /**
- * killIt, when given just a pid, sends SIGTERM to it to politely kill that process.
- *         if given a signal number (ie. kill -9 1234), sends that signal to the 
- *         process.
+ * resumeJob, the fg and bg built-ins. Continues the job given as %n (or the most recent job when none is
+ *            given), either waiting for it in the foreground with the terminal or letting it run in the background.
+ * 
+ * Args: An array of strings, An integer
+ * Return: Nothing
+ */
+void resumeJob(char **commandList, int foreground)
+{
+    struct job *job = commandList[1] ? parseJobSpec(commandList[1]) : parseJobSpec("%%");
+    if (job == NULL)
+    {
+        fprintf(stderr, " %s: No such job.\n", commandList[0]);
+        lastExitStatus = 1;
+        return;
+    }
+    if (foreground)
+    {
+        if (outputJson)
+            outRecord("job", "id:d pid:d state:s command:s", job->id, job->pid, "foreground", job->command);
+        else
+            outPrintf("%s\n", job->command);
+        outFlush();
+        lastExitStatus = waitForJob(job, 1);
+    }
+    else
+    {
+        job->state = JOB_RUNNING;
+        kill(-job->pgid, SIGCONT);
+        if (outputJson)
+            outRecord("job", "id:d pid:d state:s command:s", job->id, job->pid, "running", job->command);
+        else
+            outPrintf("[%d] %s &\n", job->id, job->command);
+    }
+}
+
+/**
+ * killIt, sends a signal, SIGTERM unless one is given as -SIG, -s SIG or -n SIG (a name with or without SIG, or a
+ *         number), to every target at once. A target is a pid (negative for a process group), a job spec like %1,
+ *         which signals the whole job, or a pattern, an extended regex that has to match a process's whole name.
+ *         All the patterns are matched in a single pass over /proc. Processes are signalled through pidfds, see
+ *         sendSignal. kill -l lists the signal names, kill -l n names signal n (or exit status 128+n).
  * 
  * Args: A list of strings
  * Return: Nothing
  */
 void killIt(char **commandList)
 {
-    int pid;
+    int signal = SIGTERM, first = 1, failed = 0, patternCount = 0, count, *matched;
+    char *end, *anchored;
+    long pid;
+    struct job *job;
+    struct procinfo *processes;
+    regex_t *patterns;
     if (commandList[1] == NULL)
     {
         fprintf(stderr, "%s", " kill: Specify at least one argument\n");
+        lastExitStatus = 1;
+        return;
     }
-    else if (commandList[2] != NULL)
+    if (strcmp(commandList[1], "-l") == 0)
     {
-        int signal;
-        commandList[1][0] = ' ';
-        if ((signal = atoi(commandList[1])) == 0)
+        if (commandList[2] == NULL)
+            listSignals();
+        for (int i = 2; commandList[i] != NULL; i++)
         {
-            errno = EINVAL;
-            perror(" kill, bad signal");
+            pid = strtol(commandList[i], &end, 10);
+            if (*end == '\0' && signalName(pid > 128 ? pid - 128 : pid) != NULL && outputJson)
+                outRecord("signal", "name:s number:d", signalName(pid > 128 ? pid - 128 : pid), pid > 128 ? pid - 128 : pid);
+            else if (*end == '\0' && signalName(pid > 128 ? pid - 128 : pid) != NULL)
+                outPrintf("%s\n", signalName(pid > 128 ? pid - 128 : pid));
+            else if (signalNumber(commandList[i]) > 0 && outputJson)
+                outRecord("signal", "name:s number:d", signalName(signalNumber(commandList[i])), signalNumber(commandList[i]));
+            else if (signalNumber(commandList[i]) > 0)
+                outPrintf("%d\n", signalNumber(commandList[i]));
+            else
+            {
+                fprintf(stderr, " kill: %s: Unknown signal\n", commandList[i]);
+                lastExitStatus = 1;
+            }
+        }
+        return;
+    }
+    if (strcmp(commandList[1], "-s") == 0 || strcmp(commandList[1], "-n") == 0)
+    {
+        signal = signalNumber(commandList[2]);
+        first = commandList[2] != NULL ? 3 : 2;
+    }
+    else if (commandList[1][0] == '-')
+    {
+        signal = signalNumber(commandList[1] + 1);
+        first = 2;
+    }
+    if (signal < 0 || commandList[first] == NULL)
+    {
+        fprintf(stderr, signal < 0 ? " kill: Unknown signal, kill -l lists them\n" : " kill: Specify at least one process\n");
+        lastExitStatus = 1;
+        return;
+    }
+    for (count = first; commandList[count] != NULL; count++);
+    if ((patterns = calloc(count - first, sizeof(regex_t))) == NULL || (matched = calloc(count - first, sizeof(int))) == NULL)
+    {
+        free(patterns);
+        perror(" kill");
+        lastExitStatus = 1;
+        return;
+    }
+    for (int i = first; commandList[i] != NULL; i++)
+    {
+        pid = strtol(commandList[i], &end, 10);
+        if (commandList[i][0] == '%')
+        {
+            if ((job = parseJobSpec(commandList[i])) == NULL)
+            {
+                fprintf(stderr, " kill: %s: No such job.\n", commandList[i]);
+                failed = 1;
+                continue;
+            }
+            killpg(job->pgid, signal);
+            // A stopped job wouldn't see a terminating signal until it was continued
+            if (job->state == JOB_STOPPED && (signal == SIGTERM || signal == SIGHUP))
+                killpg(job->pgid, SIGCONT);
         }
-        else if ((pid = atoi(commandList[2])) == 0)
+        else if (end != commandList[i] && *end == '\0')
         {
-            errno = EINVAL;
-            perror(" kill, no pid");
+            if (sendSignal(pid, signal, NULL) != 0)
+            {
+                fprintf(stderr, " kill: (%ld) - %s\n", pid, strerror(errno));
+                failed = 1;
+            }
+        }
+        else if ((anchored = malloc(strlen(commandList[i]) + 5)) == NULL)
+        {
+            perror("kill");
+            failed = 1;
         }
         else
         {
-            if ((kill(pid, signal)) != 0)
+            // Sized for the pattern, "^(" and ")$" around it
+            sprintf(anchored, "^(%s)$", commandList[i]);
+            if (regcomp(&patterns[patternCount], anchored, REG_EXTENDED | REG_NOSUB) != 0)
             {
-                errno = ESRCH;
-                perror(" kill");
+                fprintf(stderr, " kill: %s: Bad pattern\n", commandList[i]);
+                failed = 1;
             }
+            else
+                matched[patternCount++] = i;
+            free(anchored);
         }
     }
-    else
+    if (patternCount > 0 && (count = scanProcesses(&processes)) < 0)
+    {
+        perror("/proc");
+        failed = 1;
+    }
+    for (int i = 0; patternCount > 0 && i < count; i++)
     {
-        if ((pid = atoi(commandList[1])) == 0)
+        if (processes[i].pid == getpid())
+            continue;
+        for (int j = 0; j < patternCount; j++)
         {
-            errno = EINVAL;
-            perror(" kill");
+            if (regexec(&patterns[j], processes[i].name, 0, NULL, 0) != 0)
+                continue;
+            if (sendSignal(processes[i].pid, signal, &patterns[j]) == 0)
+                matched[j] = -1;
+            else if (errno != ESRCH)
+                fprintf(stderr, " kill: (%d) %s - %s\n", processes[i].pid, processes[i].name, strerror(errno));
+            break;
         }
-        else
+    }
+    for (int j = 0; j < patternCount; j++)
+    {
+        if (matched[j] >= 0)
         {
-            if (kill(pid, SIGTERM) != 0)
-            {
-                errno = ESRCH;
-                perror(" kill");
-            }
+            fprintf(stderr, " kill: %s: No matching processes\n", commandList[matched[j]]);
+            failed = 1;
         }
+        regfree(&patterns[j]);
     }
+    free(patterns);
+    free(matched);
+    lastExitStatus = failed;
+}
+
+/**
+ * printEnvironmentEntry, prints one NAME=VALUE entry of the environment, as a record of its
+ *                        name and value with --json.
+ *
+ * Args: A string
+ * Return: Nothing
+ */
+static void printEnvironmentEntry(const char *entry)
+{
+    const char *equals = strchr(entry, '=');
+    if (outputJson && equals != NULL)
+    {
+        char *name = strndup(entry, equals - entry);
+        outRecord("env", "name:s value:s", name, equals + 1);
+        free(name);
+    }
+    else
+        outPrintf("%s\n", entry);
 }
 
 /**
@@ -1026,77 +1841,147 @@ void killIt(char **commandList)
  *                 handle two special cases: One if the HOME variable is changed,
  *                 Two if the PATH variable is changed.
  * 
- * Args: Two lists of strings
+ * Args: An array of strings
  * Return: An integer
  */
-int setEnvironment(char **commandList, char **envp, struct pathelement *pathList)
+int setEnvironment(char **commandList)
 {
     int pathChanged = 0;
-    if (commandList[3] != NULL)
+    char **envp;
+    if (commandList[1] != NULL && commandList[2] != NULL && commandList[3] != NULL)
     {
         fprintf(stderr, "%s", " setenv: Too many arguments.\n");
     }
     else if (commandList[1] == NULL)
     {
+        envp = exportEnvironment();
         for (int i = 0; envp[i] != NULL; i++)
         {
-            printf(" \n%s", envp[i]);
+            printEnvironmentEntry(envp[i]);
         }
     }
-    else if (commandList[2] != NULL)
+    else
     {
-        if (strcmp("PATH", commandList[1]) == 0)
-        {
-            setenv("PATH", commandList[2], 1);
-            pathChanged = 1;
-        }
-        else
+        if (strchr(commandList[1], '=') != NULL)
         {
-            setenv(commandList[1], commandList[2], 1);
+            fprintf(stderr, "%s", " setenv: Variable name must not contain '='.\n");
+            return 0;
         }
+        unsigned long before = environmentVersion();
+        setEnvVar(commandList[1], commandList[2] != NULL ? commandList[2] : "");
+        if (strcmp("PATH", commandList[1]) == 0 && environmentVersion() != before)
+            pathChanged = 1;
     }
-    else
+    return pathChanged ? 2 : 0;
+}
+
+/**
+ * setVariable, sets shell variables the way tcsh does: "set name" or "set name=value", several at once.
+ *              With no arguments it lists them. Setting "trace" starts recording spans of the command
+ *              pipeline, its value is the file the trace is dumped to when it is unset or the shell exits. "linemax"
+ *              is the longest input line accepted, in bytes. "nouring" makes the batched builtins use
+ *              blocking calls instead of io_uring.
+ * 
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void setVariable(char **commandList)
+{
+    char *equals;
+    if (commandList[1] == NULL)
     {
-        if (strcmp(commandList[1], "PATH") == 0)
-        {
-            setenv("PATH", "", 1);
-            pathChanged = 1;
-        }
-        else
+        for (struct shellvar *var = shellVariables(); var != NULL; var = var->next)
+            if (outputJson)
+                outRecord("var", "name:s value:s", var->name, var->value);
+            else
+                outPrintf("%s\t%s\n", var->name, var->value);
+        return;
+    }
+    for (int i = 1; commandList[i] != NULL; i++)
+    {
+        if ((equals = strchr(commandList[i], '=')) != NULL)
+            *equals = '\0';
+        if (commandList[i][0] == '\0')
         {
-            setenv(commandList[1], "", 1);
+            fprintf(stderr, " set: Variable name must begin with a letter.\n");
+            continue;
         }
+        setShellVar(commandList[i], equals ? equals + 1 : "");
+        if (strcmp(commandList[i], "trace") == 0)
+            enableTracing(equals ? equals + 1 : NULL);
+        else if (strcmp(commandList[i], "linemax") == 0)
+            setLineLimit(equals ? strtoul(equals + 1, NULL, 10) : 0);
+        else if (strcmp(commandList[i], "output") == 0)
+            setOutputFormat(equals ? equals + 1 : "");
+        else if (strcmp(commandList[i], "nouring") == 0)
+            setUringEnabled(0);
+        if (equals)
+            *equals = '=';
+    }
+}
+
+/**
+ * unsetVariable, removes each shell variable named. Unsetting "trace" stops tracing and dumps the trace.
+ * 
+ * Args: An array of strings
+ * Return: Nothing
+ */
+void unsetVariable(char **commandList)
+{
+    if (commandList[1] == NULL)
+    {
+        fprintf(stderr, " unset: Too few arguments.\n");
+        return;
+    }
+    for (int i = 1; commandList[i] != NULL; i++)
+    {
+        unsetShellVar(commandList[i]);
+        if (strcmp(commandList[i], "trace") == 0)
+            disableTracing();
+        else if (strcmp(commandList[i], "linemax") == 0)
+            setLineLimit(0);
+        else if (strcmp(commandList[i], "output") == 0)
+            setOutputFormat("text");
+        else if (strcmp(commandList[i], "nouring") == 0)
+            setUringEnabled(1);
     }
-    return pathChanged ? 2 : 0;
 }
 
 /**
  * printEnvironment, when given no arguments, prints all of the enviornment variables.
- *           When given one argument, calls getenv(3). Two or more arguments
+ *           When given one argument, looks it up in the shell's environment. Two or more arguments
  *           are not accepted and will invoke an error message.
  * 
  * Args: A string, An array of strings
  * Return: Nothing
  */
-void printEnvironment(char **commandList, char **envp)
+void printEnvironment(char **commandList)
 {
-    if (commandList[2] != NULL)
+    char **envp;
+    if (commandList[1] != NULL && commandList[2] != NULL)
     {
         fprintf(stderr, "%s", " printenv: Too many arguments\n");
     }
     else if (commandList[1] == NULL)
     {
+        envp = exportEnvironment();
         for (int i = 0; envp[i] != NULL; i++)
         {
-            printf("\n%s", envp[i]);
+            printEnvironmentEntry(envp[i]);
         }
     }
     else
     {
-        if (getenv(commandList[1]) != NULL)
-            printf(" %s\n", getenv(commandList[1]));
+        char *value = getEnvVar(commandList[1]);
+        if (value != NULL && outputJson)
+            outRecord("env", "name:s value:s", commandList[1], value);
+        else if (value != NULL)
+            outPrintf(" %s\n", value);
         else
+        {
             fprintf(stderr, "%s", " Error: environment variable not found\n");
+            lastExitStatus = 1;
+        }
     }
 }
 
@@ -1104,7 +1989,7 @@ void printEnvironment(char **commandList, char **envp)
  * changeDirectory, with no arguments, changes the cwd to the home directory. 
  *                  with "-" as an argument, changes directory to the one 
  *                  previously in. Otherwise change to the directory given as
- *                  the argument.
+ *                  the argument, looking through cdpath if it isn't here.
  * 
  * Args: A list of strings
  * Return: Nothing
@@ -1114,25 +1999,23 @@ void changeDirectory(char **commandList)
     int success;
     if (commandList[1] == NULL) {
         // cd with nothing passed in
-        free(last_dir);
-        last_dir = getcwd(NULL, 0);
-        success = chdir(getenv("HOME"));
+        success = changeTo(getEnvVar("HOME") ? getEnvVar("HOME") : "/");
     }
     else if (strcmp(commandList[1], "-") == 0) {
         // cd to previous dir
-        success = chdir(last_dir);
-        free(last_dir);
-        last_dir = getcwd(NULL, 0);
+        success = last_dir ? changeTo(last_dir) : -1;
     } else {
         // normal path in cd
-        free(last_dir);
-        last_dir = getcwd(NULL, 0);
-        success = chdir(commandList[1]);
+        success = changeToCdpath(commandList[1]);
     }
-    if (success >= 0) {
-        printf("Directory change successful\n");
+    if (outputJson) {
+        outRecord("cd", "success:b path:s", success >= 0, currentDirectory());
+        lastExitStatus = success < 0;
+    } else if (success >= 0) {
+        outPrintf("Directory change successful\n");
     } else {
-        printf("Directory change failed\n");
+        outPrintf("Directory change failed\n");
+        lastExitStatus = 1;
     }
 }
 
@@ -1145,7 +2028,10 @@ void changeDirectory(char **commandList)
 void printPid()
 {
     int pid = getpid();
-    printf(" pid: %d\n", pid);
+    if (outputJson)
+        outRecord("pid", "pid:d", pid);
+    else
+        outPrintf(" pid: %d\n", pid);
 }
 
 /**
@@ -1169,9 +2055,10 @@ int exitProgram()
  */
 void printWorkingDirectory()
 {
-    char *ptr = getcwd(NULL, 0);
-    printf(" %s\n", ptr);
-    free(ptr);
+    if (outputJson)
+        outRecord("pwd", "path:s", currentDirectory());
+    else
+        outPrintf(" %s\n", currentDirectory());
 }
 
 /**
@@ -1186,9 +2073,12 @@ void prompt(char **commandList)
 {
     if (commandList[1] != NULL)
     {
+        size_t length = 1;
+        for (int i = 1; commandList[i] != NULL; i++)
+            length += strlen(commandList[i]) + 1;
         if (prefix != NULL)
             free(prefix);
-        prefix = (char *)malloc(sizeof(commandList) + 1);
+        prefix = (char *)malloc(length);
         strcpy(prefix, "");
         for (int i = 1; commandList[i] != NULL; i++)
         {
@@ -1198,57 +2088,113 @@ void prompt(char **commandList)
     }
     else
     {
-        char tempBuffer[BUFFERSIZE];
-        printf(" input prompt prefix: ");
-        fgets(tempBuffer, BUFFERSIZE, stdin);
-        tempBuffer[strlen(tempBuffer) - 1] = '\0';
+        char *line = readLine(" input prompt prefix: ");
+        if (line == NULL)
+            return;
         if (prefix != NULL)
             free(prefix);
-        prefix = (char *)malloc(strlen(tempBuffer) + 1);
-        strcpy(prefix, tempBuffer);
+        prefix = line;
+    }
+}
+
+/**
+ * freeCandidates, frees what probePath returned.
+ *
+ * Args: An array of strings, A size_t
+ * Return: Nothing
+ */
+static void freeCandidates(char **candidates, size_t count)
+{
+    for (size_t i = 0; candidates != NULL && i < count; i++)
+        free(candidates[i]);
+    free(candidates);
+}
+
+/**
+ * probePath, builds dir/command for every PATH dir and stats them all in one batch, so a command
+ *            is looked for in every dir at once instead of one dir after another. found gets 1 for
+ *            each candidate that exists. Returns the candidates, NULL if out of memory. Don't forget
+ *            to free them.
+ *
+ * Args: A string, An array of integers
+ * Return: An array of strings
+ */
+static char **probePath(char *command, int *found)
+{
+    size_t count = pathList.count;
+    char **candidates = calloc(count + 1, sizeof(char *));
+    const char **names = malloc((count + 1) * sizeof(char *));
+    int *dirFds = malloc((count + 1) * sizeof(int));
+    if (candidates == NULL || names == NULL || dirFds == NULL)
+    {
+        perror("which");
+        free(candidates);
+        candidates = NULL;
+        count = 0;
     }
+    for (size_t i = 0; i < count; i++)
+    {
+        struct pathelement *dir = &VECTOR_AT(pathList, struct pathelement, i);
+        if (asprintf(&candidates[i], "%s/%s", dir->element, command) < 0)
+        {
+            perror("which");
+            candidates[i] = NULL;
+            freeCandidates(candidates, i);
+            candidates = NULL;
+            break;
+        }
+        dirFds[i] = dir->dirfd;
+        names[i] = dir->dirfd == AT_FDCWD ? candidates[i] : command; // A relative dir is found from the cwd
+    }
+    if (candidates != NULL)
+        prefetchStats(count, dirFds, names, (const char **)candidates, found);
+    free(names);
+    free(dirFds);
+    return candidates;
+}
+
+/**
+ * isPathCommand, whether the i'th candidate from probePath is an executable file.
+ *
+ * Args: An array of strings, An array of integers, A size_t, A string
+ * Return: An integer
+ */
+static int isPathCommand(char **candidates, int *found, size_t i, char *command)
+{
+    struct pathelement *dir = &VECTOR_AT(pathList, struct pathelement, i);
+    struct statx st;
+    const char *name = dir->dirfd == AT_FDCWD ? candidates[i] : command;
+    return found[i] && cachedStat(dir->dirfd, name, candidates[i], &st) == 0 &&
+           S_ISREG(st.stx_mode) && cachedAccess(dir->dirfd, name, candidates[i], X_OK) == 0;
 }
 
 /**
  * which, locates commands. Returns the location of the command given as the argument.
  *                          If this function is called, don't forget to free the returned
- *                          string at some point.
+ *                          string at some point. Each PATH dir is probed through its open
+ *                          fd, all of them in one batch, so no directory is read.
  * 
- * Args: A string, A list of strings
+ * Args: A string
  * Return: A string
  */
-char *which(char *command, struct pathelement *pathlist)
+char *which(char *command)
 {
-    char temp[BUFFERSIZE];
-    DIR *dp;
-    struct dirent *dirp;
-    while (pathlist)
-    {
-        if ((dp = opendir(pathlist->element)) == NULL)
-        {
-            perror("opendir");
-            exit(errno);
-        }
-        while ((dirp = readdir(dp)) != NULL)
-        {
-            if (strcmp(dirp->d_name, command) == 0)
-            {
-                if (access(pathlist->element, X_OK) == 0)
-                {
-                    strcpy(temp, pathlist->element);
-                    strcat(temp, "/");
-                    strcat(temp, dirp->d_name);
-                    char *executablePath = (char *)malloc(strlen(temp) + 1);
-                    strcpy(executablePath, temp);
-                    closedir(dp);
-                    return executablePath;
-                }
-            }
-        }
-        closedir(dp);
-        pathlist = pathlist->next;
-    }
-    printf(" %s: Command not found.\n", command);
+    uint64_t whichStart = traceStart(); // Before the probe, so the span covers the batched statx
+    size_t count = pathList.count;
+    int *found = calloc(count + 1, sizeof(int));
+    char **candidates = found != NULL ? probePath(command, found) : NULL, *path = NULL;
+    for (size_t i = 0; candidates != NULL && i < count && path == NULL; i++)
+        if (isPathCommand(candidates, found, i, command))
+            path = strdup(candidates[i]);
+    freeCandidates(candidates, count);
+    free(found);
+    traceEnd("which", whichStart, command);
+    if (path != NULL)
+        return path;
+    if (outputJson)
+        outRecord("which", "command:s path:s", command, NULL);
+    else
+        outPrintf(" %s: Command not found.\n", command);
     return NULL;
 }
 
@@ -1256,88 +2202,120 @@ char *which(char *command, struct pathelement *pathlist)
  * where, returns all instances of the command in path. This is the same code as 
  *        the which function except the loop doesn't stop when one
  *        file is found, rather all files containing the command string will be
- *        returned assuming they're executables.
+ *        returned assuming they're executables. Returns NULL if there are none.
  * 
- * Args: A string, A list of strings
+ * Args: A string
  * Return: A string
  */
-char *where(char *command, struct pathelement *pathlist)
+char *where(char *command)
 {
-    char temp[BUFFERSIZE] = "";
-    DIR *dp;
-    struct dirent *dirp;
-    while (pathlist)
+    size_t count = pathList.count, length = 0;
+    int *found = calloc(count + 1, sizeof(int));
+    char **candidates = found != NULL ? probePath(command, found) : NULL, *paths = NULL;
+    for (size_t i = 0; candidates != NULL && i < count; i++)
     {
-        if ((dp = opendir(pathlist->element)) == NULL)
-        {
-            perror(" Error opening");
-            return NULL;
-        }
-        while ((dirp = readdir(dp)) != NULL)
+        if (isPathCommand(candidates, found, i, command))
         {
-            if (strcmp(dirp->d_name, command) == 0)
+            size_t added = strlen(candidates[i]) + 1;
+            char *grown = realloc(paths, length + added + 1);
+            if (grown == NULL)
             {
-                if (access(pathlist->element, X_OK) == 0)
-                {
-                    strcat(temp, pathlist->element);
-                    strcat(temp, "/");
-                    strcat(temp, dirp->d_name);
-                    strcat(temp, "\n\n");
-                }
+                perror("where");
+                break;
             }
+            paths = grown;
+            memcpy(paths + length, candidates[i], added - 1);
+            paths[length + added - 1] = '\n';
+            paths[length + added] = '\0';
+            length += added;
         }
-        closedir(dp);
-        pathlist = pathlist->next;
     }
-    if (temp == NULL)
-        return NULL;
-    char *path = (char *)malloc(sizeof(temp));
-    strcpy(path, temp);
-    return path;
+    freeCandidates(candidates, count);
+    free(found);
+    return paths;
 }
 
 /**
  * list, acts as the ls command, with no arguments, lists all the files in the
  *       current working directory, with arguments lists the files contained in
- *       the arguments given (directories).
+ *       the arguments given (directories). listHandler opens the directory, fd is
+ *       it or -errno if it couldn't be opened.
  * 
- * Args: A string (directory name)
+ * Args: A string (directory name), An integer
  * Return: Nothing
  */
-void list(char *dir)
+void list(char *dir, int fd)
 {
-    DIR *dp;
+    DIR *dp = NULL;
     struct dirent *dirp;
+    if (fd >= 0 && (dp = fdopendir(fd)) == NULL)
+    {
+        int error = errno;
+        close(fd);
+        fd = -error;
+    }
     if (strcmp(dir, "") == 0)
     {
         char *cwd = getcwd(NULL, 0);
-        if ((dp = opendir(cwd)) == NULL)
+        if (dp == NULL)
         {
             errno = ENOENT;
             perror("No cwd: ");
+            free(cwd);
+            return;
         }
         while ((dirp = readdir(dp)) != NULL)
-            printf(" %s\n", dirp->d_name);
+            if (outputJson)
+                outRecord("list", "dir:s name:s", cwd, dirp->d_name);
+            else
+                outPrintf(" %s\n", dirp->d_name);
         free(cwd);
-        free(dp);
+        closedir(dp);
     }
     else
     {
-        if ((dp = opendir(dir)) == NULL)
+        if (dp == NULL)
         {
-            errno = ENOENT;
-            printf(" list: cannot access %s: %s\n", dir, strerror(errno));
+            errno = -fd;
+            if (outputJson)
+                outRecord("list", "dir:s error:s", dir, strerror(errno));
+            else
+                outPrintf(" list: cannot access %s: %s\n", dir, strerror(errno));
             return;
         }
-        printf(" %s:\n", dir);
+        if (!outputJson)
+            outPrintf(" %s:\n", dir);
         while ((dirp = readdir(dp)) != NULL)
         {
-            printf("    %s\n", dirp->d_name);
+            if (outputJson)
+                outRecord("list", "dir:s name:s", dir, dirp->d_name);
+            else
+                outPrintf("    %s\n", dirp->d_name);
         }
         closedir(dp);
     }
 }
 
+/**
+ * getPrompt, builds the prompt string in the form prefix [path]> for the line editor.
+ *            Don't forget to free it.
+ * 
+ * Args: Nothing 
+ * Return: A string
+ */
+char *getPrompt()
+{
+    const char *ptr = currentDirectory();
+    char *promptString;
+    size_t size = strlen(ptr) + (prefix ? strlen(prefix) : 0) + 8;
+    promptString = malloc(size);
+    if (prefix != NULL)
+        snprintf(promptString, size, "%s [%s]>", prefix, ptr);
+    else
+        snprintf(promptString, size, "[%s]>", ptr);
+    return promptString;
+}
+
 /**
  * printShell, prints the cwd in the form [path]>
  * 
@@ -1346,112 +2324,141 @@ void list(char *dir)
  */
 void printShell()
 {
-    char *ptr = getcwd(NULL, 0);
-    if (prefix != NULL)
-        printf("%s [%s]>", prefix, ptr);
-    else
-        printf("[%s]>", ptr);
-    free(ptr);
+    char *promptString = getPrompt();
+    printf("%s", promptString);
+    free(promptString);
 }
 
 /**
  * listHandler, handles the logic for the list function. Checks if called
  *              with no arguments, or with arguments and calls list accordingly.
+ *              Every directory named is opened in one batch before any is listed.
  * 
  * Args: An array of strings
  * Return: Nothing
  */
 void listHandler(char **commandList)
 {
-    if (commandList[1] == NULL)
+    size_t count = 0;
+    int *fds;
+    while (commandList[count + 1] != NULL)
+        count++;
+    if (count == 0)
     {
-        list("");
+        list("", open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        return;
     }
-    else
+    if ((fds = malloc(count * sizeof(int))) == NULL)
     {
-        for (int i = 1; commandList[i] != NULL; i++)
-            list(commandList[i]);
+        perror("list");
+        return;
     }
+    batchOpen(count, NULL, (const char **)commandList + 1, O_RDONLY | O_DIRECTORY | O_CLOEXEC, fds);
+    for (size_t i = 0; i < count; i++)
+        list(commandList[i + 1], fds[i]);
+    free(fds);
 }
 
 /**
  * whichHandler, Handles multiples args being sent to which
  * 
- * Args: Two lists of strings
+ * Args: An array of strings
  * Return: Nothing
  */
-void whichHandler(char **commandList, struct pathelement *pathList)
+void whichHandler(char **commandList)
 {
     char *pathToCmd;
     for (int i = 1; commandList[i] != NULL; i++)
     {
-        pathToCmd = which(commandList[i], pathList);
-        if (pathToCmd != NULL)
+        pathToCmd = which(commandList[i]);
+        if (pathToCmd != NULL && outputJson)
+        {
+            outRecord("which", "command:s path:s", commandList[i], pathToCmd);
+            free(pathToCmd);
+        }
+        else if (pathToCmd != NULL)
         {
-            printf(" %s\n", pathToCmd);
+            outPrintf(" %s\n", pathToCmd);
             free(pathToCmd);
         }
+        else
+            lastExitStatus = 1;
     }
 }
 
 /**
  * whereHandler, Handles multiples args being sent to where
  * 
- * Args: Two lists of strings
+ * Args: An array of strings
  * Return: Nothing
  */
-void whereHandler(char **commandList, struct pathelement *pathList)
+void whereHandler(char **commandList)
 {
-    char *paths;
+    char *paths, *path, *rest;
     for (int i = 1; commandList[i] != NULL; i++)
     {
-        paths = where(commandList[i], pathList);
-        if (paths != NULL)
-            printf("%s", paths);
+        paths = where(commandList[i]);
+        if (paths != NULL && outputJson)
+        {
+            for (path = strtok_r(paths, "\n", &rest); path != NULL; path = strtok_r(NULL, "\n", &rest))
+                outRecord("where", "command:s path:s", commandList[i], path);
+        }
+        else if (paths != NULL)
+            outPrintf("%s", paths);
+        else if (outputJson)
+        {
+            outRecord("where", "command:s path:s", commandList[i], NULL);
+            lastExitStatus = 1;
+        }
         else
-            printf(" %s: command not found\n", commandList[i]);
+        {
+            outPrintf(" %s: command not found\n", commandList[i]);
+            lastExitStatus = 1;
+        }
         free(paths);
     }
 }
 
 /**
- * freePath, if the path environment variable is changed vis setenv, 
- *           the linked list data structure holding the path elements
- *           is freed using this function.
+ * freeAndExit, this function gets called when exit is typed to exit. Frees all of the things that are still taking
+ *              up space and exits the program with lastExitStatus, which is 0 for the exit builtin.
  * 
- * Args: A structure
+ * Args: An array of strings
  * Return: Nothing
  */
-void freePath(struct pathelement *pathList)
+void freeAndExit(char **commandList)
 {
-    struct pathelement *temp;
-    while (pathList != NULL)
+    if (inSubshell)
     {
-        temp = pathList;
-        pathList = pathList->next;
-        free(temp);
+        // Everything else belongs to the parent shell
+        outFlush();
+        fflush(stderr);
+        _exit(lastExitStatus);
     }
-    free(path);
-}
-
-/**
- * freeAndExit, this function gets called when exit is typed to exit. Frees all of the things that are still taking
- *              up space and exits the program.
- * 
- * Args: A struct, An array of strings
- * Return: Nothing
- */
-void freeAndExit(struct pathelement *pathList, char **commandList)
-{
     if (prefix)
         free(prefix);
-    freePath(pathList);
+    freePath();
     free(last_dir);
-    freeUsers(userHead);
-    pthread_cancel(watchUserID);
-    pthread_join(watchUserID, NULL);
-    freeAllMail(mailHead);
+    if (threadExists)
+    {
+        pthread_cancel(watchUserID);
+        pthread_join(watchUserID, NULL);
+    }
+    freeUsers(); // Not before the thread is gone, it reads the list
+    stopWatching();
+    disableTracing();
+    freeDirectories(); // Needs $HOME to find the z database
+    freeEnvironment();
+    freeLineEditor();
+    freeOutput();
+    freeJobs();
+    freeJobSpools();
+    freeResources();
+    freeProcesses();
+    freeUring();
+    freeAliases();
+    freeStrings();
     free(commandList[0]);
     free(commandList);
-    exit(0);
+    exit(lastExitStatus);
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
  *    Ben Segal | bensegal@udel.edu | 702425559         *
  ********************************************************/
 
+#define _GNU_SOURCE // memfd_create
 #include <signal.h> 
 #include <stdio.h>
 #include <string.h>
@@ -23,29 +24,72 @@
 #include <sys/stat.h>
 #include <pthread.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
 #include "lists.h"
+#include "env.h"
+#include "lineedit.h"
+#include "output.h"
+#include "jobs.h"
+#include "memo.h"
+#include "trace.h"
+#include "watch.h"
+#include "subst.h"
+#include "resources.h"
+#include "batch.h"
+#include "server.h"
+#include "dirs.h"
+#include "procs.h"
+#include "joblog.h"
+#include "statcache.h"
+#include "uring.h"
+#include "alias.h"
+#include "rc.h"
 
 // CONSTANTS
-#define MAX_CMD 128
-#define BUFFERSIZE 512
-#define BUILT_IN_COMMAND_COUNT 14
+#define ARGV_INITIAL 16    // Slots in a new argument vector, it doubles from there
+#define ARGV_KEEP_MAX 4096 // A vector grown past this is shrunk back before the next line
+#define SYNTAX_ERROR -1
+#define BUILT_IN_COMMAND_COUNT 31
+
+extern const char *builtInCommands[BUILT_IN_COMMAND_COUNT];
+extern int lastExitStatus, inSubshell, threadExists, announceCommands;
+extern size_t commandCapacity;
+extern char *last_dir;
 
 // HELPER FUNCTIONS
 char **parseBuffer(char buffer[], char **commandList);
-void executeBuiltInFunctions(char **commandList, char **envp, struct pathelement *pathList, char **argv);
+char **growCommandList(char **commandList, size_t *capacity, size_t needed);
+int operatorLength(const char *text);
+char **tokenizeLine(char *line, char **commandList, size_t *capacity);
+char **appendWord(char **commandList, size_t *count, size_t *capacity, char *word);
+void executeBuiltInFunctions(char **commandList, char **argv);
 int shouldRunAsBackground(char **commandList);
-void runExecutable(char **commandList, char **envp, struct pathelement *pathList, char **argv);
+void runExecutable(char **commandList, char **argv);
+void runCommand(char **commandList, char **argv);
+void runMemoized(char **commandList, char **argv);
 void *watchUserCallback(void *arg);
 int isBuiltIn(char *command); 
-void runBuiltIn(char **commandList, struct pathelement *pathList, char **envp);
-void sigHandler(int signal);
-void childHandler(int signal);
-void alarmHandler(int);
-char *getExternalPath(char **commandList, struct pathelement *pathList);
+void runBuiltIn(char **commandList);
+void runRedirectedBuiltIn(char **commandList);
+void restoreStandardFds(int savedFds[3]);
+char *getExternalPath(char **commandList);
+
+
+// COMMAND LISTS
+int runCommandLine(char **commandList, char **argv);
+int groupDelta(char **commandList, int i);
+int findGroupEnd(char **commandList, int open, int end);
+int syntaxError(const char *word);
+int runList(char **commandList, int start, int end, char **argv, int execute);
+int runAndOr(char **commandList, int start, int end, char **argv, int execute);
+int runGroup(char **commandList, int start, int end, char **argv, int execute);
+int runSubshell(char **commandList, int start, int end, int background, char **argv);
 
 
 // REDIRECTION
 int getRedirectionType(char **commandList);
+int isRedirection(const char *word);
 void removeAfterRedirect(char **commandList);
 char *getRedirectionDest(char **commandList);
 int handleRedirection(int redirectionType, char *destFile);
@@ -54,7 +98,7 @@ int handleRedirection(int redirectionType, char *destFile);
 // PIPES
 int getPipeType(char **commandList);
 char **splitPipe(char **commandList, int beforeOrAfter);
-int handlePipes(char **commandList, char **envp, struct pathelement *pathList, char **argv);
+int handlePipes(char **commandList, char **argv);
 void freePipeArrays(char **beforePipe, char **afterPipe);
 
 
@@ -62,26 +106,27 @@ void freePipeArrays(char **beforePipe, char **afterPipe);
 void noClobber();
 void watchMail(char **commandList);
 void watchUser(char **commandList);
-char *which(char *command, struct pathelement *pathList);
-char *where(char *command, struct pathelement *pathList);
-void list (char *dir);
-void printenv(char **envp);
+char *which(char *command);
+char *where(char *command);
+void list (char *dir, int fd);
 void printWorkingDirectory();
 void prompt(char *commandList[]);
 int exitProgram();
 void printPid();
 void changeDirectory(char **commandList);
-void printEnvironment(char **commandList, char **envp); 
-int setEnvironment(char **commandList, char **envp, struct pathelement *pathList);
+void printEnvironment(char **commandList);
+int setEnvironment(char **commandList);
 void killIt(char **commandList);
+void resumeJob(char **commandList, int foreground);
+void setVariable(char **commandList);
+void unsetVariable(char **commandList);
 
 
 // CONVIENIENCE FUNCTIONS
 void printShell();
+char *getPrompt();
 void listHandler(char **commandList);
-void whichHandler(char **commandList, struct pathelement *pathList);
-void whereHandler(char **commandList, struct pathelement *pathList);
-void freeAll(struct pathelement *pathList, char *cwd);
-void freePath(struct pathelement *pathList);
+void whichHandler(char **commandList);
+void whereHandler(char **commandList);
 void handleInvalidArguments(char *arg);
-void freeAndExit(struct pathelement *pathList, char **commandList);
\ No newline at end of file
+void freeAndExit(char **commandList);
\ No newline at end of file
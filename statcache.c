@@ -0,0 +1,181 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Stat cache globals
+static struct vector statEntries = VECTOR_OF(struct statentry);
+static struct stringmap statIndex;    // Path to its index in statEntries
+
+/**
+ * findEntry, the cached entry for a path, made empty if there isn't one yet and make is set.
+ *            Returns NULL if there is none, or no memory for one.
+ *
+ * Args: A string, An integer
+ * Return: A struct
+ */
+static struct statentry *findEntry(const char *path, int make)
+{
+    size_t *index = mapFind(&statIndex, path);
+    struct statentry *entry;
+    char *key;
+    if (index != NULL)
+        return &VECTOR_AT(statEntries, struct statentry, *index);
+    if (!make || (key = strdup(path)) == NULL)
+        return NULL;
+    if ((entry = vectorPush(&statEntries)) == NULL || mapInsert(&statIndex, key, statEntries.count - 1) != 0)
+    {
+        if (entry != NULL)
+            statEntries.count--;
+        free(key);
+        return NULL;
+    }
+    entry->path = key; // The map points at it, it moves with the entry but never changes
+    return entry;
+}
+
+/**
+ * cachedStat, statx of name relative to dirFd (AT_FDCWD for the cwd), remembered for the rest of the command line
+ *             under path. Returns -1 with errno set if the file can't be stat'ed.
+ *
+ * Args: An integer, A string, A string, A struct
+ * Return: An integer
+ */
+int cachedStat(int dirFd, const char *name, const char *path, struct statx *result)
+{
+    struct statentry *entry = findEntry(path, 0);
+    struct statx stx;
+    if (entry != NULL && entry->hasStat)
+    {
+        *result = entry->stx;
+        return 0;
+    }
+    if (statx(dirFd, name, AT_STATX_SYNC_AS_STAT, STATX_BASIC_STATS, &stx) != 0)
+        return -1;
+    if ((entry = findEntry(path, 1)) != NULL)
+    {
+        entry->stx = stx;
+        entry->hasStat = 1;
+    }
+    *result = stx;
+    return 0;
+}
+
+/**
+ * prefetchStats, cachedStat of many paths at once. The ones not cached yet are stat'ed in one batch,
+ *                through io_uring when there is one. found gets 1 for each path that exists.
+ *
+ * Args: A size_t, An array of integers, An array of strings, An array of strings, An array of integers
+ * Return: Nothing
+ */
+void prefetchStats(size_t count, const int *dirFds, const char **names, const char **paths, int *found)
+{
+    struct statx *results = malloc(count * sizeof(struct statx)), stx;
+    const char **missingNames = malloc(count * sizeof(char *));
+    int *missingFds = malloc(count * sizeof(int)), *errors = malloc(count * sizeof(int));
+    size_t *missing = malloc(count * sizeof(size_t)), missed = 0;
+    struct statentry *entry;
+    if (results != NULL && missingNames != NULL && missingFds != NULL && errors != NULL && missing != NULL)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            entry = findEntry(paths[i], 0);
+            if ((found[i] = entry != NULL && entry->hasStat))
+                continue;
+            missing[missed] = i;
+            missingFds[missed] = dirFds[i];
+            missingNames[missed++] = names[i];
+        }
+        batchStatx(missed, missingFds, missingNames, results, errors);
+        for (size_t j = 0; j < missed; j++)
+        {
+            if (errors[j] != 0)
+                continue;
+            found[missing[j]] = 1;
+            if ((entry = findEntry(paths[missing[j]], 1)) != NULL)
+            {
+                entry->stx = results[j];
+                entry->hasStat = 1;
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+            found[i] = cachedStat(dirFds[i], names[i], paths[i], &stx) == 0;
+    }
+    free(results);
+    free(missingNames);
+    free(missingFds);
+    free(errors);
+    free(missing);
+}
+
+/**
+ * cachedAccess, faccessat with AT_EACCESS, so the answer is for the shell's effective ids and covers ACLs and
+ *               read-only mounts, which the mode bits alone don't. Remembered for the rest of the command line
+ *               under path. Returns 0 if allowed, else -1 with errno set.
+ *
+ * Args: An integer, A string, A string, An integer
+ * Return: An integer
+ */
+int cachedAccess(int dirFd, const char *name, const char *path, int mode)
+{
+    struct statentry *entry = findEntry(path, 0);
+    int allowed;
+    if (entry != NULL && (entry->accessKnown & mode) == mode)
+    {
+        if ((entry->accessAllowed & mode) == mode)
+            return 0;
+        errno = EACCES;
+        return -1;
+    }
+    allowed = faccessat(dirFd, name, mode, AT_EACCESS) == 0;
+    if (!allowed && errno != EACCES)
+        return -1; // Missing, or no way to tell, ask again next time
+    if ((entry = findEntry(path, 1)) != NULL)
+    {
+        entry->accessKnown |= mode;
+        entry->accessAllowed = allowed ? entry->accessAllowed | mode : entry->accessAllowed & ~mode;
+    }
+    if (allowed)
+        return 0;
+    errno = EACCES;
+    return -1;
+}
+
+/**
+ * forgetStat, drops what is known about a path, for when the shell itself creates or truncates it.
+ *
+ * Args: A string
+ * Return: Nothing
+ */
+void forgetStat(const char *path)
+{
+    struct statentry *entry = findEntry(path, 0);
+    if (entry != NULL)
+    {
+        entry->hasStat = 0;
+        entry->accessKnown = 0;
+    }
+}
+
+/**
+ * clearStatCache, forgets everything. Called before each command line, and when the cwd changes since
+ *                 relative paths then name other files.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void clearStatCache()
+{
+    for (size_t i = 0; i < statEntries.count; i++)
+        free(VECTOR_AT(statEntries, struct statentry, i).path);
+    vectorFree(&statEntries);
+    mapFree(&statIndex);
+}
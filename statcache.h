@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef STATCACHE_H
+#define STATCACHE_H
+
+/* What one command line has learned about a path. Only answers that found the
+   file are kept, a missing file is asked about again in case the line made it. */
+struct statentry {
+    char *path;               // The key, as the command line spelled it
+    int hasStat;
+    struct statx stx;
+    int accessKnown;          // R_OK, W_OK and X_OK bits already asked about
+    int accessAllowed;        // Which of those were allowed
+};
+
+int cachedStat(int dirFd, const char *name, const char *path, struct statx *result);
+void prefetchStats(size_t count, const int *dirFds, const char **names, const char **paths, int *found);
+int cachedAccess(int dirFd, const char *name, const char *path, int mode);
+void forgetStat(const char *path);
+void clearStatCache();
+
+#endif
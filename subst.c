@@ -0,0 +1,333 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Built-ins that only report on the shell, so they can run in it without a subshell changing anything
+static const char *inProcessBuiltIns[] = {"which", "where", "pwd", "list", "pid", "printenv", "jobs", "dirs", "procs"};
+
+/**
+ * isReadOnlyBuiltIn, whether a built-in is one of inProcessBuiltIns, those that only print and change
+ *                    nothing in the shell, so running them captured or not at all loses nothing.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int isReadOnlyBuiltIn(const char *name)
+{
+    for (size_t i = 0; i < sizeof(inProcessBuiltIns) / sizeof(inProcessBuiltIns[0]); i++)
+        if (strcmp(name, inProcessBuiltIns[i]) == 0)
+            return 1;
+    return 0;
+}
+
+/**
+ * hasSubstitution, whether a word contains a $( ... ) or ` ... ` to be expanded.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int hasSubstitution(const char *word)
+{
+    return strstr(word, "$(") != NULL || strchr(word, '`') != NULL;
+}
+
+/**
+ * findSubstitutionEnd, given a pointer at "$(" or "`", finds the ) or ` that closes it. Parentheses and
+ *                      substitutions inside it nest. Returns NULL if it is never closed.
+ *
+ * Args: A string
+ * Return: A string
+ */
+const char *findSubstitutionEnd(const char *start)
+{
+    int depth = 1;
+    if (*start == '`')
+        return strchr(start + 1, '`');
+    for (const char *p = start + 2; *p != '\0'; p++)
+    {
+        if (*p == '`' && (p = strchr(p + 1, '`')) == NULL)
+            return NULL;
+        else if (*p == '(')
+            depth++;
+        else if (*p == ')' && --depth == 0)
+            return p;
+    }
+    return NULL;
+}
+
+/**
+ * runsInProcess, whether the words of a substitution are a single built-in from inProcessBuiltIns, with no
+ *                operators or pipes. Those are run right in the shell with stdout pointed at a memfd.
+ *
+ * Args: An array of strings, A size_t
+ * Return: An integer
+ */
+static int runsInProcess(char **words, size_t count)
+{
+    int known = count > 0 && isReadOnlyBuiltIn(words[0]);
+    for (size_t i = 0; i < count && known; i++)
+        if (operatorLength(words[i]) > 0 || strcmp(words[i], "&") == 0 || strchr(words[i], '|') != NULL)
+            known = 0;
+    return known;
+}
+
+/**
+ * mapOutput, turns what was written to a memfd into a capture, read into a buffer if it is small
+ *            or mapped if it isn't.
+ *
+ * Args: An integer, A struct
+ * Return: Nothing
+ */
+static void mapOutput(int fd, struct capture *result)
+{
+    off_t length = lseek(fd, 0, SEEK_END);
+    void *data;
+    if (length <= 0)
+        return;
+    if (length > SUBST_BUFFER_MAX && (data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+    {
+        result->data = data;
+        result->length = result->mapped = length;
+    }
+    else if ((result->data = malloc(length)) != NULL)
+    {
+        result->length = pread(fd, result->data, length, 0) == length ? length : 0;
+    }
+}
+
+/**
+ * readOutput, streams a pipe into a buffer that doubles as it fills. Past SUBST_BUFFER_MAX the
+ *             buffer is moved into a memfd and the rest goes there, to be mapped at the end.
+ *
+ * Args: An integer, A struct
+ * Return: Nothing
+ */
+static void readOutput(int fd, struct capture *result)
+{
+    size_t size = SUBST_INITIAL_SIZE, length = 0;
+    char *buffer = malloc(size), *grown;
+    int spill = -1;
+    ssize_t got;
+    while (buffer != NULL && (got = read(fd, buffer + length, size - length)) != 0)
+    {
+        if (got < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        length += got;
+        if (length < size)
+            continue;
+        if (spill >= 0 || size >= SUBST_BUFFER_MAX)
+        {
+            if (spill < 0 && (spill = memfd_create("sssh-subst", MFD_CLOEXEC)) < 0)
+                break;
+            if (write(spill, buffer, length) != (ssize_t)length)
+                break;
+            length = 0;
+        }
+        else if ((grown = realloc(buffer, size * 2)) != NULL)
+        {
+            buffer = grown;
+            size *= 2;
+        }
+        else
+            break;
+    }
+    if (spill < 0)
+    {
+        result->data = buffer;
+        result->length = buffer ? length : 0;
+        return;
+    }
+    if (write(spill, buffer, length) != (ssize_t)length)
+        perror("substitution");
+    free(buffer);
+    mapOutput(spill, result);
+    close(spill);
+}
+
+/**
+ * captureCommand, runs the command line text and captures its stdout. A lone informational built-in
+ *                 runs in the shell itself with no fork. Anything else runs in a forked subshell job
+ *                 whose stdout is a pipe, read while it runs. Returns the exit status, result holds
+ *                 the output and must be released with releaseCapture.
+ *
+ * Args: A string, An array of strings, A struct
+ * Return: An integer
+ */
+int captureCommand(const char *text, char **argv, struct capture *result)
+{
+    char *line = strdup(text), **words = NULL;
+    size_t capacity = 0, count = 0;
+    int status = 0, wasAnnouncing = announceCommands, fds[2], savedStdout;
+    uint64_t captureStart = traceStart();
+    pid_t pid;
+    struct job *job;
+    memset(result, 0, sizeof(struct capture));
+    if (line == NULL || (words = expandAliases(tokenizeLine(line, NULL, &capacity), &capacity)) == NULL)
+    {
+        free(line);
+        return 1;
+    }
+    free(line);
+    while (words[count] != NULL)
+        count++;
+    if (count == 0 || runList(words, 0, count, argv, 0) == SYNTAX_ERROR)
+    {
+        status = count == 0 ? 0 : 2;
+    }
+    else if (runsInProcess(words, count))
+    {
+        int memory = memfd_create("sssh-subst", MFD_CLOEXEC);
+        fflush(stdout);
+        outFlush();
+        if (memory >= 0)
+        {
+            outHold(); // Or a watcher's notice would end up in the substitution
+            savedStdout = dup(STDOUT_FILENO);
+            dup2(memory, STDOUT_FILENO);
+            announceCommands = 0;
+            status = runList(words, 0, count, argv, 1);
+            announceCommands = wasAnnouncing;
+            outFlush();
+            fflush(stdout);
+            dup2(savedStdout, STDOUT_FILENO);
+            close(savedStdout);
+            outRelease();
+            mapOutput(memory, result);
+            close(memory);
+        }
+    }
+    else if (pipe(fds) != 0 || (pid = fork()) < 0)
+    {
+        perror("substitution");
+        status = 1;
+    }
+    else if (pid == 0)
+    {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[1]);
+        enterSubshell(1);
+        inSubshell = 1;
+        threadExists = 0;
+        announceCommands = 0;
+        status = runList(words, 0, count, argv, 1);
+        outFlush();
+        fflush(stderr);
+        _exit(status);
+    }
+    else
+    {
+        close(fds[1]);
+        setpgid(pid, pid);
+        job = addJob(pid, words);
+        readOutput(fds[0], result);
+        close(fds[0]);
+        status = job ? waitForJob(job, 0) : 1;
+    }
+    for (size_t i = 0; i < count; i++)
+        free(words[i]);
+    free(words);
+    traceEnd("substitution", captureStart, text);
+    return status;
+}
+
+/**
+ * releaseCapture, frees or unmaps captured output.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+void releaseCapture(struct capture *capture)
+{
+    if (capture->mapped)
+        munmap(capture->data, capture->mapped);
+    else
+        free(capture->data);
+    memset(capture, 0, sizeof(struct capture));
+}
+
+/**
+ * flushWord, appends the word built so far to the list and starts a new one.
+ *
+ * Args: A string, A pointer to a size_t, An array of strings, A pointer to a size_t, A pointer to a size_t
+ * Return: An array of strings
+ */
+static char **flushWord(char *word, size_t *length, char **commandList, size_t *count, size_t *capacity)
+{
+    if (*length == 0 || commandList == NULL)
+        return commandList;
+    word[*length] = '\0';
+    *length = 0;
+    return appendWord(commandList, count, capacity, word);
+}
+
+/**
+ * expandWord, replaces each substitution in a word with the output of its command and appends the
+ *             resulting words to the list. Trailing newlines are dropped and the rest of the output
+ *             is split on whitespace, the first and last
+ *             pieces join the text around the substitution, and each word is globbed like a typed
+ *             one. Returns the list (which may have moved), or NULL if memory ran out or the command
+ *             was interrupted, with lastExitStatus set.
+ *
+ * Args: A string, An array of strings, Two pointers to a size_t, An array of strings
+ * Return: An array of strings
+ */
+char **expandWord(const char *word, char **commandList, size_t *count, size_t *capacity, char **argv)
+{
+    size_t size = strlen(word) + 1, length = 0;
+    char *built = malloc(size), *grown, *inner;
+    const char *end;
+    struct capture output;
+    int status;
+    for (const char *p = word; *p != '\0' && built != NULL && commandList != NULL; p++)
+    {
+        if ((strncmp(p, "$(", 2) != 0 && *p != '`') || (end = findSubstitutionEnd(p)) == NULL)
+        {
+            built[length++] = *p;
+            continue;
+        }
+        inner = *p == '`' ? strndup(p + 1, end - p - 1) : strndup(p + 2, end - p - 2);
+        status = inner ? captureCommand(inner, argv, &output) : 1;
+        free(inner);
+        lastExitStatus = status;
+        if (status == 128 + SIGINT)
+        {
+            releaseCapture(&output);
+            free(built);
+            return NULL;
+        }
+        if ((grown = realloc(built, size + output.length)) == NULL)
+        {
+            releaseCapture(&output);
+            break;
+        }
+        built = grown;
+        size += output.length;
+        while (output.length > 0 && output.data[output.length - 1] == '\n')
+            output.length--; // Trailing newlines are dropped, not split on
+        for (size_t i = 0; i < output.length; i++)
+        {
+            if (output.data[i] == ' ' || output.data[i] == '\t' || output.data[i] == '\n')
+                commandList = flushWord(built, &length, commandList, count, capacity);
+            else
+                built[length++] = output.data[i];
+        }
+        releaseCapture(&output);
+        p = end;
+    }
+    if (built == NULL)
+        return NULL;
+    commandList = flushWord(built, &length, commandList, count, capacity);
+    free(built);
+    return commandList;
+}
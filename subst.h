@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef SUBST_H
+#define SUBST_H
+
+// command substitution definitions
+#define SUBST_INITIAL_SIZE 4096
+#define SUBST_BUFFER_MAX (1024 * 1024) // Output past this is spilled to a memfd and mapped
+
+/* The captured output of a substitution. mapped is nonzero when data is an mmap of the
+   memfd the output spilled to, rather than a malloc'd buffer. */
+struct capture {
+    char *data;
+    size_t length;
+    size_t mapped;
+};
+
+int hasSubstitution(const char *word);
+int isReadOnlyBuiltIn(const char *name);
+const char *findSubstitutionEnd(const char *start);
+int captureCommand(const char *text, char **argv, struct capture *result);
+void releaseCapture(struct capture *capture);
+char **expandWord(const char *word, char **commandList, size_t *count, size_t *capacity, char **argv);
+
+#endif
@@ -0,0 +1,190 @@
+#include "trace.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Tracing globals
+int traceEnabled = 0;
+static char *traceFile = NULL;
+
+/* The ring is a shared anonymous mapping so a forked child can still record the
+   redirection setup and exec that happen on its side of the fork. */
+static struct traceRing {
+    uint64_t next;            // Total spans ever recorded, bumped atomically
+    struct tracespan spans[TRACE_RING_SIZE];
+} *ring = NULL;
+
+/**
+ * now, the monotonic clock in nanoseconds.
+ *
+ * Args: Nothing
+ * Return: An unsigned 64 bit integer
+ */
+static uint64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * record, claims the next slot in the ring and fills it in.
+ *
+ * Args: A string, An unsigned 64 bit integer, A 64 bit integer, A string
+ * Return: Nothing
+ */
+static void record(const char *name, uint64_t start, int64_t duration, const char *detail)
+{
+    uint64_t slot = __atomic_fetch_add(&ring->next, 1, __ATOMIC_RELAXED);
+    struct tracespan *span = &ring->spans[slot % TRACE_RING_SIZE];
+    span->name = name;
+    span->start = start;
+    span->duration = duration;
+    span->pid = getpid();
+    snprintf(span->detail, sizeof(span->detail), "%s", detail ? detail : "");
+}
+
+/**
+ * enableTracing, starts recording spans. The ring is kept when tracing is turned off and on
+ *                again, file (if given) is where disableTracing will dump it.
+ *
+ * Args: A string
+ * Return: Nothing
+ */
+void enableTracing(const char *file)
+{
+    if (ring == NULL)
+    {
+        ring = mmap(NULL, sizeof(struct traceRing), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED)
+        {
+            perror("trace");
+            ring = NULL;
+            return;
+        }
+    }
+    if (file != NULL && file[0] != '\0')
+    {
+        free(traceFile);
+        traceFile = strdup(file);
+    }
+    traceEnabled = 1;
+}
+
+/**
+ * disableTracing, stops recording and dumps what was recorded.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void disableTracing()
+{
+    if (!traceEnabled)
+        return;
+    traceEnabled = 0;
+    if (dumpTrace(traceFile) == 0)
+        printf("trace written to %s\n", traceFile ? traceFile : TRACE_DEFAULT_FILE);
+}
+
+/**
+ * traceStart, the start time for a span, 0 when tracing is off so traceEnd can skip it.
+ *
+ * Args: Nothing
+ * Return: An unsigned 64 bit integer
+ */
+uint64_t traceStart()
+{
+    return traceEnabled ? now() : 0;
+}
+
+/**
+ * traceEnd, records a span from start until now. Does nothing if start came from traceStart
+ *           while tracing was off.
+ *
+ * Args: A string, An unsigned 64 bit integer, A string
+ * Return: Nothing
+ */
+void traceEnd(const char *name, uint64_t start, const char *detail)
+{
+    if (start == 0 || ring == NULL)
+        return;
+    record(name, start, (int64_t)(now() - start), detail);
+}
+
+/**
+ * traceInstant, records a point in time, like the moment a child calls execve.
+ *
+ * Args: Two strings
+ * Return: Nothing
+ */
+void traceInstant(const char *name, const char *detail)
+{
+    if (!traceEnabled || ring == NULL)
+        return;
+    record(name, now(), -1, detail);
+}
+
+/**
+ * writeJsonString, writes a string with the characters JSON needs escaped.
+ *
+ * Args: A file, A string
+ * Return: Nothing
+ */
+static void writeJsonString(FILE *file, const char *text)
+{
+    fputc('"', file);
+    for (; *text; text++)
+    {
+        if (*text == '"' || *text == '\\')
+            fprintf(file, "\\%c", *text);
+        else if ((unsigned char)*text < 0x20)
+            fprintf(file, "\\u%04x", *text);
+        else
+            fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+/**
+ * dumpTrace, writes the ring out as Chrome trace-event JSON, loadable in chrome://tracing or
+ *            Perfetto. Spans are complete ("X") events, instants are "i" events, times in
+ *            microseconds. Returns 0 on success.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int dumpTrace(const char *file)
+{
+    FILE *out;
+    uint64_t first, last;
+    if (ring == NULL)
+        return -1;
+    if ((out = fopen(file ? file : TRACE_DEFAULT_FILE, "w")) == NULL)
+    {
+        perror("trace");
+        return -1;
+    }
+    last = __atomic_load_n(&ring->next, __ATOMIC_RELAXED);
+    first = last > TRACE_RING_SIZE ? last - TRACE_RING_SIZE : 0;
+    fprintf(out, "{\"traceEvents\":[");
+    for (uint64_t i = first; i < last; i++)
+    {
+        struct tracespan *span = &ring->spans[i % TRACE_RING_SIZE];
+        fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"sssh\",\"ph\":\"%s\",\"ts\":%.3f,", i == first ? "" : ",",
+                span->name, span->duration < 0 ? "i" : "X", span->start / 1000.0);
+        if (span->duration >= 0)
+            fprintf(out, "\"dur\":%.3f,", span->duration / 1000.0);
+        else
+            fprintf(out, "\"s\":\"p\",");
+        fprintf(out, "\"pid\":%d,\"tid\":%d,\"args\":{\"detail\":", span->pid, span->pid);
+        writeJsonString(out, span->detail);
+        fprintf(out, "}}");
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(out) == 0 ? 0 : -1;
+}
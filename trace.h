@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// tracing definitions
+#define TRACE_RING_SIZE 8192      // Spans kept, the oldest are overwritten
+#define TRACE_DETAIL_SIZE 80
+#define TRACE_DEFAULT_FILE "sssh-trace.json"
+
+/* One finished span, or an instant event when duration is -1. */
+struct tracespan {
+    const char *name;         // Always a string literal
+    char detail[TRACE_DETAIL_SIZE];
+    uint64_t start;           // Nanoseconds, CLOCK_MONOTONIC
+    int64_t duration;
+    int pid;
+};
+
+extern int traceEnabled;
+
+void enableTracing(const char *file);
+void disableTracing();
+uint64_t traceStart();
+void traceEnd(const char *name, uint64_t start, const char *detail);
+void traceInstant(const char *name, const char *detail);
+int dumpTrace(const char *file);
+
+#endif
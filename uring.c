@@ -0,0 +1,295 @@
+#include "sh.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// io_uring globals
+static struct uring ring = {-1};
+static int ringState = 0;                 // 0 not tried yet, 1 ready, -1 not available
+static pid_t ringPid;                     // The process that set it up, a forked child must not share it
+static int uringEnabled = 1;              // Cleared by "set nouring"
+static pthread_mutex_t ringLock = PTHREAD_MUTEX_INITIALIZER; // The watcher thread batches too
+
+/* One batch of requests. prepare fills in the i'th request, fallback does it without the ring. */
+struct uringbatch {
+    void (*prepare)(struct io_uring_sqe *sqe, size_t i, void *arg);
+    int (*fallback)(size_t i, void *arg);
+    void *arg;
+};
+
+/**
+ * setupRing, makes the ring and maps its queues. Returns 0 on success, -1 if the kernel has no
+ *            io_uring or won't give us one (seccomp, io_uring_disabled).
+ *
+ * Args: Nothing
+ * Return: An integer
+ */
+static int setupRing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if ((ring.fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params)) < 0)
+        return -1;
+    ring.entries = params.sq_entries;
+    ring.sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring.sqeSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        ring.sqSize = ring.cqSize = ring.sqSize > ring.cqSize ? ring.sqSize : ring.cqSize;
+    ring.sqRing = mmap(NULL, ring.sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sqRing == MAP_FAILED)
+        ring.sqRing = NULL;
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        ring.cqRing = ring.sqRing;
+    else if ((ring.cqRing = mmap(NULL, ring.cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd,
+                                 IORING_OFF_CQ_RING)) == MAP_FAILED)
+        ring.cqRing = NULL;
+    if ((ring.sqes = mmap(NULL, ring.sqeSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd,
+                          IORING_OFF_SQES)) == MAP_FAILED)
+        ring.sqes = NULL;
+    if (ring.sqRing == NULL || ring.cqRing == NULL || ring.sqes == NULL)
+    {
+        freeUring();
+        return -1;
+    }
+    ring.sqHead = (unsigned *)((char *)ring.sqRing + params.sq_off.head);
+    ring.sqTail = (unsigned *)((char *)ring.sqRing + params.sq_off.tail);
+    ring.sqMask = (unsigned *)((char *)ring.sqRing + params.sq_off.ring_mask);
+    ring.sqArray = (unsigned *)((char *)ring.sqRing + params.sq_off.array);
+    ring.cqHead = (unsigned *)((char *)ring.cqRing + params.cq_off.head);
+    ring.cqTail = (unsigned *)((char *)ring.cqRing + params.cq_off.tail);
+    ring.cqMask = (unsigned *)((char *)ring.cqRing + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)((char *)ring.cqRing + params.cq_off.cqes);
+    ringPid = getpid();
+    return 0;
+}
+
+/**
+ * useRing, whether this batch can go through the ring, setting it up the first time. Called with
+ *          the lock held. Children forked from the shell and "set nouring" use the fallback.
+ *
+ * Args: Nothing
+ * Return: An integer
+ */
+static int useRing()
+{
+    if (!uringEnabled)
+        return 0;
+    if (ringState == 0)
+        ringState = setupRing() == 0 ? 1 : -1;
+    return ringState == 1 && getpid() == ringPid;
+}
+
+/**
+ * submitChunk, queues count requests starting at first, submits them with one io_uring_enter
+ *              and waits for all of them. Each result goes into results by the request's index.
+ *              Returns -1 if the kernel refused the submission, nothing was queued then.
+ *
+ * Args: A struct, A size_t, A size_t, An array of integers
+ * Return: An integer
+ */
+static int submitChunk(struct uringbatch *batch, size_t first, size_t count, int *results)
+{
+    unsigned tail = *ring.sqTail, head, toSubmit = count, reaped = 0;
+    int got;
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned index = (tail + i) & *ring.sqMask;
+        struct io_uring_sqe *sqe = &ring.sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        batch->prepare(sqe, first + i, batch->arg);
+        sqe->user_data = first + i;
+        ring.sqArray[index] = index;
+    }
+    __atomic_store_n(ring.sqTail, tail + count, __ATOMIC_RELEASE);
+    while (reaped < count)
+    {
+        got = syscall(__NR_io_uring_enter, ring.fd, toSubmit, count - reaped, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (got < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            if (toSubmit == count)
+            {
+                __atomic_store_n(ring.sqTail, tail, __ATOMIC_RELEASE);
+                return -1;
+            }
+            ringState = -1; // Some are in flight and can't be waited for, don't trust the ring again
+            return -1;
+        }
+        if (got > 0)
+            toSubmit -= (unsigned)got < toSubmit ? (unsigned)got : toSubmit;
+        head = *ring.cqHead;
+        for (; head != __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE); head++, reaped++)
+        {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cqMask];
+            results[cqe->user_data] = cqe->res;
+        }
+        __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+/**
+ * runUringBatch, runs count requests through the ring in chunks of its size. Any request the
+ *                kernel doesn't know (older than the op) is done the blocking way instead, and
+ *                so is all of it when there is no ring. results get what each call returned,
+ *                or -errno.
+ *
+ * Args: A struct, A size_t, An array of integers
+ * Return: Nothing
+ */
+static void runUringBatch(struct uringbatch *batch, size_t count, int *results)
+{
+    size_t done = 0, chunk;
+    pthread_mutex_lock(&ringLock);
+    if (useRing())
+    {
+        for (; done < count; done += chunk)
+        {
+            chunk = count - done < ring.entries ? count - done : ring.entries;
+            if (submitChunk(batch, done, chunk, results) != 0)
+                break;
+        }
+        for (size_t i = 0; i < done; i++)
+            if (results[i] == -EINVAL || results[i] == -EOPNOTSUPP)
+                results[i] = batch->fallback(i, batch->arg);
+    }
+    pthread_mutex_unlock(&ringLock);
+    for (; done < count; done++)
+        results[done] = batch->fallback(done, batch->arg);
+}
+
+/* What batchStatx and batchOpen hand their prepare and fallback functions. */
+struct uringrequests {
+    const int *dirFds;
+    const char **names;
+    struct statx *results;
+    int flags;
+};
+
+/**
+ * prepareStatx, one statx request, for batchStatx.
+ *
+ * Args: A struct, A size_t, A pointer
+ * Return: Nothing
+ */
+static void prepareStatx(struct io_uring_sqe *sqe, size_t i, void *arg)
+{
+    struct uringrequests *requests = arg;
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = requests->dirFds ? requests->dirFds[i] : AT_FDCWD;
+    sqe->addr = (unsigned long)requests->names[i];
+    sqe->len = STATX_BASIC_STATS;
+    sqe->off = (unsigned long)&requests->results[i];
+    sqe->statx_flags = AT_STATX_SYNC_AS_STAT;
+}
+
+/**
+ * blockingStatx, the same statx without the ring. Returns 0 or -errno.
+ *
+ * Args: A size_t, A pointer
+ * Return: An integer
+ */
+static int blockingStatx(size_t i, void *arg)
+{
+    struct uringrequests *requests = arg;
+    return statx(requests->dirFds ? requests->dirFds[i] : AT_FDCWD, requests->names[i], AT_STATX_SYNC_AS_STAT,
+                 STATX_BASIC_STATS, &requests->results[i]) == 0 ? 0 : -errno;
+}
+
+/**
+ * batchStatx, statx of every name, each relative to its dirFd (AT_FDCWD for all if dirFds is NULL),
+ *             as one submission. errors gets 0 for each that worked, else its errno.
+ *
+ * Args: A size_t, An array of integers, An array of strings, An array of structs, An array of integers
+ * Return: Nothing
+ */
+void batchStatx(size_t count, const int *dirFds, const char **names, struct statx *results, int *errors)
+{
+    struct uringrequests requests = {dirFds, names, results, 0};
+    struct uringbatch batch = {prepareStatx, blockingStatx, &requests};
+    runUringBatch(&batch, count, errors);
+    for (size_t i = 0; i < count; i++)
+        errors[i] = -errors[i];
+}
+
+/**
+ * prepareOpen, one openat request, for batchOpen.
+ *
+ * Args: A struct, A size_t, A pointer
+ * Return: Nothing
+ */
+static void prepareOpen(struct io_uring_sqe *sqe, size_t i, void *arg)
+{
+    struct uringrequests *requests = arg;
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = requests->dirFds ? requests->dirFds[i] : AT_FDCWD;
+    sqe->addr = (unsigned long)requests->names[i];
+    sqe->open_flags = requests->flags;
+}
+
+/**
+ * blockingOpen, the same openat without the ring. Returns the fd or -errno.
+ *
+ * Args: A size_t, A pointer
+ * Return: An integer
+ */
+static int blockingOpen(size_t i, void *arg)
+{
+    struct uringrequests *requests = arg;
+    int fd = openat(requests->dirFds ? requests->dirFds[i] : AT_FDCWD, requests->names[i], requests->flags);
+    return fd >= 0 ? fd : -errno;
+}
+
+/**
+ * batchOpen, openat of every name with the same flags, as one submission. fds gets each fd, or
+ *            -errno for those that couldn't be opened. Don't forget to close them.
+ *
+ * Args: A size_t, An array of integers, An array of strings, An integer, An array of integers
+ * Return: Nothing
+ */
+void batchOpen(size_t count, const int *dirFds, const char **names, int flags, int *fds)
+{
+    struct uringrequests requests = {dirFds, names, NULL, flags};
+    struct uringbatch batch = {prepareOpen, blockingOpen, &requests};
+    runUringBatch(&batch, count, fds);
+}
+
+/**
+ * setUringEnabled, the nouring shell variable. With it set every batch is done with blocking
+ *                  calls, for filesystems or sandboxes where the ring misbehaves.
+ *
+ * Args: An integer
+ * Return: Nothing
+ */
+void setUringEnabled(int enabled)
+{
+    pthread_mutex_lock(&ringLock);
+    uringEnabled = enabled;
+    pthread_mutex_unlock(&ringLock);
+}
+
+/**
+ * freeUring, unmaps and closes the ring.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void freeUring()
+{
+    if (ring.sqes != NULL)
+        munmap(ring.sqes, ring.sqeSize);
+    if (ring.cqRing != NULL && ring.cqRing != ring.sqRing)
+        munmap(ring.cqRing, ring.cqSize);
+    if (ring.sqRing != NULL)
+        munmap(ring.sqRing, ring.sqSize);
+    if (ring.fd >= 0)
+        close(ring.fd);
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+    ringState = 0;
+}
@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef URING_H
+#define URING_H
+
+// io_uring definitions
+#define URING_ENTRIES 64          // Requests in flight at once, bigger batches go in chunks
+
+/* The shell's one io_uring, set up the first time a batch is run. The pointers are into the
+   rings the kernel shares with us. */
+struct uring {
+    int fd;
+    unsigned entries;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sqRing, *cqRing;
+    size_t sqSize, cqSize, sqeSize;
+};
+
+void batchStatx(size_t count, const int *dirFds, const char **names, struct statx *results, int *errors);
+void batchOpen(size_t count, const int *dirFds, const char **names, int flags, int *fds);
+void setUringEnabled(int enabled);
+void freeUring();
+
+#endif
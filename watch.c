@@ -0,0 +1,498 @@
+#include "watch.h"
+#include "lists.h"
+#include "jobs.h"
+#include "output.h"
+#include "uring.h"
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+// Watcher globals, the mail list is only touched with mailLock held
+static pthread_mutex_t mailLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t watcherThread;
+static int watcherRunning = 0;
+static int inotifyFd = -1; // -1 means the watcher polls instead
+
+/**
+ * baseName, the part of a path after the last slash.
+ *
+ * Args: A string
+ * Return: A string
+ */
+static const char *baseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/**
+ * watchShared, whether another followed file uses the same inotify watch. Hard links to one
+ *              file, or files in one directory, get the same watch descriptor back.
+ *
+ * Args: A struct, An integer
+ * Return: An integer
+ */
+static int watchShared(struct mail *mail, int watch)
+{
+    for (size_t i = 0; i < mailList.count; i++)
+    {
+        struct mail *other = VECTOR_AT(mailList, struct mail *, i);
+        if (other != mail && (other->fileWatch == watch || other->dirWatch == watch))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * dropFileWatch, removes the inotify watch on the file a mail had open.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void dropFileWatch(struct mail *mail)
+{
+    if (mail->fileWatch >= 0 && !watchShared(mail, mail->fileWatch))
+        inotify_rm_watch(inotifyFd, mail->fileWatch); // Fails harmlessly if the file is already gone
+    mail->fileWatch = -1;
+}
+
+/**
+ * openMail, opens the file at the mail's path and remembers which file that is. Returns 0 on
+ *           success, st is filled in with the file's stat.
+ *
+ * Args: A struct, A struct
+ * Return: An integer
+ */
+static int openMail(struct mail *mail, struct stat *st)
+{
+    int fd = open(mail->pathToFile, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    if (mail->fd >= 0)
+        close(mail->fd);
+    mail->fd = fd;
+    mail->device = st->st_dev;
+    mail->inode = st->st_ino;
+    mail->mtime = st->st_mtim;
+    dropFileWatch(mail);
+    if (inotifyFd >= 0)
+        mail->fileWatch = inotify_add_watch(inotifyFd, mail->pathToFile,
+                                            IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF);
+    return 0;
+}
+
+/**
+ * printRecords, printNew for --json. The notice is a mail record and every line shown is a line record.
+ *
+ * Args: A struct, A string, A size_t, A time_t
+ * Return: Nothing
+ */
+static void printRecords(struct mail *mail, char *data, size_t length, time_t now)
+{
+    int shown = 0, noticed = 0;
+    char *line = data, *end;
+    // Keeps looking past the -n budget until the notice is out, the budget only limits the lines
+    while (line < data + length && (mail->lines < 0 || shown < mail->lines || (mail->notify && !noticed)))
+    {
+        if ((end = strchr(line, '\n')) != NULL)
+            *end = '\0';
+        if (mail->pattern == NULL || regexec(mail->pattern, line, 0, NULL, 0) == 0)
+        {
+            if (!noticed && mail->notify)
+                outRecord("mail", "path:s time:l", mail->pathToFile, (long long)now);
+            noticed = 1;
+            if (mail->lines < 0 || shown < mail->lines)
+                outRecord("line", "path:s text:s", mail->pathToFile, line);
+            shown++;
+        }
+        if (end == NULL)
+            break;
+        line = end + 1;
+    }
+    if (!noticed && mail->notify && mail->pattern == NULL)
+        outRecord("mail", "path:s time:l", mail->pathToFile, (long long)now);
+}
+
+/**
+ * printNew, prints what arrived in a followed file. watchmail prints the notice, and the first
+ *           lines new lines if it was asked for some. watchfile prints the lines under a tail style
+ *           header. With a pattern only matching lines count, and nothing is printed if none match,
+ *           the notice still goes out for the first match when no lines were asked for.
+ *
+ * Args: A struct, A string, A size_t
+ * Return: Nothing
+ */
+static void printNew(struct mail *mail, char *data, size_t length)
+{
+    int shown = 0, header = 0;
+    time_t now = time(NULL);
+    char *line = data, *end;
+    data[length] = '\0';
+    if (outputJson)
+    {
+        printRecords(mail, data, length, now);
+        return;
+    }
+    if (mail->notify && mail->pattern == NULL)
+    {
+        printf("\a\nYou've Got Mail in %s at %s", mail->pathToFile, ctime(&now));
+        header = 1;
+    }
+    // Keeps looking past the -n budget until the notice is out, the budget only limits the lines
+    while (line < data + length && (mail->lines < 0 || shown < mail->lines || (mail->notify && !header)))
+    {
+        if ((end = strchr(line, '\n')) != NULL)
+            *end = '\0';
+        if (mail->pattern == NULL || regexec(mail->pattern, line, 0, NULL, 0) == 0)
+        {
+            if (!header && mail->notify)
+                printf("\a\nYou've Got Mail in %s at %s", mail->pathToFile, ctime(&now));
+            else if (!header)
+                printf("==> %s <==\n", mail->pathToFile);
+            header = 1;
+            if (mail->lines < 0 || shown < mail->lines)
+                printf("%s\n", line);
+            shown++;
+        }
+        if (end == NULL)
+            break;
+        line = end + 1;
+    }
+}
+
+/**
+ * readNew, reads the bytes past the mail's offset with pread and prints them. A file that shrank
+ *          was truncated and is read from the start, so is one rewritten in place at the same size.
+ *          At most WATCH_READ_MAX bytes are looked at, the offset still moves to the end.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void readNew(struct mail *mail)
+{
+    struct stat st;
+    size_t length, got = 0;
+    ssize_t result;
+    char *data;
+    if (mail->fd < 0 || fstat(mail->fd, &st) != 0)
+        return;
+    if (st.st_size < mail->offset)
+    {
+        if (outputJson)
+            outRecord("watchfile", "path:s event:s", mail->pathToFile, "truncated");
+        else
+            printf("%s: file truncated\n", mail->pathToFile);
+        mail->offset = 0;
+    }
+    else if (st.st_size == mail->offset && st.st_size > 0 &&
+             (st.st_mtim.tv_sec != mail->mtime.tv_sec || st.st_mtim.tv_nsec != mail->mtime.tv_nsec))
+    {
+        if (outputJson)
+            outRecord("watchfile", "path:s event:s", mail->pathToFile, "rewritten");
+        else
+            printf("%s: file rewritten\n", mail->pathToFile);
+        mail->offset = 0;
+    }
+    mail->mtime = st.st_mtim;
+    if (st.st_size <= mail->offset)
+        return;
+    length = st.st_size - mail->offset < WATCH_READ_MAX ? st.st_size - mail->offset : WATCH_READ_MAX;
+    if ((data = malloc(length + 1)) == NULL)
+        return;
+    while (got < length && (result = pread(mail->fd, data + got, length - got, mail->offset + got)) > 0)
+        got += result;
+    mail->offset = st.st_size;
+    if (got > 0)
+        printNew(mail, data, got);
+    free(data);
+}
+
+/**
+ * updateMail, brings one followed file up to date. If the path now names a different file (it was
+ *             rotated) the rest of the old file is read before following the new one from its start.
+ *             If the path is gone (st is NULL) the old file is drained and closed until something is
+ *             created there.
+ *
+ * Args: A struct, A struct
+ * Return: Nothing
+ */
+static void updateMail(struct mail *mail, const struct stat *found)
+{
+    struct stat st;
+    if (found == NULL)
+    {
+        if (mail->fd >= 0)
+        {
+            readNew(mail);
+            close(mail->fd);
+            mail->fd = -1;
+            dropFileWatch(mail);
+            printf("%s: file removed, waiting for it to come back\n", mail->pathToFile);
+        }
+        return;
+    }
+    if (mail->fd < 0 || found->st_dev != mail->device || found->st_ino != mail->inode)
+    {
+        readNew(mail);
+        if (openMail(mail, &st) != 0)
+            return;
+        printf("%s: file replaced, following the new file\n", mail->pathToFile);
+        mail->offset = 0;
+    }
+    readNew(mail);
+}
+
+/**
+ * checkMail, stats one followed file and brings it up to date.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void checkMail(struct mail *mail)
+{
+    struct stat st;
+    updateMail(mail, stat(mail->pathToFile, &st) == 0 ? &st : NULL);
+}
+
+/**
+ * checkAllMail, the full rescan. Every followed file is stat'ed in one batch, through io_uring
+ *               when there is one, so files on a slow filesystem are all asked about at once.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+static void checkAllMail()
+{
+    size_t count = mailList.count;
+    const char **paths = malloc((count + 1) * sizeof(char *));
+    struct statx *results = malloc((count + 1) * sizeof(struct statx));
+    int *errors = malloc((count + 1) * sizeof(int));
+    struct stat st;
+    if (paths == NULL || results == NULL || errors == NULL)
+    {
+        for (size_t i = 0; i < count; i++)
+            checkMail(VECTOR_AT(mailList, struct mail *, i));
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+            paths[i] = VECTOR_AT(mailList, struct mail *, i)->pathToFile;
+        batchStatx(count, NULL, paths, results, errors);
+        for (size_t i = 0; i < count; i++)
+        {
+            memset(&st, 0, sizeof(st));
+            st.st_dev = makedev(results[i].stx_dev_major, results[i].stx_dev_minor);
+            st.st_ino = results[i].stx_ino;
+            updateMail(VECTOR_AT(mailList, struct mail *, i), errors[i] == 0 ? &st : NULL);
+        }
+    }
+    free(paths);
+    free(results);
+    free(errors);
+}
+
+/**
+ * handleEvent, checks every followed file an inotify event could be about: the file itself,
+ *              or a file of that name created or moved into its directory.
+ *
+ * Args: A struct
+ * Return: Nothing
+ */
+static void handleEvent(struct inotify_event *event)
+{
+    for (size_t i = 0; i < mailList.count; i++)
+    {
+        struct mail *mail = VECTOR_AT(mailList, struct mail *, i);
+        if (mail->fileWatch == event->wd ||
+            (mail->dirWatch == event->wd && event->len > 0 && strcmp(event->name, baseName(mail->pathToFile)) == 0))
+            checkMail(mail);
+    }
+}
+
+/**
+ * watcherCallback, the one thread that follows every watched file. It sleeps in poll on the
+ *                  inotify descriptor and only checks the files an event names, with a full
+ *                  rescan every WATCH_RESCAN_MS for filesystems inotify can't see. Without
+ *                  inotify it rescans every WATCH_POLL_MS instead. Cancellation is held off
+ *                  while the lock is taken. Nothing is printed while the shell holds the output
+ *                  for a redirected builtin, the files are rescanned after it.
+ *
+ * Args: Args that are given by pthread_create
+ * Return: Nothing
+ */
+static void *watcherCallback(void *callbackArgs)
+{
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd ready = {inotifyFd, POLLIN, 0};
+    ssize_t length;
+    int deferred = 0;
+    blockSignalsInThread();
+    while (1)
+    {
+        length = 0;
+        if (inotifyFd < 0 || deferred)
+            poll(NULL, 0, WATCH_POLL_MS);
+        else if (poll(&ready, 1, WATCH_RESCAN_MS) > 0)
+            length = read(inotifyFd, events, sizeof(events));
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        // fd 1 belongs to a builtin's redirection right now, rescan everything once it is back
+        if ((deferred = !outTryHold()))
+        {
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            continue;
+        }
+        pthread_mutex_lock(&mailLock);
+        if (length <= 0)
+        {
+            checkAllMail();
+        }
+        for (char *next = events; next < events + length;)
+        {
+            struct inotify_event *event = (struct inotify_event *)next;
+            handleEvent(event);
+            next += sizeof(struct inotify_event) + event->len;
+        }
+        outFlush();
+        pthread_mutex_unlock(&mailLock);
+        outRelease();
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    }
+    return NULL;
+}
+
+/**
+ * watchFile, starts following a file from its current end, or changes how an already followed
+ *            file is reported. lines is how many new lines to print (-1 for all), pattern an
+ *            extended regex lines must match (or NULL), notify whether to print the mail notice.
+ *            Paths are stored absolute so cd doesn't lose them. Returns 0 on success.
+ *
+ * Args: A string, An integer, A string, An integer
+ * Return: An integer
+ */
+int watchFile(const char *path, int lines, const char *pattern, int notify)
+{
+    char *fullPath, *dir;
+    regex_t *compiled = NULL;
+    struct mail *mail;
+    struct stat st;
+    if (pattern != NULL)
+    {
+        compiled = malloc(sizeof(regex_t));
+        if (compiled == NULL || regcomp(compiled, pattern, REG_EXTENDED | REG_NOSUB) != 0)
+        {
+            fprintf(stderr, "%s: Invalid pattern.\n", pattern);
+            free(compiled);
+            return -1;
+        }
+    }
+    if ((fullPath = realpath(path, NULL)) == NULL)
+    {
+        perror(path);
+        if (compiled)
+        {
+            regfree(compiled);
+            free(compiled);
+        }
+        return -1;
+    }
+    pthread_mutex_lock(&mailLock);
+    if (inotifyFd < 0 && !watcherRunning)
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if ((mail = findMail(fullPath)) == NULL)
+    {
+        if ((mail = addMail(fullPath)) == NULL || openMail(mail, &st) != 0)
+        {
+            perror(path);
+            if (mail != NULL)
+                removeMail(mail->pathToFile);
+            pthread_mutex_unlock(&mailLock);
+            if (compiled)
+            {
+                regfree(compiled);
+                free(compiled);
+            }
+            return -1;
+        }
+        mail->offset = st.st_size;
+        if (inotifyFd >= 0 && (dir = strdup(mail->pathToFile)) != NULL)
+        {
+            mail->dirWatch = inotify_add_watch(inotifyFd, dirname(dir), IN_CREATE | IN_MOVED_TO);
+            free(dir);
+        }
+    }
+    else
+    {
+        free(fullPath);
+        if (mail->pattern)
+        {
+            regfree(mail->pattern);
+            free(mail->pattern);
+        }
+    }
+    mail->lines = lines;
+    mail->pattern = compiled;
+    mail->notify = notify;
+    if (!watcherRunning && pthread_create(&watcherThread, NULL, watcherCallback, NULL) == 0)
+        watcherRunning = 1;
+    pthread_mutex_unlock(&mailLock);
+    return 0;
+}
+
+/**
+ * unwatchFile, stops following a file. The watcher thread is stopped with the last one.
+ *              Returns -1 if the file wasn't being followed.
+ *
+ * Args: A string
+ * Return: An integer
+ */
+int unwatchFile(const char *path)
+{
+    char *fullPath = realpath(path, NULL);
+    struct mail *mail;
+    pthread_mutex_lock(&mailLock);
+    mail = findMail(fullPath ? fullPath : (char *)path);
+    free(fullPath);
+    if (mail == NULL)
+    {
+        pthread_mutex_unlock(&mailLock);
+        return -1;
+    }
+    dropFileWatch(mail);
+    if (mail->dirWatch >= 0 && !watchShared(mail, mail->dirWatch))
+        inotify_rm_watch(inotifyFd, mail->dirWatch);
+    removeMail(mail->pathToFile);
+    pthread_mutex_unlock(&mailLock);
+    if (mailList.count == 0)
+        stopWatching();
+    return 0;
+}
+
+/**
+ * stopWatching, stops the watcher thread and frees every followed file.
+ *
+ * Args: Nothing
+ * Return: Nothing
+ */
+void stopWatching()
+{
+    if (watcherRunning)
+    {
+        pthread_cancel(watcherThread);
+        pthread_join(watcherThread, NULL);
+        watcherRunning = 0;
+    }
+    freeAllMail();
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+    inotifyFd = -1;
+}
@@ -0,0 +1,40 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // statx
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <libgen.h>
+#include <limits.h>
+#include <pthread.h>
+#include <regex.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/inotify.h>
+
+/********************************************************
+ * PROGRAM: Shell			                            *
+ * CLASS: CISC 361-011                                  *
+ * AUTHORS:                                             *
+ *    Alex Sederquest | alexsed@udel.edu | 702414270    *
+ *    Ben Segal | bensegal@udel.edu | 702425559         *
+ ********************************************************/
+
+#ifndef WATCH_H
+#define WATCH_H
+
+// file watcher definitions
+#define WATCH_READ_MAX (1024 * 1024) // Most new bytes looked at per change, the rest are skipped
+#define WATCH_RESCAN_MS 5000         // Every file is rechecked this often even if inotify says nothing
+#define WATCH_POLL_MS 1000           // How often files are checked when inotify isn't available
+
+int watchFile(const char *path, int lines, const char *pattern, int notify);
+int unwatchFile(const char *path);
+void stopWatching();
+
+#endif